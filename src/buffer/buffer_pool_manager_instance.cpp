@@ -12,18 +12,32 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>  // NOLINT
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
 #include "common/macros.h"
 
 namespace bustub {
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager,
-                                                      LogManager *log_manager)
-    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager) {}
+                                                     LogManager *log_manager, ReplacerType replacer_type)
+    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager, replacer_type) {}
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                                                     DiskManager *disk_manager, LogManager *log_manager)
-    : pool_size_(pool_size),
-      num_instances_(num_instances),
+                                                     DiskManager *disk_manager, LogManager *log_manager,
+                                                     ReplacerType replacer_type)
+    : num_instances_(num_instances),
       instance_index_(instance_index),
       next_page_id_(static_cast<page_id_t>(instance_index)),
       disk_manager_(disk_manager),
@@ -33,21 +47,14 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t
       instance_index < num_instances,
       "BPI index cannot be greater than the number of BPIs in the pool. In non-parallel case, index should just be 1.");
   // We allocate a consecutive memory space for the buffer pool. pages就是我们的bufferpool
-  pages_ = new Page[pool_size_];
-  replacer_ = new LRUReplacer(pool_size);
-
   // Initially, every page is in the free list.
-  // 将所有的pages数组索引加入到空闲链表中
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.emplace_back(static_cast<int>(i));
-    pages_[i].page_id_ = INVALID_PAGE_ID;
-    pages_[i].is_dirty_ = false;
-    pages_[i].pin_count_ = 0;
-  }
+  AddFrames(pool_size);
+  replacer_ = MakeReplacer(replacer_type, pool_size);
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
-  delete[] pages_;
+  StopPageCleaner();
+  StopPrefetcher();
   delete replacer_;
 }
 
@@ -57,29 +64,149 @@ BufferPoolManagerInstance::~BufferPoolManagerInstance() {
  */
 bool BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) {
   // Make sure you call DiskManager::WritePage!
-  std::lock_guard<std::mutex> guard(latch_);
+  std::unique_lock<std::mutex> lock(latch_);
   auto iter = page_table_.find(page_id);
   if (iter == page_table_.end()) {
     return false;
   }
   frame_id_t id = iter->second;
-  Page *page = pages_ + id;
+  Page *page = frames_[id];
+  // A page that is still being read in is clean, and its frame must not be touched until the read finishes.
+  if (io_in_progress_[id]) {
+    return true;
+  }
   page->is_dirty_ = false;
-  disk_manager_->WritePage(page_id, page->GetData());
+  WriteToDisk(page_id, page->GetData());
+  BufferPoolCounters::Bump(&counters_.flushes_);
   return true;
 }
 
 void BufferPoolManagerInstance::FlushAllPgsImp() {
-  // You can do it!
+  // 把所有的脏页按pageid排序后写入到磁盘中
+  std::vector<DirtyFrame> dirty = BeginFlush();
+  std::sort(dirty.begin(), dirty.end(),
+            [](const DirtyFrame &a, const DirtyFrame &b) { return a.page_id_ < b.page_id_; });
+  WriteDirtyFrames(disk_manager_, dirty.data(), dirty.size(), disk_scheduler_);
+  EndFlush(dirty);
+  // One sync makes the whole pool durable.
+  disk_manager_->Sync();
+}
+
+std::vector<BufferPoolManagerInstance::DirtyFrame> BufferPoolManagerInstance::BeginFlush() {
+  std::unique_lock<std::mutex> lock(latch_);
+  // A frame the page cleaner or another flush is writing may hold a change that is not on disk yet. Nothing is taken
+  // while waiting, so flushes waiting for each other cannot deadlock.
+  for (size_t i = 0; i < frames_.size(); i++) {
+    io_done_[i].wait(lock, [&] { return !flushing_[i]; });
+  }
+  std::vector<DirtyFrame> dirty;
+  for (const auto &[page_id, frame_id] : page_table_) {
+    Page *page = frames_[frame_id];
+    // A frame still being read in holds a clean page.
+    if (!page->is_dirty_ || io_in_progress_[frame_id] || flushing_[frame_id]) {
+      continue;
+    }
+    // Clear the flag before writing, so a change made while the write is running marks the page dirty again.
+    page->is_dirty_ = false;
+    flushing_[frame_id] = true;
+    dirty.push_back({page_id, frame_id, page, 0, false, false});
+  }
+  return dirty;
+}
+
+/**
+ * Copies a page a flush is about to write, so that a writer cannot tear it on its way to disk. Waiting for the read
+ * latch could deadlock with a writer that holds the page latched and waits for a frame the flush has taken, so the
+ * copy is taken optimistically and given up on if writers keep getting in the way.
+ * @param[out] version the page's version the copy was taken at
+ * @return true if copy holds a consistent image of the page
+ */
+static bool StagePage(Page *page, char *copy, uint64_t *version) {
+  for (int attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; attempt++) {
+    *version = page->OptimisticRead();
+    memcpy(copy, page->GetData(), PAGE_SIZE);
+    if (page->Validate(*version)) {
+      return true;
+    }
+    std::this_thread::yield();
+  }
+  return false;
+}
+
+void BufferPoolManagerInstance::WriteDirtyFrames(DiskManager *disk_manager, DirtyFrame *frames, size_t num_frames,
+                                                 DiskScheduler *disk_scheduler) {
+  if (num_frames == 0) {
+    return;
+  }
+  // Aligned, since direct I/O and the async disk manager hand the copies to the kernel as they are.
+  const size_t chunk = std::min<size_t>(num_frames, FLUSH_STAGING_PAGES);
+  std::unique_ptr<char, decltype(&free)> staging(static_cast<char *>(aligned_alloc(PAGE_SIZE, chunk * PAGE_SIZE)),
+                                                 &free);
+  std::vector<char *> copies(chunk);
+  for (size_t start = 0; start < num_frames; start += chunk) {
+    const size_t end = std::min(start + chunk, num_frames);
+    for (size_t i = start; i < end; i++) {
+      char *copy = staging.get() + (i - start) * PAGE_SIZE;
+      copies[i - start] = StagePage(frames[i].page_, copy, &frames[i].version_) ? copy : nullptr;
+    }
+
+    if (disk_scheduler != nullptr) {
+      std::vector<std::future<bool>> writes;
+      for (size_t i = start; i < end; i++) {
+        if (copies[i - start] != nullptr) {
+          writes.push_back(
+              disk_scheduler->Schedule(true, frames[i].page_id_, copies[i - start], IoPriority::BACKGROUND));
+        }
+      }
+      for (auto &write : writes) {
+        write.wait();
+      }
+    } else {
+      // One DiskManager::WritePages call per run of consecutive page ids.
+      std::vector<const char *> run;
+      size_t run_start = start;
+      while (run_start < end) {
+        if (copies[run_start - start] == nullptr) {
+          run_start++;
+          continue;
+        }
+        size_t run_end = run_start + 1;
+        while (run_end < end && copies[run_end - start] != nullptr &&
+               frames[run_end].page_id_ == frames[run_end - 1].page_id_ + 1) {
+          run_end++;
+        }
+        run.assign(copies.begin() + (run_start - start), copies.begin() + (run_end - start));
+        disk_manager->WritePages(frames[run_start].page_id_, run.data(), run.size());
+        run_start = run_end;
+      }
+    }
+
+    // A page that could not be copied, or that a writer latched since its copy, is marked dirty again by EndFlush.
+    for (size_t i = start; i < end; i++) {
+      frames[i].written_ = copies[i - start] != nullptr;
+      frames[i].clean_ = frames[i].written_ && frames[i].page_->Validate(frames[i].version_);
+    }
+  }
+}
+
+void BufferPoolManagerInstance::EndFlush(const std::vector<DirtyFrame> &frames) {
   std::lock_guard<std::mutex> guard(latch_);
-  auto iter = page_table_.begin();
-  // 遍历所有的内存中的页,然后写入到磁盘中
-  while (iter !=page_table_.end()) {
-    page_id_t pageid = iter->first;
-    frame_id_t frameid = iter->second;
-    Page *page = pages_ + frameid;
-    disk_manager_->WritePage(pageid, page->GetData());
-    iter++;
+  for (const DirtyFrame &frame : frames) {
+    if (static_cast<uint32_t>(frame.page_id_) % num_instances_ != instance_index_) {
+      continue;
+    }
+    if (!frame.clean_) {
+      frame.page_->is_dirty_ = true;
+    }
+    flushing_[frame.frame_id_] = false;
+    io_done_[frame.frame_id_].notify_all();
+    if (static_cast<size_t>(frame.frame_id_) >= pool_size_) {
+      drain_cv_.notify_all();
+    }
+    if (frame.written_) {
+      BufferPoolCounters::Bump(&counters_.flushes_);
+      BufferPoolCounters::Bump(&counters_.disk_writes_);
+    }
   }
 }
 /**
@@ -92,91 +219,198 @@ Page *BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) {
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   // 4.   Set the page ID output parameter. Return a pointer to P.
-  std::lock_guard<std::mutex> guard(latch_);
+  std::unique_lock<std::mutex> lock(latch_);
   frame_id_t frameid = -1;
-  Page *page = nullptr;
-  if (!free_list_.empty()) {
-    // 说明空闲链表中有空闲的frame_id,也就是在bufferpool中有空位
-    // 获取一个空闲的位置, 将page指向bufferpool的对应的page的位置
-    frameid = free_list_.front();
-    free_list_.pop_front();
-    page = &pages_[frameid];
-  } else if (replacer_->Victim(&frameid)) {
-    // 当空闲链表中找不到空闲的位置，说明bufferpool中位置被占满了，
-    // 这个时候需要使用lru移除一个，调用Victim()移除一个，并返回这个移除的位置
-    page = &pages_[frameid];
-    if (page->IsDirty()) {
-      disk_manager_->WritePage(page->GetPageId(), page->GetData());
-    }
-    // 从pagetable中移除pageid和frameid的对应关系
-    page_table_.erase(page->GetPageId());
-  }
-
-  if (page !=nullptr) {
-    // 说明上面在bufferpool中获取到了位置，现在应该将这个申请一个id
-    *page_id = AllocatePage();
-    page->page_id_ = *page_id;
-    page->pin_count_ = 1;
-    page->is_dirty_ = false;
-    page->ResetMemory();
-    page_table_[*page_id] = frameid;
-    replacer_->Pin(frameid);
-    return page;
+  Page *page = AcquireFrame(&frameid);
+  if (page == nullptr) {
+    BufferPoolCounters::Bump(&counters_.pin_failures_);
+    return nullptr;
+  }
+  BufferPoolCounters::Bump(&counters_.new_pages_);
+  // 说明上面在bufferpool中获取到了位置，现在应该将这个申请一个id
+  bool reused = false;
+  *page_id = AllocatePage(&reused);
+  LoadFrame(&lock, frameid, *page_id, false, true);
+  if (reused) {
+    // The disk still holds the deleted page; make sure the zeroed page replaces it even if nobody writes to it.
+    page->is_dirty_ = true;
   }
-  return nullptr;
+  return page;
+}
+
+Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) { return FetchPageThroughRing(page_id, nullptr); }
+
+Page *BufferPoolManagerInstance::FetchPgForScanImp(page_id_t page_id, BufferRing *ring) {
+  return FetchPageThroughRing(page_id, ring);
 }
+
 /**
  *  从bufferpool中获取一个页，如果这个页不在的话，就先在bufferpool中找一个位置（先freelist，在lru），找到之后，将之前的页
  *  判断是否为脏页来决定是否写入磁盘，然后从磁盘中读取对应的pageid的页到刚才找到的位置
  */
-Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) {
+Page *BufferPoolManagerInstance::FetchPageThroughRing(page_id_t page_id, BufferRing *ring, bool prefetch) {
   // 1.     Search the page table for the requested page (P).
   // 1.1    If P exists, pin it and return it immediately.
-  // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
+  // 1.2    If P does not exist, find a replacement page (R) from the scan's ring, the free list or the replacer.
   //        Note that pages are always found from the free list first.
   // 2.     If R is dirty, write it back to the disk.
   // 3.     Delete R from the page table and insert P.
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-  std::lock_guard<std::mutex> guard(latch_);
-  auto iter = page_table_.find(page_id);
-  if (iter != page_table_.end()) {
-    frame_id_t frameid = iter->second;
-    Page *page = &pages_[frameid];
-    page->pin_count_++;
-    replacer_->Pin(frameid);
-    return page;
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    auto iter = page_table_.find(page_id);
+    if (iter != page_table_.end()) {
+      frame_id_t frameid = iter->second;
+      Page *page = frames_[frameid];
+      if (page->pin_count_++ == 0) {
+        pinned_frames_++;
+      }
+      if (prefetch) {
+        replacer_->PinWithoutAccess(frameid);
+      } else {
+        replacer_->Pin(frameid);
+        BufferPoolCounters::Bump(&counters_.hits_);
+      }
+      // Another fetcher is reading the page in. Our pin keeps the frame in place while we wait for it.
+      io_done_[frameid].wait(lock, [&] { return !io_in_progress_[frameid]; });
+      return page;
+    }
+    // The page was just evicted and is still being written back; reading it now would see stale data.
+    auto evicted = write_back_.find(page_id);
+    if (evicted == write_back_.end()) {
+      break;
+    }
+    io_done_[evicted->second].wait(lock, [&] { return write_back_.count(page_id) == 0; });
   }
   // 表示pageid对应的页不在内存中
   frame_id_t frameid = -1;
+  Page *page = ring == nullptr || ring->GetRingSize() == 0 ? AcquireFrame(&frameid)
+                                                           : AcquireRingFrame(ring, page_id, &frameid);
+  // 判断是否找到了页的位置，找到之后将磁盘中对应的pageid给读进来
+  if (page == nullptr) {
+    BufferPoolCounters::Bump(&counters_.pin_failures_);
+    return nullptr;
+  }
+  BufferPoolCounters::Bump(prefetch ? &counters_.prefetched_ : &counters_.misses_);
+  LoadFrame(&lock, frameid, page_id, true, !prefetch);
+  return page;
+}
+
+Page *BufferPoolManagerInstance::AcquireFrame(frame_id_t *frame_id) {
   Page *page = nullptr;
   if (!free_list_.empty()) {
-    frameid = free_list_.front();
+    // 说明空闲链表中有空闲的frame_id,也就是在bufferpool中有空位
+    *frame_id = free_list_.front();
     free_list_.pop_front();
-    page = &pages_[frameid];
-  } else if (replacer_->Victim(&frameid)) {  // 从lru中移除一个frameid
-    page = &pages_[frameid];
-    // 如果是脏页就刷进磁盘
-    if (page->IsDirty()) {
-      disk_manager_->WritePage(page->GetPageId(), page->GetData());
-      page->is_dirty_ = false;
-    }
-    // 清除掉pagetable中的pageid和frameid的关系
-    page_table_.erase(page->GetPageId());
+    page = frames_[*frame_id];
+  } else if (replacer_->Victim(frame_id)) {
+    // 当空闲链表中找不到空闲的位置，说明bufferpool中位置被占满了，调用Victim()移除一个
+    page = frames_[*frame_id];
   }
+  return page;
+}
 
-  // 判断是否找到了页的位置
-  if (page != nullptr) {
-    page->page_id_ = page_id;
-    page->pin_count_ = 1;
-    page->is_dirty_ = false;
-    // 在内存中找到了位置之后，我们开始将磁盘中对应的pageid给读进来，放入这个bufferpool中
-    // printf("hhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhh %d\n",page_id);
-    disk_manager_->ReadPage(page_id, page->GetData());
-    page_table_[page_id] = frameid;
-    replacer_->Pin(frameid);
+Page *BufferPoolManagerInstance::AcquireRingFrame(BufferRing *ring, page_id_t page_id, frame_id_t *frame_id) {
+  BufferRing::InstanceRing &instance_ring = ring->instances_[instance_index_];
+  auto &slots = instance_ring.slots_;
+  Page *page = nullptr;
+  size_t slot = slots.size();
+  if (slots.size() >= ring->GetRingSize()) {
+    slot = instance_ring.next_;
+    instance_ring.next_ = (instance_ring.next_ + 1) % slots.size();
+    // Only recycle the frame if it is still in the pool, still holds the page this scan put there and nobody else is
+    // using it.
+    const frame_id_t ring_frame = slots[slot].frame_id_;
+    Page *candidate = static_cast<size_t>(ring_frame) < pool_size_ ? frames_[ring_frame] : nullptr;
+    if (candidate != nullptr && candidate->GetPageId() == slots[slot].page_id_ && candidate->GetPinCount() == 0) {
+      *frame_id = slots[slot].frame_id_;
+      replacer_->Remove(*frame_id);
+      page = candidate;
+    }
+  }
+  if (page == nullptr) {
+    page = AcquireFrame(frame_id);
+    if (page == nullptr) {
+      return nullptr;
+    }
+  }
+  if (slot == slots.size()) {
+    slots.push_back({*frame_id, page_id});
+  } else {
+    slots[slot] = {*frame_id, page_id};
   }
   return page;
 }
+
+void BufferPoolManagerInstance::LoadFrame(std::unique_lock<std::mutex> *lock, frame_id_t frame_id, page_id_t page_id,
+                                          bool read_from_disk, bool record_access) {
+  const FrameLoad load = BeginLoad(lock, frame_id, page_id, record_access);
+
+  // Nobody else touches the frame's data while io_in_progress_ is set, so the I/O can run without the latch.
+  lock->unlock();
+  // 如果是脏页就刷进磁盘
+  if (load.write_back_) {
+    WriteToDisk(load.old_page_id_, load.page_->GetData());
+  }
+  if (read_from_disk) {
+    ReadFromDisk(page_id, load.page_->GetData());
+  } else {
+    load.page_->ResetMemory();
+  }
+  lock->lock();
+
+  FinishLoad(load);
+}
+
+BufferPoolManagerInstance::FrameLoad BufferPoolManagerInstance::BeginLoad(std::unique_lock<std::mutex> *lock,
+                                                                          frame_id_t frame_id, page_id_t page_id,
+                                                                          bool record_access) {
+  Page *page = frames_[frame_id];
+  const page_id_t old_page_id = page->GetPageId();
+  const bool write_back = old_page_id != INVALID_PAGE_ID && page->IsDirty();
+  // 清除掉pagetable中旧的pageid和frameid的关系，换成新的
+  if (old_page_id != INVALID_PAGE_ID) {
+    page_table_.erase(old_page_id);
+  }
+  // The page cleaner may still be writing the old page out, which makes it as unreadable on disk as a write-back.
+  const bool cleaning = flushing_[frame_id];
+  if (write_back || cleaning) {
+    write_back_[old_page_id] = frame_id;
+  }
+  page_table_[page_id] = frame_id;
+  page->page_id_ = page_id;
+  page->pin_count_ = 1;
+  pinned_frames_++;
+  page->is_dirty_ = false;
+  if (record_access) {
+    replacer_->Pin(frame_id);
+  } else {
+    replacer_->PinWithoutAccess(frame_id);
+  }
+  io_in_progress_[frame_id] = true;
+  if (cleaning) {
+    io_done_[frame_id].wait(*lock, [&] { return !flushing_[frame_id]; });
+  }
+  if (write_back) {
+    BufferPoolCounters::Bump(&counters_.dirty_evictions_);
+    cleaner_cv_.notify_one();
+  } else if (old_page_id != INVALID_PAGE_ID) {
+    BufferPoolCounters::Bump(&counters_.clean_evictions_);
+  }
+  return FrameLoad{frame_id, page, page_id, old_page_id, write_back, cleaning};
+}
+
+void BufferPoolManagerInstance::FinishLoad(const FrameLoad &load) {
+  if (load.write_back_ || load.cleaning_) {
+    write_back_.erase(load.old_page_id_);
+  }
+  io_in_progress_[load.frame_id_] = false;
+  io_done_[load.frame_id_].notify_all();
+  if (static_cast<size_t>(load.frame_id_) >= pool_size_) {
+    drain_cv_.notify_all();
+  }
+}
+
 /**
  *  这个函数用来删除一个内存中的页
  */
@@ -186,28 +420,46 @@ bool BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) {
   // 1.   If P does not exist, return true.
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-  std::lock_guard<std::mutex> guard(latch_);
-  DeallocatePage(page_id);
-  auto iter = page_table_.find(page_id);
-
-  if (iter == page_table_.end()) {
-    return true;
-  }
-  frame_id_t frameid = iter->second;
-  Page *page = &pages_[frameid];
-  if (page->GetPinCount() > 0) {
-    return false;
+  std::unique_lock<std::mutex> lock(latch_);
+  frame_id_t frameid = -1;
+  Page *page = nullptr;
+  while (true) {
+    auto iter = page_table_.find(page_id);
+    if (iter == page_table_.end()) {
+      auto evicted = write_back_.find(page_id);
+      if (evicted == write_back_.end()) {
+        // Ids this instance has not handed out yet must not end up in the free-page bitmap.
+        if (page_id < next_page_id_) {
+          DeallocatePage(page_id);
+        }
+        return true;
+      }
+      // Let the write-back finish first, or it could land on top of the page that reuses the id.
+      io_done_[evicted->second].wait(lock, [&] { return write_back_.count(page_id) == 0; });
+      continue;
+    }
+    frameid = iter->second;
+    page = frames_[frameid];
+    if (page->GetPinCount() > 0) {
+      return false;
+    }
+    if (!flushing_[frameid]) {
+      break;
+    }
+    // The page cleaner is reading the frame; wait for it and look again, since the frame may have moved on.
+    io_done_[frameid].wait(lock);
   }
   if (page->IsDirty()) {
-    disk_manager_->WritePage(page_id, page->GetData());
+    WriteToDisk(page_id, page->GetData());
   }
-  replacer_->Pin(frameid);  // 表示正在被使用，从lru中剔除(从链表中剔除，从lru_map中剔除);
+  replacer_->Remove(frameid);  // 这个frame要回到空闲链表了，让replacer忘掉它
   page_table_.erase(page_id);
   page->page_id_ = INVALID_PAGE_ID;
   page->pin_count_ = 0;
   page->is_dirty_ = false;
   page->ResetMemory();
   free_list_.push_back(frameid);
+  DeallocatePage(page_id);
   return true;
 }
 /**
@@ -219,9 +471,19 @@ bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) {
   if (iter == page_table_.end()) {
     return false;
   }
+  return UnpinFrameLocked(iter->second, is_dirty);
+}
+
+bool BufferPoolManagerInstance::UnpinFrameImp(Page *page, bool is_dirty) {
+  frame_id_t frameid = page->frame_id_;
+  std::lock_guard<std::mutex> guard(latch_);
+  BUSTUB_ASSERT(frameid >= 0 && static_cast<size_t>(frameid) < frames_.size() && frames_[frameid] == page,
+                "page does not belong to this instance");
+  return UnpinFrameLocked(frameid, is_dirty);
+}
 
-  frame_id_t frameid = iter->second;
-  Page *page = pages_ + frameid;
+bool BufferPoolManagerInstance::UnpinFrameLocked(frame_id_t frameid, bool is_dirty) {
+  Page *page = frames_[frameid];
 
   if (page->GetPinCount() <=0) {
     return false;
@@ -232,18 +494,421 @@ bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) {
   page->pin_count_--;
   if (page->GetPinCount() <=0) {
     // 现在没有程序使用这个页了，把他加入到lru中
-    replacer_->Unpin(frameid);
+    pinned_frames_--;
+    if (static_cast<size_t>(frameid) < pool_size_) {
+      replacer_->Unpin(frameid);
+    } else {
+      // The frame is being retired by a shrink, which evicts the page instead.
+      drain_cv_.notify_all();
+    }
+  }
+  return true;
+}
+
+bool BufferPoolManagerInstance::Resize(size_t pool_size) {
+  if (pool_size == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> resize_guard(resize_latch_);
+  std::unique_lock<std::mutex> lock(latch_);
+  if (pool_size > pool_size_) {
+    AddFrames(pool_size);
+  } else if (pool_size < pool_size_) {
+    RetireFrames(&lock, pool_size);
   }
+  replacer_->Resize(pool_size_);
   return true;
 }
 
-page_id_t BufferPoolManagerInstance::AllocatePage() {
-  const page_id_t next_page_id = next_page_id_;
-  next_page_id_ += num_instances_;
+void BufferPoolManagerInstance::AddFrames(size_t pool_size) {
+  if (pool_size > frames_.size()) {
+    // Frames left over from a shrink are used first; only the rest is allocated.
+    FrameChunk chunk{static_cast<frame_id_t>(frames_.size()), pool_size - frames_.size(), nullptr, nullptr};
+    chunk.arena_ = std::make_unique<FrameArena>(chunk.size_, enable_huge_pages);
+    chunk.pages_ = std::make_unique<Page[]>(chunk.size_);
+    for (size_t i = 0; i < chunk.size_; i++) {
+      chunk.pages_[i].data_ = chunk.arena_->GetFrameData(i);
+      chunk.pages_[i].frame_id_ = static_cast<frame_id_t>(chunk.first_ + i);
+      frames_.push_back(&chunk.pages_[i]);
+    }
+    chunks_.push_back(std::move(chunk));
+    io_in_progress_.resize(frames_.size(), false);
+    flushing_.resize(frames_.size(), false);
+    while (io_done_.size() < frames_.size()) {
+      io_done_.emplace_back();
+    }
+  }
+  // 将所有的pages数组索引加入到空闲链表中
+  for (size_t i = pool_size_; i < pool_size; ++i) {
+    free_list_.emplace_back(static_cast<frame_id_t>(i));
+  }
+  pool_size_ = pool_size;
+}
+
+void BufferPoolManagerInstance::RetireFrames(std::unique_lock<std::mutex> *lock, size_t pool_size) {
+  // From here on no new page can move into a retired frame, and unpinning one no longer makes it evictable.
+  pool_size_ = pool_size;
+  free_list_.remove_if([&](frame_id_t frame_id) { return static_cast<size_t>(frame_id) >= pool_size; });
+  while (true) {
+    bool draining = false;
+    for (size_t i = pool_size; i < frames_.size(); i++) {
+      auto frame_id = static_cast<frame_id_t>(i);
+      Page *page = frames_[i];
+      if (page->page_id_ == INVALID_PAGE_ID) {
+        continue;
+      }
+      if (page->pin_count_ == 0) {
+        replacer_->Remove(frame_id);
+      }
+      if (page->pin_count_ > 0 || io_in_progress_[i] || flushing_[i]) {
+        draining = true;
+        continue;
+      }
+      // Evictions are rare enough here to write back with the latch held.
+      if (page->is_dirty_) {
+        WriteToDisk(page->page_id_, page->GetData());
+        BufferPoolCounters::Bump(&counters_.dirty_evictions_);
+      } else {
+        BufferPoolCounters::Bump(&counters_.clean_evictions_);
+      }
+      page_table_.erase(page->page_id_);
+      page->page_id_ = INVALID_PAGE_ID;
+      page->is_dirty_ = false;
+    }
+    if (!draining) {
+      break;
+    }
+    drain_cv_.wait(*lock);
+  }
+  // Free the chunks that hold nothing but retired frames.
+  while (!chunks_.empty() && static_cast<size_t>(chunks_.back().first_) >= pool_size) {
+    frames_.resize(chunks_.back().first_);
+    chunks_.pop_back();
+  }
+  io_in_progress_.resize(frames_.size());
+  flushing_.resize(frames_.size());
+}
+
+void BufferPoolManagerInstance::SaveWarmPages() {
+  std::vector<page_id_t> page_ids;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    for (size_t i = 0; i < pool_size_; i++) {
+      if (frames_[i]->page_id_ != INVALID_PAGE_ID && frames_[i]->pin_count_ > 0) {
+        page_ids.push_back(frames_[i]->page_id_);
+      }
+    }
+    // The replacer lists the frame it would evict first first, so the hottest unpinned page is last.
+    std::vector<frame_id_t> candidates = replacer_->EvictionCandidates(pool_size_);
+    for (auto iter = candidates.rbegin(); iter != candidates.rend(); ++iter) {
+      page_ids.push_back(frames_[*iter]->page_id_);
+    }
+  }
+  std::ofstream out(GetWarmFileName(), std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(page_ids.data()),
+            static_cast<std::streamsize>(page_ids.size() * sizeof(page_id_t)));
+}
+
+void BufferPoolManagerInstance::LoadWarmPages(size_t warm_percent) {
+  const std::string warm_file = GetWarmFileName();
+  std::ifstream in(warm_file, std::ios::binary);
+  if (!in.is_open()) {
+    return;
+  }
+  std::vector<page_id_t> saved;
+  page_id_t page_id;
+  while (in.read(reinterpret_cast<char *>(&page_id), sizeof(page_id))) {
+    saved.push_back(page_id);
+  }
+  in.close();
+  // A crash after this point must not warm the next start with a list that no longer matches the database.
+  std::remove(warm_file.c_str());
+
+  const size_t limit = std::min(warm_percent, static_cast<size_t>(100)) * pool_size_ / 100;
+  const page_id_t num_pages = disk_manager_->GetNumPages();
+  std::vector<page_id_t> warm;
+  for (page_id_t saved_id : saved) {
+    if (warm.size() >= limit) {
+      break;
+    }
+    if (saved_id >= 0 && saved_id < num_pages && static_cast<uint32_t>(saved_id) % num_instances_ == instance_index_ &&
+        !disk_manager_->IsFreePage(saved_id)) {
+      warm.push_back(saved_id);
+    }
+  }
+  std::sort(warm.begin(), warm.end());
+  PrefetchPgsImp(warm, nullptr);
+}
+
+std::string BufferPoolManagerInstance::GetWarmFileName() const {
+  const std::string &db_file = disk_manager_->GetFileName();
+  return db_file.substr(0, db_file.rfind('.')) + "." + std::to_string(instance_index_) + ".warm";
+}
+
+Replacer *BufferPoolManagerInstance::MakeReplacer(ReplacerType replacer_type, size_t num_frames) {
+  switch (replacer_type) {
+    case ReplacerType::LRU_K:
+      return new LRUKReplacer(num_frames);
+    case ReplacerType::CLOCK:
+      return new ClockReplacer(num_frames);
+    case ReplacerType::LRU:
+    default:
+      return new LRUReplacer(num_frames);
+  }
+}
+
+void BufferPoolManagerInstance::RunPageCleaner(size_t clean_target) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (cleaner_running_) {
+    return;
+  }
+  cleaner_running_ = true;
+  clean_target_ = clean_target;
+  cleaner_thread_ = std::thread(&BufferPoolManagerInstance::PageCleanerLoop, this);
+}
+
+void BufferPoolManagerInstance::StopPageCleaner() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (!cleaner_running_) {
+      return;
+    }
+    cleaner_running_ = false;
+  }
+  cleaner_cv_.notify_all();
+  cleaner_thread_.join();
+}
+
+void BufferPoolManagerInstance::PageCleanerLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (cleaner_running_) {
+    CleanPages(&lock);
+    cleaner_cv_.wait_for(lock, page_cleaner_interval);
+  }
+}
+
+void BufferPoolManagerInstance::CleanPages(std::unique_lock<std::mutex> *lock) {
+  // Free frames need no cleaning.
+  if (free_list_.size() >= clean_target_) {
+    return;
+  }
+  for (frame_id_t frame_id : replacer_->EvictionCandidates(clean_target_ - free_list_.size())) {
+    // The latch was released for the previous write, so the candidate may have been pinned or reloaded since.
+    Page *page = frames_[frame_id];
+    if (!page->IsDirty() || page->GetPinCount() > 0 || io_in_progress_[frame_id] || !cleaner_running_) {
+      continue;
+    }
+    const page_id_t page_id = page->GetPageId();
+    // Clear the flag before writing, so a change made while the write is running marks the page dirty again.
+    page->is_dirty_ = false;
+    flushing_[frame_id] = true;
+
+    // Only one frame is flushing at a time: if a fetcher pins the page and holds its write latch, the cleaner waits
+    // for it without holding up evictions of any other frame.
+    lock->unlock();
+    page->RLatch();
+    WriteToDisk(page_id, page->GetData(), IoPriority::BACKGROUND);
+    page->RUnlatch();
+    lock->lock();
+
+    flushing_[frame_id] = false;
+    io_done_[frame_id].notify_all();
+    if (static_cast<size_t>(frame_id) >= pool_size_) {
+      drain_cv_.notify_all();
+    }
+    BufferPoolCounters::Bump(&counters_.pages_cleaned_);
+  }
+}
+
+void BufferPoolManagerInstance::PrefetchPgsImp(const std::vector<page_id_t> &page_ids,
+                                               const PrefetchCallback &on_loaded) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (prefetch_stopped_) {
+    return;
+  }
+  if (!prefetch_running_) {
+    prefetch_running_ = true;
+    prefetch_thread_ = std::thread(&BufferPoolManagerInstance::PrefetchLoop, this);
+  }
+  for (page_id_t page_id : page_ids) {
+    // More requests than frames would only evict pages that were prefetched a moment ago.
+    if (prefetch_queue_.size() >= pool_size_) {
+      break;
+    }
+    prefetch_queue_.push_back({page_id, on_loaded});
+  }
+  prefetch_cv_.notify_one();
+}
+
+void BufferPoolManagerInstance::StopPrefetcher() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    prefetch_stopped_ = true;
+    prefetch_running_ = false;
+    prefetch_queue_.clear();
+  }
+  prefetch_cv_.notify_all();
+  if (prefetch_thread_.joinable()) {
+    prefetch_thread_.join();
+  }
+}
+
+void BufferPoolManagerInstance::PrefetchLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    prefetch_cv_.wait(lock, [&] { return !prefetch_running_ || !prefetch_queue_.empty(); });
+    if (!prefetch_running_) {
+      return;
+    }
+    // At most half the pool is tied up by one batch, so that foreground fetches still find frames meanwhile.
+    const size_t batch_size = std::min<size_t>(PREFETCH_BATCH_SIZE, std::max<size_t>(pool_size_ / 2, 1));
+    std::vector<PrefetchRequest> batch;
+    while (!prefetch_queue_.empty() && batch.size() < batch_size) {
+      batch.push_back(std::move(prefetch_queue_.front()));
+      prefetch_queue_.pop_front();
+    }
+    PrefetchBatch(&lock, batch);
+  }
+}
+
+void BufferPoolManagerInstance::PrefetchBatch(std::unique_lock<std::mutex> *lock,
+                                              const std::vector<PrefetchRequest> &batch) {
+  // Give every page that is not resident a frame. A page that is resident, being written back or asked for twice is
+  // fetched normally once the batch's reads are done, since its I/O may be one of them. A resident page nobody wants a
+  // callback for needs nothing at all, which also leaves its place in the replacer alone.
+  std::vector<FrameLoad> loads;
+  std::vector<Page *> pages(batch.size(), nullptr);
+  std::vector<bool> dropped(batch.size(), false);
+  for (size_t i = 0; i < batch.size(); i++) {
+    const page_id_t page_id = batch[i].page_id_;
+    if (page_table_.count(page_id) != 0 && !batch[i].on_loaded_) {
+      dropped[i] = true;
+      continue;
+    }
+    if (page_table_.count(page_id) != 0 || write_back_.count(page_id) != 0) {
+      continue;
+    }
+    frame_id_t frame_id;
+    Page *page = AcquireFrame(&frame_id);
+    if (page == nullptr) {
+      BufferPoolCounters::Bump(&counters_.pin_failures_);
+      dropped[i] = true;
+      continue;
+    }
+    BufferPoolCounters::Bump(&counters_.prefetched_);
+    loads.push_back(BeginLoad(lock, frame_id, page_id, false));
+    pages[i] = page;
+  }
+  lock->unlock();
+
+  if (!loads.empty()) {
+    auto start = std::chrono::steady_clock::now();
+    for (const FrameLoad &load : loads) {
+      if (load.write_back_) {
+        WriteToDisk(load.old_page_id_, load.page_->GetData());
+      }
+    }
+    // The callbacks only hand the finished loads back to this thread: they may run on a disk thread that another
+    // thread holding latch_ is waiting for.
+    std::mutex done_latch;
+    std::condition_variable done_cv;
+    std::vector<size_t> done;
+    std::vector<DiskRequest> reads;
+    for (size_t k = 0; k < loads.size(); k++) {
+      reads.push_back({false, loads[k].page_id_, loads[k].page_->GetData(), [&, k](bool /* ok */) {
+                         std::lock_guard<std::mutex> guard(done_latch);
+                         done.push_back(k);
+                         done_cv.notify_one();
+                       }});
+    }
+    if (disk_scheduler_ != nullptr) {
+      for (DiskRequest &read : reads) {
+        disk_scheduler_->Schedule(std::move(read), IoPriority::FOREGROUND);
+      }
+    } else {
+      disk_manager_->Submit(std::move(reads));
+    }
+    for (size_t finished = 0; finished < loads.size();) {
+      std::vector<size_t> ready;
+      {
+        std::unique_lock<std::mutex> done_lock(done_latch);
+        done_cv.wait(done_lock, [&] { return !done.empty(); });
+        ready.swap(done);
+      }
+      lock->lock();
+      for (size_t k : ready) {
+        FinishLoad(loads[k]);
+        BufferPoolCounters::Bump(&counters_.disk_reads_);
+      }
+      lock->unlock();
+      finished += ready.size();
+    }
+    counters_.disk_time_ns_.fetch_add((std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+  }
+
+  for (size_t i = 0; i < batch.size(); i++) {
+    if (dropped[i]) {
+      continue;
+    }
+    // A page that got no frame above is fetched like any other, which waits for a read already in progress.
+    Page *page = pages[i] != nullptr ? pages[i] : FetchPageThroughRing(batch[i].page_id_, nullptr, true);
+    if (page != nullptr) {
+      if (batch[i].on_loaded_) {
+        page->RLatch();
+        batch[i].on_loaded_(page);
+        page->RUnlatch();
+      }
+      UnpinFrameImp(page, false);
+    }
+  }
+  lock->lock();
+}
+
+void BufferPoolManagerInstance::ReadFromDisk(page_id_t page_id, char *page_data) {
+  auto start = std::chrono::steady_clock::now();
+  if (disk_scheduler_ != nullptr) {
+    disk_scheduler_->Schedule(false, page_id, page_data, IoPriority::FOREGROUND).wait();
+  } else {
+    disk_manager_->ReadPage(page_id, page_data);
+  }
+  counters_.disk_time_ns_.fetch_add((std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+  BufferPoolCounters::Bump(&counters_.disk_reads_);
+}
+
+void BufferPoolManagerInstance::WriteToDisk(page_id_t page_id, const char *page_data, IoPriority priority) {
+  auto start = std::chrono::steady_clock::now();
+  if (disk_scheduler_ != nullptr) {
+    // The scheduler only reads the data of a write.
+    disk_scheduler_->Schedule(true, page_id, const_cast<char *>(page_data), priority).wait();
+  } else {
+    disk_manager_->WritePage(page_id, page_data);
+  }
+  counters_.disk_time_ns_.fetch_add((std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+  BufferPoolCounters::Bump(&counters_.disk_writes_);
+}
+
+page_id_t BufferPoolManagerInstance::AllocatePage(bool *reused) {
+  const page_id_t free_page_id = disk_manager_->ReuseFreePage(num_instances_, instance_index_, next_page_id_);
+  if (free_page_id != INVALID_PAGE_ID) {
+    *reused = true;
+    return free_page_id;
+  }
+  const page_id_t next_page_id = next_page_id_.fetch_add(num_instances_);
   ValidatePageId(next_page_id);
+  // A database reopened without ContinuePageIds may have freed this id in an earlier run.
+  *reused = disk_manager_->ClaimPage(next_page_id);
   return next_page_id;
 }
 
+void BufferPoolManagerInstance::ContinuePageIds() {
+  const page_id_t num_pages = disk_manager_->GetNumPages();
+  page_id_t next_page_id = instance_index_;
+  while (next_page_id < num_pages) {
+    next_page_id += num_instances_;
+  }
+  next_page_id_ = next_page_id;
+}
+
 void BufferPoolManagerInstance::ValidatePageId(const page_id_t page_id) const {
   assert(page_id % num_instances_ == instance_index_);  // allocated pages mod back to this BPI
 }
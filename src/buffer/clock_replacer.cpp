@@ -12,18 +12,86 @@
 
 #include "buffer/clock_replacer.h"
 
+#include "common/macros.h"
+
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {}
+ClockReplacer::ClockReplacer(size_t num_pages) : num_pages_(num_pages), frames_(num_pages) {
+  for (auto &frame : frames_) {
+    frame.store(0, std::memory_order_relaxed);
+  }
+}
 
 ClockReplacer::~ClockReplacer() = default;
 
-bool ClockReplacer::Victim(frame_id_t *frame_id) { return false; }
+bool ClockReplacer::Victim(frame_id_t *frame_id) {
+  // One sweep clears every reference bit, the second one is then guaranteed to find a candidate unless other threads
+  // keep pinning and unpinning frames under the hand.
+  for (size_t step = 0; step < 2 * num_pages_; step++) {
+    size_t slot = hand_.fetch_add(1, std::memory_order_relaxed) % num_pages_;
+    uint8_t state = frames_[slot].load(std::memory_order_acquire);
+    if ((state & EVICTABLE) == 0) {
+      continue;
+    }
+    if ((state & REFERENCED) != 0) {
+      frames_[slot].compare_exchange_strong(state, EVICTABLE, std::memory_order_acq_rel);
+      continue;
+    }
+    if (frames_[slot].compare_exchange_strong(state, 0, std::memory_order_acq_rel)) {
+      *frame_id = static_cast<frame_id_t>(slot);
+      return true;
+    }
+  }
+  *frame_id = -1;
+  return false;
+}
+
+void ClockReplacer::Pin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  frames_[frame_id].store(0, std::memory_order_release);
+}
+
+void ClockReplacer::Unpin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  frames_[frame_id].store(EVICTABLE | REFERENCED, std::memory_order_release);
+}
 
-void ClockReplacer::Pin(frame_id_t frame_id) {}
+std::vector<frame_id_t> ClockReplacer::EvictionCandidates(size_t max_frames) {
+  std::vector<frame_id_t> candidates;
+  if (num_pages_ == 0) {
+    return candidates;
+  }
+  // Victim would take the unreferenced frames ahead of the hand first, and the referenced ones on its second sweep.
+  size_t start = hand_.load(std::memory_order_relaxed) % num_pages_;
+  for (uint8_t wanted : {EVICTABLE, static_cast<uint8_t>(EVICTABLE | REFERENCED)}) {
+    for (size_t step = 0; step < num_pages_ && candidates.size() < max_frames; step++) {
+      size_t slot = (start + step) % num_pages_;
+      if (frames_[slot].load(std::memory_order_relaxed) == wanted) {
+        candidates.push_back(static_cast<frame_id_t>(slot));
+      }
+    }
+  }
+  return candidates;
+}
 
-void ClockReplacer::Unpin(frame_id_t frame_id) {}
+size_t ClockReplacer::Size() {
+  size_t size = 0;
+  for (const auto &frame : frames_) {
+    if ((frame.load(std::memory_order_relaxed) & EVICTABLE) != 0) {
+      size++;
+    }
+  }
+  return size;
+}
 
-size_t ClockReplacer::Size() { return 0; }
+void ClockReplacer::Resize(size_t num_pages) {
+  // Atomics cannot be moved, so the frames that stay are copied into a new vector with their bits.
+  std::vector<std::atomic<uint8_t>> frames(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    frames[i].store(i < num_pages_ ? frames_[i].load(std::memory_order_relaxed) : 0, std::memory_order_relaxed);
+  }
+  frames_.swap(frames);
+  num_pages_ = num_pages;
+}
 
 }  // namespace bustub
@@ -0,0 +1,65 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.cpp
+//
+// Identification: src/buffer/frame_arena.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_arena.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+FrameArena::FrameArena(size_t num_frames, bool huge_pages) : num_frames_(num_frames) {
+  const size_t size = num_frames * PAGE_SIZE;
+  const bool use_huge_pages = huge_pages && size >= HUGE_PAGE_SIZE;
+  const size_t alignment = use_huge_pages ? HUGE_PAGE_SIZE : PAGE_SIZE;
+  mapped_size_ = (size + alignment - 1) / alignment * alignment;
+  if (alignment <= static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+    // mmap returns memory aligned to the system page size, which is all the frames need.
+    void *data = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot map the buffer pool frames");
+    }
+    data_ = static_cast<char *>(data);
+    return;
+  }
+
+  // Huge pages only back huge page aligned ranges, and a PAGE_SIZE above the system page size needs more alignment
+  // than mmap gives, so map one alignment unit more than needed and trim both ends.
+  const size_t reserved_size = mapped_size_ + alignment;
+  void *reserved = mmap(nullptr, reserved_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserved == MAP_FAILED) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot map the buffer pool frames");
+  }
+  const auto start = reinterpret_cast<uintptr_t>(reserved);
+  const uintptr_t aligned = (start + alignment - 1) / alignment * alignment;
+  if (aligned > start) {
+    munmap(reserved, aligned - start);
+  }
+  const uintptr_t end = aligned + mapped_size_;
+  if (end < start + reserved_size) {
+    munmap(reinterpret_cast<void *>(end), start + reserved_size - end);
+  }
+  data_ = reinterpret_cast<char *>(aligned);
+#ifdef MADV_HUGEPAGE
+  if (use_huge_pages) {
+    huge_page_advised_ = madvise(data_, mapped_size_, MADV_HUGEPAGE) == 0;
+  }
+#endif
+}
+
+FrameArena::~FrameArena() { munmap(data_, mapped_size_); }
+
+}  // namespace bustub
@@ -0,0 +1,127 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k) : k_(k), frames_(num_pages) {
+  BUSTUB_ASSERT(k > 0, "LRU-K needs at least one access of history");
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+bool LRUKReplacer::Victim(frame_id_t *frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (evictable_.empty()) {
+    *frame_id = -1;
+    return false;
+  }
+  auto victim = evictable_.begin();
+  *frame_id = victim->second;
+  evictable_.erase(victim);
+  // The frame is about to hold a different page, so its history no longer means anything.
+  frames_[*frame_id].history_.clear();
+  frames_[*frame_id].evictable_ = false;
+  frames_[*frame_id].placeholder_ = false;
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  MakeUnevictable(frame_id);
+  FrameInfo &frame = frames_[frame_id];
+  if (frame.placeholder_) {
+    frame.history_.clear();
+    frame.placeholder_ = false;
+  }
+  RecordAccess(frame_id);
+}
+
+void LRUKReplacer::PinWithoutAccess(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  MakeUnevictable(frame_id);
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < frames_.size(), "frame id out of range");
+  FrameInfo &frame = frames_[frame_id];
+  if (frame.evictable_) {
+    return;
+  }
+  // A frame that is unpinned without an access, e.g. after a read-ahead, still needs a position in the eviction order.
+  if (frame.history_.empty()) {
+    RecordAccess(frame_id);
+    frame.placeholder_ = true;
+  }
+  evictable_.emplace(KeyOf(frame_id), frame_id);
+  frame.evictable_ = true;
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  MakeUnevictable(frame_id);
+  frames_[frame_id].history_.clear();
+  frames_[frame_id].placeholder_ = false;
+}
+
+std::vector<frame_id_t> LRUKReplacer::EvictionCandidates(size_t max_frames) {
+  std::lock_guard<std::mutex> guard(latch_);
+  std::vector<frame_id_t> candidates;
+  for (auto iter = evictable_.begin(); iter != evictable_.end() && candidates.size() < max_frames; iter++) {
+    candidates.push_back(iter->second);
+  }
+  return candidates;
+}
+
+size_t LRUKReplacer::Size() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return evictable_.size();
+}
+
+void LRUKReplacer::Resize(size_t num_pages) {
+  std::lock_guard<std::mutex> guard(latch_);
+  for (size_t i = num_pages; i < frames_.size(); i++) {
+    if (frames_[i].evictable_) {
+      evictable_.erase({KeyOf(static_cast<frame_id_t>(i)), static_cast<frame_id_t>(i)});
+    }
+  }
+  frames_.resize(num_pages);
+}
+
+LRUKReplacer::EvictionKey LRUKReplacer::KeyOf(frame_id_t frame_id) const {
+  const auto &history = frames_[frame_id].history_;
+  // With fewer than k accesses the front is the earliest access, otherwise it is the k-th most recent one.
+  return {history.size() >= k_, history.front()};
+}
+
+void LRUKReplacer::MakeUnevictable(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < frames_.size(), "frame id out of range");
+  FrameInfo &frame = frames_[frame_id];
+  if (frame.evictable_) {
+    evictable_.erase({KeyOf(frame_id), frame_id});
+    frame.evictable_ = false;
+  }
+}
+
+void LRUKReplacer::RecordAccess(frame_id_t frame_id) {
+  auto &history = frames_[frame_id].history_;
+  history.push_back(current_timestamp_++);
+  if (history.size() > k_) {
+    history.pop_front();
+  }
+}
+
+}  // namespace bustub
@@ -61,9 +61,30 @@ void LRUReplacer::Unpin(frame_id_t frame_id) {
     lru_map_[frame_id] = p;  // 将节点和frame_id的关系加入到map中
 }
 
+std::vector<frame_id_t> LRUReplacer::EvictionCandidates(size_t max_frames) {
+    std::lock_guard<std::mutex> guard(lru_latch_);
+    std::vector<frame_id_t> candidates;
+    for (auto iter = lru_list_.begin(); iter != lru_list_.end() && candidates.size() < max_frames; iter++) {
+        candidates.push_back(*iter);
+    }
+    return candidates;
+}
+
 size_t LRUReplacer::Size() {
     std::lock_guard<std::mutex> guard(lru_latch_);
     return lru_list_.size();
 }
 
+void LRUReplacer::Resize(size_t num_pages) {
+    std::lock_guard<std::mutex> guard(lru_latch_);
+    for (auto iter = lru_list_.begin(); iter != lru_list_.end();) {
+        if (static_cast<size_t>(*iter) >= num_pages) {
+            lru_map_.erase(*iter);
+            iter = lru_list_.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+}
+
 }  // namespace bustub
@@ -11,32 +11,107 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/parallel_buffer_pool_manager.h"
+
+#include <algorithm>
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "buffer/buffer_pool_manager_instance.h"
 
 namespace bustub {
 
 ParallelBufferPoolManager::ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager) {
+                                                     LogManager *log_manager, ReplacerType replacer_type) {
   // Allocate and create individual BufferPoolManagerInstances
-  managers_ = new BufferPoolManager *[static_cast<int>(num_instances)];
+  managers_ = new BufferPoolManagerInstance *[static_cast<int>(num_instances)];
   for (size_t i = 0; i < num_instances; i++) {
     BufferPoolManagerInstance *manager =
-        new BufferPoolManagerInstance(pool_size, num_instances, i, disk_manager, log_manager);
+        new BufferPoolManagerInstance(pool_size, num_instances, i, disk_manager, log_manager, replacer_type);
     *(managers_ + i) = manager;
   }
   num_instances_ = num_instances;
   pool_size_ = pool_size;
-  next_instance_ = 0;
+  disk_manager_ = disk_manager;
 }
 
 // Update constructor to destruct all BufferPoolManagerInstances and deallocate any associated memory
-ParallelBufferPoolManager::~ParallelBufferPoolManager() { delete[] managers_; }
+ParallelBufferPoolManager::~ParallelBufferPoolManager() {
+  // A prefetch callback running in one instance may queue pages in any other, so every prefetcher has to be stopped
+  // before the first instance goes away.
+  for (size_t i = 0; i < num_instances_; i++) {
+    (*(managers_ + i))->StopPrefetcher();
+  }
+  for (size_t i = 0; i < num_instances_; i++) {
+    delete *(managers_ + i);
+  }
+  delete[] managers_;
+}
 
 size_t ParallelBufferPoolManager::GetPoolSize() {
   // Get size of all BufferPoolManagerInstances
   return num_instances_ * pool_size_;
 }
 
+BufferPoolStats ParallelBufferPoolManager::GetStats() {
+  BufferPoolStats stats;
+  for (size_t i = 0; i < num_instances_; i++) {
+    stats += (*(managers_ + i))->GetStats();
+  }
+  return stats;
+}
+
+BufferPoolStats ParallelBufferPoolManager::GetInstanceStats(size_t instance_index) {
+  return (*(managers_ + instance_index))->GetStats();
+}
+
+void ParallelBufferPoolManager::RunPageCleaner(size_t clean_target) {
+  for (size_t i = 0; i < num_instances_; i++) {
+    (*(managers_ + i))->RunPageCleaner(clean_target);
+  }
+}
+
+void ParallelBufferPoolManager::SaveWarmPages() {
+  for (size_t i = 0; i < num_instances_; i++) {
+    (*(managers_ + i))->SaveWarmPages();
+  }
+}
+
+void ParallelBufferPoolManager::LoadWarmPages(size_t warm_percent) {
+  for (size_t i = 0; i < num_instances_; i++) {
+    (*(managers_ + i))->LoadWarmPages(warm_percent);
+  }
+}
+
+bool ParallelBufferPoolManager::Resize(size_t pool_size) {
+  if (pool_size == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < num_instances_; i++) {
+    (*(managers_ + i))->Resize(pool_size);
+  }
+  pool_size_ = pool_size;
+  return true;
+}
+
+void ParallelBufferPoolManager::ContinuePageIds() {
+  for (size_t i = 0; i < num_instances_; i++) {
+    (*(managers_ + i))->ContinuePageIds();
+  }
+}
+
+void ParallelBufferPoolManager::SetDiskScheduler(DiskScheduler *disk_scheduler) {
+  for (size_t i = 0; i < num_instances_; i++) {
+    (*(managers_ + i))->SetDiskScheduler(disk_scheduler);
+  }
+  disk_scheduler_ = disk_scheduler;
+}
+
+void ParallelBufferPoolManager::StopPageCleaner() {
+  for (size_t i = 0; i < num_instances_; i++) {
+    (*(managers_ + i))->StopPageCleaner();
+  }
+}
+
 BufferPoolManager *ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) {
   // Get BufferPoolManager responsible for handling given page id. You can use this method in your other methods.
   return *(managers_ + page_id % num_instances_);
@@ -48,12 +123,37 @@ Page *ParallelBufferPoolManager::FetchPgImp(page_id_t page_id) {
   return manager->FetchPage(page_id);
 }
 
+Page *ParallelBufferPoolManager::FetchPgForScanImp(page_id_t page_id, BufferRing *ring) {
+  // Each instance keeps its own part of the ring
+  BufferPoolManager *manager = GetBufferPoolManager(page_id);
+  return manager->FetchPageForScan(page_id, ring);
+}
+
 bool ParallelBufferPoolManager::UnpinPgImp(page_id_t page_id, bool is_dirty) {
   // Unpin page_id from responsible BufferPoolManagerInstance
   BufferPoolManager *manager = GetBufferPoolManager(page_id);
   return manager->UnpinPage(page_id, is_dirty);
 }
 
+bool ParallelBufferPoolManager::UnpinFrameImp(Page *page, bool is_dirty) {
+  BufferPoolManager *manager = GetBufferPoolManager(page->GetPageId());
+  return manager->UnpinFrame(page, is_dirty);
+}
+
+void ParallelBufferPoolManager::PrefetchPgsImp(const std::vector<page_id_t> &page_ids,
+                                               const PrefetchCallback &on_loaded) {
+  // Group the pages by owner so that every instance's prefetcher gets one request
+  std::vector<std::vector<page_id_t>> per_instance(num_instances_);
+  for (page_id_t page_id : page_ids) {
+    per_instance[page_id % num_instances_].push_back(page_id);
+  }
+  for (size_t i = 0; i < num_instances_; i++) {
+    if (!per_instance[i].empty()) {
+      (*(managers_ + i))->PrefetchPages(per_instance[i], on_loaded);
+    }
+  }
+}
+
 bool ParallelBufferPoolManager::FlushPgImp(page_id_t page_id) {
   // Flush page_id from responsible BufferPoolManagerInstance
   BufferPoolManager *manager = GetBufferPoolManager(page_id);
@@ -67,11 +167,15 @@ Page *ParallelBufferPoolManager::NewPgImp(page_id_t *page_id) {
   // starting index and return nullptr
   // 2.   Bump the starting index (mod number of instances) to start search at a different BPMI each time this function
   // is called
-  std::lock_guard<std::mutex> guard(latch_);
+  // Concurrent callers each take their own starting index, so they spread over the instances without a shared latch.
+  size_t start = next_instance_.fetch_add(1, std::memory_order_relaxed);
   for (size_t i = 0; i < num_instances_; i++) {
-    BufferPoolManager *manager = *(managers_ + next_instance_);
+    BufferPoolManagerInstance *manager = *(managers_ + (start + i) % num_instances_);
+    // Skip instances that are full without taking their latch; the hint is exact whenever no pin is changing.
+    if (!manager->HasAvailableFrame()) {
+      continue;
+    }
     Page *page = manager->NewPage(page_id);
-    next_instance_ = (next_instance_ + 1) % num_instances_;
     if (page != nullptr) {
       return page;
     }
@@ -87,10 +191,47 @@ bool ParallelBufferPoolManager::DeletePgImp(page_id_t page_id) {
 
 void ParallelBufferPoolManager::FlushAllPgsImp() {
   // flush all pages from all BufferPoolManagerInstances
+  // Consecutive page ids live in different instances, so the pages of all instances are merged before coalescing.
+  std::vector<BufferPoolManagerInstance::DirtyFrame> dirty;
+  for (size_t i = 0; i < num_instances_; i++) {
+    auto taken = (*(managers_ + i))->BeginFlush();
+    dirty.insert(dirty.end(), taken.begin(), taken.end());
+  }
+  std::sort(dirty.begin(), dirty.end(),
+            [](const auto &a, const auto &b) { return a.page_id_ < b.page_id_; });
+
+  if (disk_scheduler_ != nullptr) {
+    // The scheduler's workers already write in parallel.
+    BufferPoolManagerInstance::WriteDirtyFrames(disk_manager_, dirty.data(), dirty.size(), disk_scheduler_);
+    for (size_t i = 0; i < num_instances_; i++) {
+      (*(managers_ + i))->EndFlush(dirty);
+    }
+    disk_manager_->Sync();
+    return;
+  }
+
+  // The sorted pages are cut into one slice per instance, each written by its own thread so the writes reach the disk
+  // in parallel. A cut never falls inside a run of consecutive pages.
+  const size_t slice = std::max<size_t>((dirty.size() + num_instances_ - 1) / num_instances_, 1);
+  std::vector<std::thread> writers;
+  size_t start = 0;
+  while (start < dirty.size()) {
+    size_t end = std::min(start + slice, dirty.size());
+    while (end < dirty.size() && dirty[end].page_id_ == dirty[end - 1].page_id_ + 1) {
+      end++;
+    }
+    writers.emplace_back(BufferPoolManagerInstance::WriteDirtyFrames, disk_manager_, dirty.data() + start, end - start,
+                         nullptr);
+    start = end;
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+
   for (size_t i = 0; i < num_instances_; i++) {
-    BufferPoolManager *manager = *(managers_ + i);
-    manager->FlushAllPages();
+    (*(managers_ + i))->EndFlush(dirty);
   }
+  disk_manager_->Sync();
 }
 
 }  // namespace bustub
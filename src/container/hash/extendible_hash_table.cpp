@@ -65,47 +65,46 @@ inline uint32_t HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage
  * 申请一个页作为HashTableDirectoryPage，然后设置这个页的基本变量
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
-HashTableDirectoryPage *HASH_TABLE_TYPE::FetchDirectoryPage() {
-  HashTableDirectoryPage *directory_page  = nullptr;
+page_id_t HASH_TABLE_TYPE::GetDirectoryPageId() {
   // // 因为directory_page_id_是一个公共变量，防止多个线程同时申请创建directory_page
   // my_lock_.lock();
   if (directory_page_id_ == INVALID_PAGE_ID) {
     // 从bufferPool中获取一个page用来充当这个directory_page
     LOG_DEBUG("create new directory");
     page_id_t pageid;
-    // 将获取的新页强制转换成HashTableDirectoryPage类型的，
     // data才是页的真实数据，也就是HashTableDirectoryPage要存储的空间
-    directory_page  = reinterpret_cast<HashTableDirectoryPage *>(AssertPage(buffer_pool_manager_->NewPage(&pageid))->GetData());
+    BasicPageGuard dir_guard = buffer_pool_manager_->NewPageGuarded(&pageid);
+    assert(dir_guard.IsValid());
+    auto directory_page = dir_guard.AsMut<HashTableDirectoryPage>();
     directory_page_id_ = pageid;
-    directory_page ->SetPageId(directory_page_id_);
+    directory_page->SetPageId(directory_page_id_);
     assert(directory_page_id_ != INVALID_PAGE_ID);
     // 创建完成一个HashTableDirectoryPage 即directory后，要创建一个bucket 0
     page_id_t bucket_pageid = INVALID_PAGE_ID;
     // 申请一个页，并将页的id放在bucket_pageid中
-    AssertPage(buffer_pool_manager_->NewPage(&bucket_pageid));
-    // directory_page ->IncrGlobalDepth();
-    directory_page ->SetBucketPageId(0, bucket_pageid);
-    // 申请完成之后要unpin,放到lru队列中
-    assert(buffer_pool_manager_->UnpinPage(bucket_pageid, true));
-    assert(buffer_pool_manager_->UnpinPage(directory_page_id_, true));
+    BasicPageGuard bucket_guard = buffer_pool_manager_->NewPageGuarded(&bucket_pageid);
+    assert(bucket_guard.IsValid());
+    bucket_guard.SetDirty();
+    directory_page->SetBucketPageId(0, bucket_pageid);
+    // guard析构时会unpin,放到lru队列中
   }
   // my_lock_.unlock();
-  // 重新从bufferpool中获取，上面时在bufferpool中创建
   assert(directory_page_id_ != INVALID_PAGE_ID);
-  // FetchPage会在内部pin这个页面
-  directory_page  = reinterpret_cast<HashTableDirectoryPage *>(AssertPage(buffer_pool_manager_
-                                                    ->FetchPage(directory_page_id_))->GetData());
-  return directory_page ;
+  return directory_page_id_;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-Page *HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) {
-  return AssertPage(buffer_pool_manager_->FetchPage(bucket_page_id));
+HashTableDirectoryPage *HASH_TABLE_TYPE::FetchDirectoryPage() {
+  // FetchPage会在内部pin这个页面
+  return reinterpret_cast<HashTableDirectoryPage *>(
+      AssertPage(buffer_pool_manager_->FetchPage(GetDirectoryPageId()))->GetData());
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-HASH_TABLE_BUCKET_TYPE *HASH_TABLE_TYPE::RetrieveBucket(Page *page) {
-  return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(page->GetData());
+BasicPageGuard HASH_TABLE_TYPE::FetchDirectoryPageGuarded() {
+  BasicPageGuard dir_guard = buffer_pool_manager_->FetchPageBasic(GetDirectoryPageId());
+  assert(dir_guard.IsValid());
+  return dir_guard;
 }
 
 /*****************************************************************************
@@ -118,20 +117,35 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) {
   table_latch_.RLock();  // 申请一个读锁
   // 这里我们pin了这个页
-  HashTableDirectoryPage *dir = FetchDirectoryPage();
-  // uint32_t bucket_idx = Hash(key);
-  page_id_t bucket_pageid = KeyToPageId(key, dir);
+  BasicPageGuard dir_guard = FetchDirectoryPageGuarded();
+  page_id_t bucket_pageid = KeyToPageId(key, dir_guard.As<HashTableDirectoryPage>());
   // 这里我们pin了这个页
-  Page *bucket_page = FetchBucketPage(bucket_pageid);
-
-  bucket_page->RLatch();  // 申请一个page 的读锁
-  HASH_TABLE_BUCKET_TYPE *bucket = RetrieveBucket(bucket_page);
-  bool res =  bucket->GetValue(key, comparator_, result);
-  bucket_page->RUnlatch();  // 释放这个page的读锁
-  // 对bucketpage要进行unpin操作
-  // 对dirpage要进行unpin操作
-  assert(buffer_pool_manager_->UnpinPage(bucket_pageid, false));
-  assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), false));
+  BasicPageGuard bucket_guard = buffer_pool_manager_->FetchPageBasic(bucket_pageid);
+  assert(bucket_guard.IsValid());
+  // Search the bucket under an optimistic read, so that concurrent lookups never write the page latch. Only values
+  // found by a search that validated are returned; if writers keep changing the bucket, wait for them on the read
+  // latch instead.
+  Page *bucket_page = bucket_guard.GetPage();
+  auto *bucket = bucket_guard.As<HASH_TABLE_BUCKET_TYPE>();
+  std::vector<ValueType> found;
+  bool validated = false;
+  for (int attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS && !validated; attempt++) {
+    found.clear();
+    uint64_t version = bucket_page->OptimisticRead();
+    bucket->GetValueOptimistic(key, comparator_, &found);
+    validated = bucket_page->Validate(version);
+  }
+  if (!validated) {
+    found.clear();
+    bucket_page->RLatch();
+    bucket->GetValue(key, comparator_, &found);
+    bucket_page->RUnlatch();
+  }
+  result->insert(result->end(), found.begin(), found.end());
+  bool res = !found.empty();
+  // 对bucketpage和dirpage进行unpin操作
+  bucket_guard.Drop();
+  dir_guard.Drop();
   table_latch_.RUnlock();  // 释放锁
   return res;
 }
@@ -141,29 +155,25 @@ bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  // LOG_INFO("enter insert function");
   // 这个锁是用来针对这个整个对象来说的，因为这个对象是线程共享的，所以必须保证所有的方法都是线程安全的
   // 别的不能执行insert操作，但是为什么还要给page锁呢，因为别的非insert函数可能会执行此page的变更操作
   table_latch_.RLock();
-  HashTableDirectoryPage *dir = FetchDirectoryPage();  // 获取这个directory，然后pin
-  page_id_t bucket_pageid = KeyToPageId(key, dir);
-  Page *bucket_page = FetchBucketPage(bucket_pageid);  // 获取这个桶对应的page
-  bucket_page->WLatch();  // 获取这个page的写锁，保证别的地方不能操作这个page对象
-  HASH_TABLE_BUCKET_TYPE *bucket = RetrieveBucket(bucket_page);  // 转换成HASH_TABLE_BUCKET_TYPE
-  if (!bucket->IsFull()) {
-    // 判断这个bucket页是否已经满了
-    bool res = bucket->Insert(key, value, comparator_);
-    bucket_page->WUnlatch();  // 对这个page的锁释放
-    assert(buffer_pool_manager_->UnpinPage(bucket_pageid, true));  // 对这个bucketpage执行unpin，并标志这个page是个脏页
-    assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), false));  // 对这个diretorypage进行unpin操作
+  BasicPageGuard dir_guard = FetchDirectoryPageGuarded();  // 获取这个directory，然后pin
+  page_id_t bucket_pageid = KeyToPageId(key, dir_guard.As<HashTableDirectoryPage>());
+  // 获取这个桶对应的page和它的写锁，保证别的地方不能操作这个page对象
+  WritePageGuard bucket_guard = buffer_pool_manager_->FetchPageWrite(bucket_pageid);
+  assert(bucket_guard.IsValid());
+  if (!bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->IsFull()) {
+    // 判断这个bucket页是否已经满了，没满就直接插入，这个bucketpage会被标志为脏页
+    bool res = bucket_guard.AsMut<HASH_TABLE_BUCKET_TYPE>()->Insert(key, value, comparator_);
+    bucket_guard.Drop();
+    dir_guard.Drop();
     table_latch_.RUnlock();
     return res;
   }
   // 说明这个bucket已经满了，那么就需要进行分裂
-  // 现在要先解锁，？？？？要解锁吗？
-  bucket_page->WUnlatch();  // 对这个page的锁释放
-  assert(buffer_pool_manager_->UnpinPage(bucket_pageid, false));  // 对这个bucketpage执行unpin，并标志这个page不是脏页
-  assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), false));  // 对这个diretorypage进行unpin操作
+  bucket_guard.Drop();
+  dir_guard.Drop();
   table_latch_.RUnlock();
   return SplitInsert(transaction, key, value);
 }
@@ -173,24 +183,27 @@ bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) {
   table_latch_.WLock();  // 获取这个对象的全局锁
-  HashTableDirectoryPage *dir = FetchDirectoryPage();  // 获取dir
+  BasicPageGuard dir_guard = FetchDirectoryPageGuarded();  // 获取dir
+  auto dir = dir_guard.As<HashTableDirectoryPage>();
   int64_t split_bucket_index = KeyToDirectoryIndex(key, dir);  // 获取这个key对应的dirctory的index，也是要分裂的下标
   uint32_t split_bucket_depth = dir->GetLocalDepth(split_bucket_index);  // 获取这个要分割的bucket的深度
   if (split_bucket_depth >= MAX_BUCKET_DEPTH) {
     // 表示已经满了，无法分割了
-    assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), false));
+    dir_guard.Drop();
     table_latch_.WUnlock();
     return false;
   }
+  // 下面会修改dir，所以dir是个脏页
+  dir_guard.SetDirty();
   if (split_bucket_depth == dir->GetGlobalDepth()) {
     // 给dir的entry grow一倍
     dir->IncrGlobalDepth();
   }
-  // 获取这个要分割的桶页
+  // 获取这个要分割的桶页，并给这个页上锁
   page_id_t split_bucket_page_id = KeyToPageId(key, dir);
-  Page *split_page = FetchBucketPage(split_bucket_page_id);
-  split_page->WLatch();  // 给这个页上锁
-  HASH_TABLE_BUCKET_TYPE *split_bucket = RetrieveBucket(split_page);
+  WritePageGuard split_guard = buffer_pool_manager_->FetchPageWrite(split_bucket_page_id);
+  assert(split_guard.IsValid());
+  HASH_TABLE_BUCKET_TYPE *split_bucket = split_guard.AsMut<HASH_TABLE_BUCKET_TYPE>();
 
   MappingType *origin_array = split_bucket->GetArrayCopy();
   uint32_t origin_array_size = split_bucket->NumReadable();
@@ -199,9 +212,9 @@ bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key,
 
   // 然后将开始申请一个新的页作为桶页分割后存储的页
   page_id_t image_bunket_page_id;
-  HASH_TABLE_BUCKET_TYPE *image_bucket = RetrieveBucket(
-    AssertPage(buffer_pool_manager_->NewPage(&image_bunket_page_id)));
-
+  BasicPageGuard image_guard = buffer_pool_manager_->NewPageGuarded(&image_bunket_page_id);
+  assert(image_guard.IsValid());
+  HASH_TABLE_BUCKET_TYPE *image_bucket = image_guard.AsMut<HASH_TABLE_BUCKET_TYPE>();
   // 增加这个localdepth
   dir->IncrLocalDepth(split_bucket_index);
   // 将index的  旧localdepth +1 位取反，为了我们能够找到所有的 localdepth个位 和 key对应的相同的index
@@ -272,10 +285,9 @@ bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key,
 
   // 最后一定要delete 在堆中申请的空间
   delete[] origin_array;
-  split_page->WUnlatch();
-  assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), true));
-  assert(buffer_pool_manager_->UnpinPage(split_bucket_page_id, true));
-  assert(buffer_pool_manager_->UnpinPage(image_bunket_page_id, true));
+  split_guard.Drop();
+  image_guard.Drop();
+  dir_guard.Drop();
   table_latch_.WUnlock();
   return Insert(transaction, key, value);
 }
@@ -287,25 +299,20 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
   table_latch_.RLock();
 
-  HashTableDirectoryPage *dir = FetchDirectoryPage();
-  page_id_t bucket_page_id = KeyToPageId(key, dir);
-  Page *page = FetchBucketPage(bucket_page_id);
-  page->WLatch();
-  HASH_TABLE_BUCKET_TYPE *bucket = RetrieveBucket(page);
+  BasicPageGuard dir_guard = FetchDirectoryPageGuarded();
+  page_id_t bucket_page_id = KeyToPageId(key, dir_guard.As<HashTableDirectoryPage>());
+  WritePageGuard bucket_guard = buffer_pool_manager_->FetchPageWrite(bucket_page_id);
+  assert(bucket_guard.IsValid());
+  HASH_TABLE_BUCKET_TYPE *bucket = bucket_guard.AsMut<HASH_TABLE_BUCKET_TYPE>();
   bool res = bucket->Remove(key, value, comparator_);
+  bool is_empty = bucket->IsEmpty();
+  bucket_guard.Drop();
+  dir_guard.Drop();
+  table_latch_.RUnlock();
   // 如果bucket空了，那么就将他的image bucket page进行merge
-  if (bucket->IsEmpty()) {
-    page->WUnlatch();
-    assert(buffer_pool_manager_->UnpinPage(bucket_page_id, true));
-    assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), false));
-    table_latch_.RUnlock();
+  if (is_empty) {
     Merge(transaction, key, value);
-    return res;
   }
-  page->WUnlatch();
-  assert(buffer_pool_manager_->UnpinPage(bucket_page_id, true));
-  assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), false));
-  table_latch_.RUnlock();
   return res;
 }
 
@@ -316,9 +323,11 @@ bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {
   table_latch_.WLock();
-  HashTableDirectoryPage *dir = FetchDirectoryPage();
+  BasicPageGuard dir_guard = FetchDirectoryPageGuarded();
+  auto dir = dir_guard.As<HashTableDirectoryPage>();
   uint32_t merge_bucket_index = KeyToDirectoryIndex(key, dir);
   if (merge_bucket_index >= dir->Size()) {
+    dir_guard.Drop();
     table_latch_.WUnlock();
     return;
   }
@@ -328,28 +337,28 @@ void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const
   uint32_t local_depth = dir->GetLocalDepth(merge_bucket_index);
   if (local_depth == 0) {
     // 说明无法merge了
-    assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), false));
+    dir_guard.Drop();
     table_latch_.WUnlock();
     return;
   }
   if (local_depth != dir->GetLocalDepth(image_bucket_index)) {
-    assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), false));
+    dir_guard.Drop();
     table_latch_.WUnlock();
     return;
   }
-  Page* merge_bucket_page = FetchBucketPage(merge_bucket_page_id);
-  merge_bucket_page->RLatch();
-  HASH_TABLE_BUCKET_TYPE *bucket = RetrieveBucket(merge_bucket_page);
-  if (!bucket->IsEmpty()) {
-    merge_bucket_page->RUnlatch();
-    assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), false));
-    assert(buffer_pool_manager_->UnpinPage(merge_bucket_page_id, false));
+  ReadPageGuard merge_guard = buffer_pool_manager_->FetchPageRead(merge_bucket_page_id);
+  assert(merge_guard.IsValid());
+  if (!merge_guard.As<HASH_TABLE_BUCKET_TYPE>()->IsEmpty()) {
+    merge_guard.Drop();
+    dir_guard.Drop();
     table_latch_.WUnlock();
     return;
   }
-  merge_bucket_page->RUnlatch();
-  assert(buffer_pool_manager_->UnpinPage(merge_bucket_page_id, false));
-  assert(buffer_pool_manager_->DeletePage(merge_bucket_page_id));
+  merge_guard.Drop();
+  // Give the bucket's page back so a later split can reuse it. This must not sit inside assert(), which compiles away.
+  buffer_pool_manager_->DeletePage(merge_bucket_page_id);
+  // 下面会修改dir，所以dir是个脏页
+  dir_guard.SetDirty();
   page_id_t image_bucket_page_id = dir->GetBucketPageId(image_bucket_index);
   dir->SetBucketPageId(merge_bucket_index, image_bucket_page_id);
   dir->DecrLocalDepth(merge_bucket_index);
@@ -377,7 +386,7 @@ void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const
   if (dir->CanShrink()) {
     dir->DecrGlobalDepth();
   }
-  assert(buffer_pool_manager_->UnpinPage(dir->GetPageId(), true));
+  dir_guard.Drop();
   table_latch_.WUnlock();
   return;
 }
@@ -19,11 +19,11 @@ SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNod
       plan_(plan),
       table_heap_(exec_ctx->GetCatalog()->GetTable(plan_->GetTableOid())->table_.get()),
       schema_(&exec_ctx->GetCatalog()->GetTable(plan->GetTableOid())->schema_),
-      iter_(table_heap_->Begin(exec_ctx_->GetTransaction())) {}
+      iter_(table_heap_->Begin(exec_ctx_->GetTransaction(), plan_->GetScanStrategy())) {}
 
 void SeqScanExecutor::Init() {
     // 初始化这个执行器，将iter指向第一个tuple
-    iter_ = table_heap_->Begin(exec_ctx_->GetTransaction());
+    iter_ = table_heap_->Begin(exec_ctx_->GetTransaction(), plan_->GetScanStrategy());
 }
 /**
  * 
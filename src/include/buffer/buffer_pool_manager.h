@@ -12,14 +12,20 @@
 
 #pragma once
 
+#include <functional>
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/buffer_ring.h"
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/disk_scheduler.h"
 #include "storage/page/page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
@@ -30,6 +36,8 @@ class BufferPoolManager {
  public:
   enum class CallbackType { BEFORE, AFTER };
   using bufferpool_callback_fn = void (*)(enum CallbackType, const page_id_t page_id);
+  /** Called by the prefetcher once a page is in memory, with the page pinned and read latched. */
+  using PrefetchCallback = std::function<void(Page *page)>;
 
   BufferPoolManager() = default;
   /**
@@ -84,9 +92,138 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
+  /**
+   * Fetch a page on behalf of a scan. On a miss the page is loaded into a frame recycled from the scan's ring rather
+   * than into a victim picked by the replacer.
+   * @param page_id id of page to be fetched
+   * @param ring the scan's buffer ring, nullptr to fetch the page normally
+   * @param callback called before and after the fetch, as by FetchPage
+   * @return the requested page
+   */
+  Page *FetchPageForScan(page_id_t page_id, BufferRing *ring, bufferpool_callback_fn callback = nullptr) {
+    GradingCallback(callback, CallbackType::BEFORE, page_id);
+    auto *result = ring == nullptr ? FetchPgImp(page_id) : FetchPgForScanImp(page_id, ring);
+    GradingCallback(callback, CallbackType::AFTER, page_id);
+    return result;
+  }
+
+  /**
+   * Fetch a page and wrap its pin in a guard.
+   * @param page_id id of page to be fetched
+   * @return a guard for the page, empty if the page could not be fetched
+   */
+  BasicPageGuard FetchPageBasic(page_id_t page_id) { return BasicPageGuard(this, FetchPgImp(page_id)); }
+
+  /**
+   * Fetch a page and take its read latch.
+   * @param page_id id of page to be fetched
+   * @param ring the scan's buffer ring, nullptr to fetch the page normally
+   * @return a guard holding the pin and the read latch, empty if the page could not be fetched
+   */
+  ReadPageGuard FetchPageRead(page_id_t page_id, BufferRing *ring = nullptr) {
+    Page *page = FetchPageForScan(page_id, ring);
+    if (page != nullptr) {
+      page->RLatch();
+    }
+    return ReadPageGuard(this, page);
+  }
+
+  /**
+   * Fetch a page and take its write latch.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the pin and the write latch, empty if the page could not be fetched
+   */
+  WritePageGuard FetchPageWrite(page_id_t page_id) {
+    Page *page = FetchPgImp(page_id);
+    if (page != nullptr) {
+      page->WLatch();
+    }
+    return WritePageGuard(this, page);
+  }
+
+  /**
+   * Create a new page and wrap its pin in a guard.
+   * @param[out] page_id id of created page
+   * @return a guard for the new page, empty if no new page could be created
+   */
+  BasicPageGuard NewPageGuarded(page_id_t *page_id) { return BasicPageGuard(this, NewPgImp(page_id)); }
+
+  /**
+   * Ask for pages to be loaded in the background. The call does not wait for any I/O: the pages are read into frames
+   * that are left unpinned, so a later FetchPage finds them in memory. Pages that are already resident are not read
+   * again. Requests may be dropped when the prefetcher is backed up or every frame is pinned.
+   * @param page_ids ids of the pages to load
+   * @param on_loaded called for each page once it is in memory, from the prefetching thread; may be empty
+   */
+  void PrefetchPages(const std::vector<page_id_t> &page_ids, const PrefetchCallback &on_loaded = nullptr) {
+    PrefetchPgsImp(page_ids, on_loaded);
+  }
+
+  /**
+   * Unpin a page the caller still holds a pointer to. Unlike UnpinPage, this does not need to look the page up.
+   * @param page the pinned page
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  bool UnpinFrame(Page *page, bool is_dirty) { return UnpinFrameImp(page, is_dirty); }
+
   /** @return size of the buffer pool */
   virtual size_t GetPoolSize() = 0;
 
+  /**
+   * @return a snapshot of the buffer pool's hit, eviction and I/O counters; all zero for buffer pools that do not
+   * count
+   */
+  virtual BufferPoolStats GetStats() { return {}; }
+
+  /**
+   * Starts a background thread that writes dirty pages back before they are chosen as victims, so that evictions do
+   * not have to write them synchronously. Buffer pools without a page cleaner ignore this.
+   * @param clean_target the number of clean evictable frames the cleaner tries to keep available per instance
+   */
+  virtual void RunPageCleaner(size_t clean_target) {}
+
+  /** Stops and joins the page cleaner started by RunPageCleaner, if any. */
+  virtual void StopPageCleaner() {}
+
+  /**
+   * Records which pages are resident, hottest first, in a file next to the database, so that the next buffer pool on
+   * this database can reload them with LoadWarmPages. Meant for a clean shutdown. Buffer pools that cannot reload
+   * pages ignore this.
+   */
+  virtual void SaveWarmPages() {}
+
+  /**
+   * Reloads, in the background, the pages recorded by the last SaveWarmPages on this database, and removes the record
+   * so that it is only used once. Only the hottest pages that fit in warm_percent of the pool are loaded. Pages that
+   * were freed or lie past the end of the database file are skipped.
+   * @param warm_percent how much of the pool to fill, in percent
+   */
+  virtual void LoadWarmPages(size_t warm_percent) {}
+
+  /**
+   * Grows or shrinks the buffer pool while it is in use. Shrinking evicts the pages in the frames that go away and
+   * waits for pinned ones to be unpinned, so the caller must not hold pins on this buffer pool.
+   * @param pool_size the new number of frames, per instance for a buffer pool made of several instances
+   * @return false if the buffer pool cannot be resized or pool_size is 0
+   */
+  virtual bool Resize(size_t pool_size) { return false; }
+
+  /**
+   * Sends the buffer pool's page reads and writes through a scheduler instead of straight to the disk manager: misses
+   * and evictions as foreground requests, the page cleaner and FlushAllPages as background ones. Must be called
+   * before the buffer pool is used or while it is idle. Buffer pools without a scheduler path ignore this.
+   * @param disk_scheduler a scheduler in front of this buffer pool's disk manager, or nullptr to stop using one
+   */
+  virtual void SetDiskScheduler(DiskScheduler *disk_scheduler) {}
+
+  /**
+   * Makes new page ids continue after the pages the database file already holds, instead of starting over at 0 as
+   * they do by default. Call it after reopening a database whose pages should be kept, before the buffer pool is used.
+   * Buffer pools that do not allocate page ids ignore this.
+   */
+  virtual void ContinuePageIds() {}
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -108,6 +245,15 @@ class BufferPoolManager {
    */
   virtual Page *FetchPgImp(page_id_t page_id) = 0;
 
+  /**
+   * Fetch the requested page, recycling frames from the given ring on a miss.
+   * Buffer pools without ring support simply fetch the page.
+   * @param page_id id of page to be fetched
+   * @param ring the scan's buffer ring
+   * @return the requested page
+   */
+  virtual Page *FetchPgForScanImp(page_id_t page_id, BufferRing *ring) { return FetchPgImp(page_id); }
+
   /**
    * Unpin the target page from the buffer pool.
    * @param page_id id of page to be unpinned
@@ -116,6 +262,23 @@ class BufferPoolManager {
    */
   virtual bool UnpinPgImp(page_id_t page_id, bool is_dirty) = 0;
 
+  /**
+   * Queue pages for background loading.
+   * Buffer pools without a prefetcher ignore the request; a later fetch simply reads the page.
+   * @param page_ids ids of the pages to load
+   * @param on_loaded called for each page once it is in memory; may be empty
+   */
+  virtual void PrefetchPgsImp(const std::vector<page_id_t> &page_ids, const PrefetchCallback &on_loaded) {}
+
+  /**
+   * Unpin a page given the frame that holds it.
+   * Buffer pools that cannot map the frame back without a lookup simply unpin by page id.
+   * @param page the pinned page
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  virtual bool UnpinFrameImp(Page *page, bool is_dirty) { return UnpinPgImp(page->GetPageId(), is_dirty); }
+
   /**
    * Flushes the target page to disk.
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
@@ -12,12 +12,20 @@
 
 #pragma once
 
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <list>
+#include <memory>
 #include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
-#include "buffer/lru_replacer.h"
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/frame_arena.h"
+#include "buffer/replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
@@ -34,8 +42,10 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used to pick victim frames
    */
-  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr);
+  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU);
   /**
    * Creates a new BufferPoolManagerInstance.
    * @param pool_size the size of the buffer pool
@@ -43,9 +53,11 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param instance_index index of this BPI in the parallel BPM
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used to pick victim frames
    */
   BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                            DiskManager *disk_manager, LogManager *log_manager = nullptr);
+                            DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU);
 
   /**
    * Destroys an existing BufferPoolManagerInstance.
@@ -55,8 +67,116 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override { return pool_size_; }
 
-  /** @return pointer to all the pages in the buffer pool */
-  Page *GetPages() { return pages_; }
+  /**
+   * @param frame_id a frame id below GetPoolSize()
+   * @return the page held by the frame
+   */
+  Page *GetFrame(frame_id_t frame_id) {
+    std::lock_guard<std::mutex> guard(latch_);
+    return frames_[frame_id];
+  }
+
+  /**
+   * Grows or shrinks the buffer pool. New frames are added to the free list. When shrinking, the frames with the
+   * highest ids are retired: their pages are written back if dirty and leave the page table, pinned ones as soon as
+   * they are unpinned. The call returns once every retired frame is empty. The replacer is resized in place and keeps
+   * what it knows about the frames that stay, including their LRU-K access history.
+   * @param pool_size the new number of frames
+   * @return false if pool_size is 0
+   */
+  bool Resize(size_t pool_size) override;
+
+  /** Sends this instance's page I/O through disk_scheduler, or straight to the disk manager if it is nullptr. */
+  void SetDiskScheduler(DiskScheduler *disk_scheduler) override { disk_scheduler_ = disk_scheduler; }
+
+  /** Moves next_page_id_ to this instance's first page id past the end of the database file. */
+  void ContinuePageIds() override;
+
+  /**
+   * Writes the ids of the resident pages to GetWarmFileName(): pinned pages first, then the unpinned ones from the
+   * last to the next eviction candidate of the replacer.
+   */
+  void SaveWarmPages() override;
+
+  /**
+   * Reads GetWarmFileName(), removes it, and hands the hottest warm_percent of the pool that still belong to this
+   * instance to the prefetch thread, in ascending page id order so that the disk reads them sequentially.
+   * @param warm_percent how much of the pool to fill, in percent
+   */
+  void LoadWarmPages(size_t warm_percent) override;
+
+  /** @return the file SaveWarmPages writes to: the database file name with its extension replaced by .<index>.warm */
+  std::string GetWarmFileName() const;
+
+  /**
+   * Starts the page cleaner. Every page_cleaner_interval, and whenever an eviction had to write a dirty page itself,
+   * the cleaner looks at the next clean_target eviction candidates and writes the dirty ones back.
+   * @param clean_target the number of clean evictable frames to keep available
+   */
+  void RunPageCleaner(size_t clean_target) override;
+
+  /** Stops and joins the page cleaner. */
+  void StopPageCleaner() override;
+
+  /** @return the number of dirty pages the page cleaner has written back */
+  size_t GetPagesCleaned() const { return counters_.pages_cleaned_.load(std::memory_order_relaxed); }
+
+  /** @return the number of dirty pages written back synchronously because they were evicted */
+  size_t GetSyncWrites() const { return counters_.dirty_evictions_.load(std::memory_order_relaxed); }
+
+  /** @return a snapshot of this instance's counters, taken without the latch */
+  BufferPoolStats GetStats() override { return counters_.Snapshot(); }
+
+  /**
+   * A hint that can be read without the latch. It may be stale while other threads pin or unpin pages.
+   * @return true if some frame is free or holds an unpinned page, so that NewPage could succeed
+   */
+  bool HasAvailableFrame() const { return pinned_frames_.load(std::memory_order_relaxed) < pool_size_; }
+
+  /** Stops and joins the prefetch thread, dropping queued requests. Later prefetch requests are ignored. */
+  void StopPrefetcher();
+
+  /** A dirty page held for a flush by BeginFlush. */
+  struct DirtyFrame {
+    page_id_t page_id_;
+    frame_id_t frame_id_;
+    Page *page_;
+    /** The page's version when it was copied to be written out, see Page::OptimisticRead. */
+    uint64_t version_;
+    /** Set by WriteDirtyFrames if a consistent copy of the page was written. */
+    bool written_;
+    /** Set by WriteDirtyFrames if the page was written and no writer latched it since it was copied. */
+    bool clean_;
+  };
+
+  /**
+   * Takes every dirty page for a flush and clears its dirty flag. Like a page the cleaner writes, a taken page can
+   * still be pinned and read, but its frame is not reloaded until EndFlush. Waits for writes that are already in
+   * progress first, so every change made before the call is either on disk or in a taken page.
+   * @return the taken pages, in no particular order
+   */
+  std::vector<DirtyFrame> BeginFlush();
+
+  /**
+   * Writes pages taken by BeginFlush, FLUSH_STAGING_PAGES at a time. Each page is first copied to a staging buffer
+   * without waiting for its latch, and only a consistent copy goes to disk, one DiskManager::WritePages call per run of
+   * consecutive page ids. A page that writers kept latched, or that a writer latched after its copy, is left with
+   * clean_ unset, so EndFlush marks it dirty again.
+   * @param disk_manager the disk manager the pages belong to
+   * @param frames the pages, sorted by page id
+   * @param num_frames the number of pages
+   * @param disk_scheduler if not nullptr, the copies are queued on it as background writes instead, and the scheduler
+   * coalesces the runs
+   */
+  static void WriteDirtyFrames(DiskManager *disk_manager, DirtyFrame *frames, size_t num_frames,
+                               DiskScheduler *disk_scheduler = nullptr);
+
+  /**
+   * Releases the frames BeginFlush took. Pages owned by other instances of a parallel pool are skipped, so every
+   * instance can be handed the pages of the whole pool.
+   * @param frames pages taken by BeginFlush and written by WriteDirtyFrames
+   */
+  void EndFlush(const std::vector<DirtyFrame> &frames);
 
  protected:
   /**
@@ -66,6 +186,14 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   Page *FetchPgImp(page_id_t page_id) override;
 
+  /**
+   * Fetch the requested page, recycling frames from the given ring on a miss.
+   * @param page_id id of page to be fetched
+   * @param ring the scan's buffer ring
+   * @return the requested page
+   */
+  Page *FetchPgForScanImp(page_id_t page_id, BufferRing *ring) override;
+
   /**
    * Unpin the target page from the buffer pool.
    * @param page_id id of page to be unpinned
@@ -75,7 +203,48 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   bool UnpinPgImp(page_id_t page_id, bool is_dirty) override;
 
   /**
-   * Flushes the target page to disk.
+   * Unpin a page given the frame that holds it. The frame id is stored in the page.
+   * @param page the pinned page
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  bool UnpinFrameImp(Page *page, bool is_dirty) override;
+
+  /**
+   * Queue pages for the prefetch thread, starting it on first use. Requests beyond pool_size queued pages are dropped.
+   * @param page_ids ids of the pages to load
+   * @param on_loaded called for each page once it is in memory; may be empty
+   */
+  void PrefetchPgsImp(const std::vector<page_id_t> &page_ids, const PrefetchCallback &on_loaded) override;
+
+  /** Body of the prefetch thread: load queued pages in batches with PrefetchBatch. */
+  void PrefetchLoop();
+
+  struct PrefetchRequest {
+    page_id_t page_id_;
+    PrefetchCallback on_loaded_;
+  };
+
+  /**
+   * Load a batch of prefetch requests, run their callbacks and leave the pages unpinned. The pages that are not
+   * resident get a frame each, and all of their reads go to the disk manager's Submit, or to the disk scheduler, at
+   * once. Each frame becomes usable as soon as its own read is done.
+   * @param lock the caller's lock on latch_, held on entry and on return
+   * @param batch the requests, in the order their callbacks run
+   */
+  void PrefetchBatch(std::unique_lock<std::mutex> *lock, const std::vector<PrefetchRequest> &batch);
+
+  /**
+   * Drop one pin on a frame. The caller must hold latch_.
+   * @param frame_id the frame to unpin
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the frame's pin count is <= 0 before this call, true otherwise
+   */
+  bool UnpinFrameLocked(frame_id_t frame_id, bool is_dirty);
+
+  /**
+   * Flushes the target page to disk. The write is not durable until the disk manager's Sync, so callers flushing
+   * several pages sync once after the last one.
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
    * @return false if the page could not be found in the page table, true otherwise
    */
@@ -96,23 +265,129 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   bool DeletePgImp(page_id_t page_id) override;
 
   /**
-   * Flushes all the pages in the buffer pool to disk.
+   * Flushes the dirty pages in the buffer pool to disk in page id order, coalescing consecutive pages into vectored
+   * writes, then syncs the database file once.
    */
   void FlushAllPgsImp() override;
 
   /**
-   * Allocate a page on disk.∂
+   * Allocate a page on disk. Pages this instance owns that were deallocated are reused before the file grows, as long
+   * as they are below next_page_id_, so that a reused id is never handed out again as a new one.
+   * @param[out] reused set to true if the page was deallocated before, so its old content is still on disk
    * @return the id of the allocated page
    */
-  page_id_t AllocatePage();
+  page_id_t AllocatePage(bool *reused);
 
   /**
    * Deallocate a page on disk.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track deallocated pages
-  }
+  void DeallocatePage(page_id_t page_id) { disk_manager_->DeallocatePage(page_id); }
+
+  /**
+   * Fetch the requested page. On a miss the frame comes from the ring if one is given, otherwise from the free list
+   * or the replacer.
+   * @param page_id id of page to be fetched
+   * @param ring the scan's buffer ring, or nullptr
+   * @param prefetch true if the prefetcher fetches the page, which is then neither counted as a hit or a miss nor as an
+   * access by the replacer
+   * @return the requested page, nullptr if every frame is pinned
+   */
+  Page *FetchPageThroughRing(page_id_t page_id, BufferRing *ring, bool prefetch = false);
+
+  /**
+   * Pick a frame for an incoming page: the free list first, then a victim from the replacer.
+   * The victim still holds its old page; LoadFrame evicts it. The caller must hold latch_.
+   * @param[out] frame_id id of the chosen frame
+   * @return the chosen frame, nullptr if every frame is pinned
+   */
+  Page *AcquireFrame(frame_id_t *frame_id);
+
+  /**
+   * Pick a frame for an incoming page from the scan's ring. Until the ring is full, or whenever the next ring frame
+   * has been reused or pinned by someone else, the frame comes from AcquireFrame and takes that slot of the ring.
+   * The caller must hold latch_.
+   * @param ring the scan's buffer ring
+   * @param page_id id of the page that will be loaded into the frame
+   * @param[out] frame_id id of the chosen frame
+   * @return the chosen frame, nullptr if every frame is pinned
+   */
+  Page *AcquireRingFrame(BufferRing *ring, page_id_t page_id, frame_id_t *frame_id);
+
+  /**
+   * Move a frame chosen by AcquireFrame or AcquireRingFrame over to page_id and return it pinned once.
+   * The frame's old page leaves the page table and is written back if dirty, then the new page is read from disk or
+   * zeroed. Both I/Os run with latch_ released while the frame is marked as having I/O in progress.
+   * @param lock the caller's lock on latch_, held on entry and on return
+   * @param frame_id the frame to load
+   * @param page_id the page that moves into the frame
+   * @param read_from_disk true to read the page's content from disk, false to start from a zeroed page
+   * @param record_access false if the page is only read ahead, so the replacer must not count the load as an access
+   */
+  void LoadFrame(std::unique_lock<std::mutex> *lock, frame_id_t frame_id, page_id_t page_id, bool read_from_disk,
+                 bool record_access);
+
+  /** A frame between BeginLoad and FinishLoad. */
+  struct FrameLoad {
+    frame_id_t frame_id_;
+    Page *page_;
+    /** The page that moves into the frame. */
+    page_id_t page_id_;
+    /** The page the frame held before, INVALID_PAGE_ID if it was free. */
+    page_id_t old_page_id_;
+    /** True if the old page is dirty and the loader must write it back before reading the new one. */
+    bool write_back_;
+    /** True if the page cleaner was writing the old page out, which BeginLoad waited for. */
+    bool cleaning_;
+  };
+
+  /**
+   * The part of LoadFrame before the I/O: move the frame over to page_id, pinned once and marked as having I/O in
+   * progress. The caller holds latch_, which may be released while a write by the page cleaner finishes.
+   * @param record_access false if the page is only read ahead, so the replacer must not count the load as an access
+   * @return what the caller needs to do the I/O and then call FinishLoad
+   */
+  FrameLoad BeginLoad(std::unique_lock<std::mutex> *lock, frame_id_t frame_id, page_id_t page_id, bool record_access);
+
+  /** The part of LoadFrame after the I/O: make the frame usable and wake its waiters. The caller holds latch_. */
+  void FinishLoad(const FrameLoad &load);
+
+  /** Reads a page through the disk scheduler or the disk manager, counting the read and its time. */
+  void ReadFromDisk(page_id_t page_id, char *page_data);
+
+  /**
+   * Writes a page through the disk scheduler or the disk manager, counting the write and its time.
+   * @param priority the scheduler priority; BACKGROUND only where no latch_ is held, since the write may be throttled
+   */
+  void WriteToDisk(page_id_t page_id, const char *page_data, IoPriority priority = IoPriority::FOREGROUND);
+
+  /**
+   * Allocate frames up to pool_size in one chunk, if there are fewer, and put the frames from the current pool size up
+   * to pool_size on the free list. The caller must hold latch_.
+   * @param pool_size the new number of frames, at least the current one
+   */
+  void AddFrames(size_t pool_size);
+
+  /**
+   * Take the frames from pool_size up out of use, waiting for their pins and I/O to drain, and free the chunks that
+   * only hold retired frames.
+   * @param lock the caller's lock on latch_, held on entry and on return
+   * @param pool_size the new number of frames, below the current one
+   */
+  void RetireFrames(std::unique_lock<std::mutex> *lock, size_t pool_size);
+
+  /** @return a new, empty replacer of the given type for num_frames frames */
+  static Replacer *MakeReplacer(ReplacerType replacer_type, size_t num_frames);
+
+  /** Body of the page cleaner thread. */
+  void PageCleanerLoop();
+
+  /**
+   * Write back the dirty pages among the next eviction candidates, as many as it takes to have clean_target_ clean
+   * frames. Each write runs with latch_ released while its frame is marked as flushing.
+   * @param lock the caller's lock on latch_, held on entry and on return
+   */
+  void CleanPages(std::unique_lock<std::mutex> *lock);
 
   /**
    * Validate that the page_id being used is accessible to this BPI. This can be used in all of the functions to
@@ -121,8 +396,8 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void ValidatePageId(page_id_t page_id) const;
 
-  /** Number of pages in the buffer pool. */
-  const size_t pool_size_;
+  /** Number of frames in use. Only changed under latch_, but read without it. */
+  std::atomic<size_t> pool_size_{0};
   /** How many instances are in the parallel BPM (if present, otherwise just 1 BPI) */
   const uint32_t num_instances_ = 1;
   /** Index of this BPI in the parallel BPM (if present, otherwise just 0) */
@@ -130,19 +405,77 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** Each BPI maintains its own counter for page_ids to hand out, must ensure they mod back to its instance_index_ */
   std::atomic<page_id_t> next_page_id_ = instance_index_;
 
-  /** Array of buffer pool pages. */
-  Page *pages_;  // 这个才是真正的page缓存数组
+  /** Frames allocated together: their data in one arena and their metadata in one array of cache line aligned Pages. */
+  struct FrameChunk {
+    frame_id_t first_;
+    size_t size_;
+    std::unique_ptr<FrameArena> arena_;
+    std::unique_ptr<Page[]> pages_;
+  };
+  /** The allocated frames, in frame id order. A grow adds a chunk and a shrink frees the chunks it emptied. */
+  std::vector<FrameChunk> chunks_;
+  /** Every allocated frame by frame id. Frames from pool_size_ up are retired and empty. */
+  std::vector<Page *> frames_;  // 这个才是真正的page缓存数组
+  /** Serializes calls to Resize, which releases latch_ while a shrink drains. */
+  std::mutex resize_latch_;
+  /** Notified when a retired frame is unpinned or finishes its I/O, for a shrink waiting on it. */
+  std::condition_variable drain_cv_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
   LogManager *log_manager_ __attribute__((__unused__));
+  /** The scheduler page I/O goes through, or nullptr to go straight to disk_manager_. */
+  DiskScheduler *disk_scheduler_{nullptr};
   /** Page table for keeping track of buffer pool pages. */
   std::unordered_map<page_id_t, frame_id_t> page_table_;
   /** Replacer to find unpinned pages for replacement. */
   Replacer *replacer_;
   /** List of free pages. */
   std::list<frame_id_t> free_list_;  // 表示没有被占用的frame_id
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
+  /**
+   * Frames whose old page is being written back or whose new page is being read in. Such a frame is pinned and
+   * already mapped to its new page, but its data must not be used until the flag is cleared.
+   */
+  std::vector<bool> io_in_progress_;
+  /**
+   * Notified when the I/O on the frame with the same index finishes. Waiters wait on latch_. A deque, because it only
+   * ever grows and must not move the variables threads are waiting on.
+   */
+  std::deque<std::condition_variable> io_done_;
+  /**
+   * Frames the page cleaner or a flush is writing back. They stay readable, but they are not reloaded or reset until
+   * the write finishes.
+   */
+  std::vector<bool> flushing_;
+  /** Evicted dirty pages whose write-back has not finished yet, mapped to the frame that is writing them. */
+  std::unordered_map<page_id_t, frame_id_t> write_back_;
+  /** The page cleaner thread, if one was started. */
+  std::thread cleaner_thread_;
+  /** Set while the page cleaner should keep running. */
+  bool cleaner_running_ = false;
+  /** How many clean evictable frames the page cleaner tries to keep. */
+  size_t clean_target_ = 0;
+  /** Wakes the page cleaner early, when it is stopped or when an eviction had to write a page itself. */
+  std::condition_variable cleaner_cv_;
+  /** Frames with a non-zero pin count; only changed under latch_, read without it by HasAvailableFrame. */
+  std::atomic<size_t> pinned_frames_{0};
+  /** What this instance has done, for GetStats. */
+  BufferPoolCounters counters_;
+
+  /** Pages waiting for the prefetch thread, oldest first. */
+  std::deque<PrefetchRequest> prefetch_queue_;
+  /** The prefetch thread, started by the first prefetch request. */
+  std::thread prefetch_thread_;
+  /** Set while the prefetch thread should keep running. */
+  bool prefetch_running_ = false;
+  /** Set once StopPrefetcher was called, so that a late request cannot start the thread again. */
+  bool prefetch_stopped_ = false;
+  /** Wakes the prefetch thread when requests arrive or the instance shuts down. */
+  std::condition_variable prefetch_cv_;
+  /**
+   * Protects the page table, the free list, the frame metadata and the I/O state above. It is never held across
+   * disk I/O on the fetch and new page paths.
+   */
   std::mutex latch_;
 };
 }  // namespace bustub
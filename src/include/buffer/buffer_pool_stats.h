@@ -0,0 +1,116 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.h
+//
+// Identification: src/include/buffer/buffer_pool_stats.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * BufferPoolStats is a snapshot of what a buffer pool has done since it was created. For a ParallelBufferPoolManager
+ * it is the sum over all instances.
+ */
+struct BufferPoolStats {
+  /** Fetches that found the page resident, including scan fetches */
+  size_t hits_{0};
+  /** Fetches that had to read the page from disk */
+  size_t misses_{0};
+  /** Pages the prefetcher read from disk, for PrefetchPages or LoadWarmPages; neither hits nor misses */
+  size_t prefetched_{0};
+  /** Pages created by NewPage */
+  size_t new_pages_{0};
+  /** Resident pages replaced by another page without being written */
+  size_t clean_evictions_{0};
+  /** Resident pages replaced by another page after being written back by the evicting thread */
+  size_t dirty_evictions_{0};
+  /** Pages written by FlushPage and FlushAllPages */
+  size_t flushes_{0};
+  /** Dirty pages written back by the page cleaner */
+  size_t pages_cleaned_{0};
+  /** Pages read from the disk manager */
+  size_t disk_reads_{0};
+  /** Pages written to the disk manager, for any of the reasons above or by DeletePage */
+  size_t disk_writes_{0};
+  /** Time spent in the disk manager's ReadPage and WritePage */
+  std::chrono::nanoseconds disk_time_{0};
+  /** NewPage and FetchPage calls that returned nullptr because every frame was pinned */
+  size_t pin_failures_{0};
+
+  /** @return hits over hits plus misses, 0 if nothing was fetched */
+  double HitRatio() const {
+    return hits_ + misses_ == 0 ? 0 : static_cast<double>(hits_) / static_cast<double>(hits_ + misses_);
+  }
+
+  /** Adds that's counters to this snapshot. */
+  BufferPoolStats &operator+=(const BufferPoolStats &that) {
+    hits_ += that.hits_;
+    misses_ += that.misses_;
+    prefetched_ += that.prefetched_;
+    new_pages_ += that.new_pages_;
+    clean_evictions_ += that.clean_evictions_;
+    dirty_evictions_ += that.dirty_evictions_;
+    flushes_ += that.flushes_;
+    pages_cleaned_ += that.pages_cleaned_;
+    disk_reads_ += that.disk_reads_;
+    disk_writes_ += that.disk_writes_;
+    disk_time_ += that.disk_time_;
+    pin_failures_ += that.pin_failures_;
+    return *this;
+  }
+};
+
+/**
+ * BufferPoolCounters are the live counters behind BufferPoolStats. Every counter is a relaxed atomic, so bumping one
+ * costs a single uncontended atomic add and Snapshot() never takes the buffer pool latch. A snapshot taken while the
+ * pool is busy is not consistent across counters.
+ */
+struct BufferPoolCounters {
+  /** Adds one to a counter. */
+  static void Bump(std::atomic<size_t> *counter) { counter->fetch_add(1, std::memory_order_relaxed); }
+
+  /** @return the current value of every counter */
+  BufferPoolStats Snapshot() const {
+    BufferPoolStats stats;
+    stats.hits_ = hits_.load(std::memory_order_relaxed);
+    stats.misses_ = misses_.load(std::memory_order_relaxed);
+    stats.prefetched_ = prefetched_.load(std::memory_order_relaxed);
+    stats.new_pages_ = new_pages_.load(std::memory_order_relaxed);
+    stats.clean_evictions_ = clean_evictions_.load(std::memory_order_relaxed);
+    stats.dirty_evictions_ = dirty_evictions_.load(std::memory_order_relaxed);
+    stats.flushes_ = flushes_.load(std::memory_order_relaxed);
+    stats.pages_cleaned_ = pages_cleaned_.load(std::memory_order_relaxed);
+    stats.disk_reads_ = disk_reads_.load(std::memory_order_relaxed);
+    stats.disk_writes_ = disk_writes_.load(std::memory_order_relaxed);
+    stats.disk_time_ = std::chrono::nanoseconds(disk_time_ns_.load(std::memory_order_relaxed));
+    stats.pin_failures_ = pin_failures_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  std::atomic<size_t> hits_{0};
+  std::atomic<size_t> misses_{0};
+  std::atomic<size_t> prefetched_{0};
+  std::atomic<size_t> new_pages_{0};
+  std::atomic<size_t> clean_evictions_{0};
+  std::atomic<size_t> dirty_evictions_{0};
+  std::atomic<size_t> flushes_{0};
+  std::atomic<size_t> pages_cleaned_{0};
+  std::atomic<size_t> disk_reads_{0};
+  std::atomic<size_t> disk_writes_{0};
+  std::atomic<int64_t> disk_time_ns_{0};
+  std::atomic<size_t> pin_failures_{0};
+};
+
+}  // namespace bustub
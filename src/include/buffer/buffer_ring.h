@@ -0,0 +1,69 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_ring.h
+//
+// Identification: src/include/buffer/buffer_ring.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/** How a scan wants the buffer pool to treat the pages it reads. */
+enum class ScanStrategy {
+  /** Every page goes through the shared replacer like any other access. */
+  NORMAL,
+  /** Pages cycle through a small private ring of frames, so a large scan cannot flush the rest of the pool. */
+  BULK_READ
+};
+
+/**
+ * BufferRing is the private set of frames a bulk scan recycles. On a miss the buffer pool reuses the oldest frame of
+ * the ring instead of asking the replacer for a victim, as long as that frame still holds the page the scan left in
+ * it and nobody has it pinned. Otherwise a regular victim is taken and replaces that slot of the ring.
+ *
+ * A ring belongs to a single scan and is not thread safe. With a ParallelBufferPoolManager the ring keeps up to
+ * ring_size frames in every instance the scan touches.
+ */
+class BufferRing {
+  friend class BufferPoolManagerInstance;
+
+ public:
+  /**
+   * Creates an empty ring.
+   * @param ring_size the number of frames the scan may recycle per buffer pool instance
+   */
+  explicit BufferRing(size_t ring_size = SCAN_RING_SIZE) : ring_size_(ring_size) {}
+
+  /** @return the number of frames the scan may recycle per buffer pool instance */
+  size_t GetRingSize() const { return ring_size_; }
+
+ private:
+  struct Slot {
+    frame_id_t frame_id_;
+    /** The page the scan loaded into the frame; if the frame holds anything else it is no longer ours. */
+    page_id_t page_id_;
+  };
+
+  struct InstanceRing {
+    std::vector<Slot> slots_;
+    /** The slot that is recycled next once the ring is full. */
+    size_t next_{0};
+  };
+
+  const size_t ring_size_;
+  /** Ring slots keyed by the index of the buffer pool instance that owns the frames. */
+  std::unordered_map<uint32_t, InstanceRing> instances_;
+};
+
+}  // namespace bustub
@@ -12,8 +12,8 @@
 
 #pragma once
 
-#include <list>
-#include <mutex>  // NOLINT
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
 #include "buffer/replacer.h"
@@ -23,6 +23,10 @@ namespace bustub {
 
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the Least Recently Used policy.
+ *
+ * Each frame owns one atomic byte holding its evictable and reference bits, so Pin and Unpin are a single atomic
+ * store and never take a latch. Only Victim sweeps the clock hand; it claims a frame with a compare-and-swap, which
+ * fails if a concurrent Pin or Unpin changed the frame underneath it.
  */
 class ClockReplacer : public Replacer {
  public:
@@ -43,10 +47,23 @@ class ClockReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  std::vector<frame_id_t> EvictionCandidates(size_t max_frames) override;
+
+  /** @return the number of evictable frames. This scans every frame and is only meant for bookkeeping and tests. */
   size_t Size() override;
 
+  void Resize(size_t num_pages) override;
+
  private:
-  // TODO(student): implement me!
+  /** Set while the frame is unpinned and may be chosen as a victim. */
+  static constexpr uint8_t EVICTABLE = 0x1;
+  /** Set by Unpin, cleared by the first sweep of the hand that finds it: the frame's second chance. */
+  static constexpr uint8_t REFERENCED = 0x2;
+
+  size_t num_pages_;
+  std::vector<std::atomic<uint8_t>> frames_;
+  /** Position of the clock hand; only ever incremented, taken modulo num_pages_. */
+  std::atomic<size_t> hand_{0};
 };
 
 }  // namespace bustub
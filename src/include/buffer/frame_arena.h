@@ -0,0 +1,71 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.h
+//
+// Identification: src/include/buffer/frame_arena.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * FrameArena is one anonymous memory mapping that holds the data of a run of buffer pool frames back to back. Every
+ * frame starts on a PAGE_SIZE boundary, so frames can be handed to O_DIRECT I/O as they are, and the memory starts out
+ * zeroed.
+ *
+ * An arena of at least HUGE_PAGE_SIZE can be backed by transparent huge pages: it is then mapped on a HUGE_PAGE_SIZE
+ * boundary, rounded up to a whole number of huge pages, and madvise(MADV_HUGEPAGE) asks the kernel to use them. The
+ * kernel is free to ignore the advice, which only costs TLB reach.
+ */
+class FrameArena {
+ public:
+  /** The transparent huge page size on x86-64 and most arm64 kernels. */
+  static constexpr size_t HUGE_PAGE_SIZE = static_cast<size_t>(2) << 20;
+  static_assert(HUGE_PAGE_SIZE % PAGE_SIZE == 0, "frames must tile a huge page");
+
+  /**
+   * Maps the arena.
+   * @param num_frames the number of frames, at least 1
+   * @param huge_pages true to ask for transparent huge pages if the arena is large enough
+   * @throws Exception of type OUT_OF_MEMORY if the mapping fails
+   */
+  FrameArena(size_t num_frames, bool huge_pages);
+
+  /** Unmaps the arena. The frames' data must not be used afterwards. */
+  ~FrameArena();
+
+  DISALLOW_COPY_AND_MOVE(FrameArena);
+
+  /**
+   * @param index a frame index below GetNumFrames()
+   * @return the PAGE_SIZE bytes of that frame
+   */
+  char *GetFrameData(size_t index) { return data_ + index * PAGE_SIZE; }
+
+  /** @return the number of frames in the arena */
+  size_t GetNumFrames() const { return num_frames_; }
+
+  /** @return true if the kernel accepted the request for transparent huge pages */
+  bool IsHugePageAdvised() const { return huge_page_advised_; }
+
+ private:
+  /** The start of the first frame. */
+  char *data_{nullptr};
+  size_t num_frames_;
+  /** The length of the mapping at data_, a whole number of huge pages when they were asked for. */
+  size_t mapped_size_{0};
+  bool huge_page_advised_{false};
+};
+
+}  // namespace bustub
@@ -0,0 +1,101 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <deque>
+#include <mutex>  // NOLINT
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy.
+ *
+ * Every Pin counts as an access to the frame. The replacer remembers the timestamps of the last k accesses of each
+ * frame and evicts the evictable frame whose backward k-distance (now minus the timestamp of the k-th most recent
+ * access) is the largest. A frame with fewer than k recorded accesses has an infinite backward k-distance; ties
+ * between such frames are broken by classic LRU on their earliest access. Frames touched only once, such as the pages
+ * of a sequential scan, are therefore evicted before frames that are touched repeatedly.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param k the number of historical accesses to keep per frame
+   */
+  explicit LRUKReplacer(size_t num_pages, size_t k = LRUK_REPLACER_K);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  bool Victim(frame_id_t *frame_id) override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void PinWithoutAccess(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  std::vector<frame_id_t> EvictionCandidates(size_t max_frames) override;
+
+  size_t Size() override;
+
+  void Resize(size_t num_pages) override;
+
+ private:
+  /** (has k accesses, timestamp) - frames with an infinite k-distance order before all others. */
+  using EvictionKey = std::pair<bool, size_t>;
+
+  struct FrameInfo {
+    /** Timestamps of the most recent accesses, oldest first, at most k of them. */
+    std::deque<size_t> history_;
+    bool evictable_{false};
+    /**
+     * True while history_ only holds the position Unpin gave a frame that was never accessed, e.g. a page that was
+     * read ahead. The first real access replaces it, so that read-ahead does not count towards the k accesses.
+     */
+    bool placeholder_{false};
+  };
+
+  /** @return the key the frame is ordered by while it sits in evictable_ */
+  EvictionKey KeyOf(frame_id_t frame_id) const;
+
+  /** Takes the frame out of evictable_ if it is there. */
+  void MakeUnevictable(frame_id_t frame_id);
+
+  /** Appends the current timestamp to the frame's history. The frame must not be in evictable_. */
+  void RecordAccess(frame_id_t frame_id);
+
+  const size_t k_;
+  /** Logical clock, bumped on every recorded access. */
+  size_t current_timestamp_{0};
+  std::vector<FrameInfo> frames_;
+  /**
+   * Evictable frames ordered by eviction priority. A frame's history only changes while it is pinned, so its key is
+   * stable for as long as it is in this set.
+   */
+  std::set<std::pair<EvictionKey, frame_id_t>> evictable_;
+  std::mutex latch_;
+};
+
+}  // namespace bustub
@@ -44,8 +44,12 @@ class LRUReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  std::vector<frame_id_t> EvictionCandidates(size_t max_frames) override;
+
   size_t Size() override;
 
+  void Resize(size_t num_pages) override;
+
  private:
   // TODO(student): implement me!
   // const size_t capacity_; lru牺牲队列的最大容量
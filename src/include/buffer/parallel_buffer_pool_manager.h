@@ -12,6 +12,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
@@ -19,6 +22,8 @@
 
 namespace bustub {
 
+class BufferPoolManagerInstance;
+
 class ParallelBufferPoolManager : public BufferPoolManager {
  public:
   /**
@@ -27,9 +32,10 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    * @param pool_size the pool size of each BufferPoolManagerInstance    
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy of every BufferPoolManagerInstance
    */
   ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                            LogManager *log_manager = nullptr);
+                            LogManager *log_manager = nullptr, ReplacerType replacer_type = ReplacerType::LRU);
 
   /**
    * Destroys an existing ParallelBufferPoolManager.
@@ -39,6 +45,41 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override;
 
+  /** @return the sum of the counters of all instances */
+  BufferPoolStats GetStats() override;
+
+  /**
+   * @param instance_index index of an instance
+   * @return the counters of that instance alone, to spot an instance that gets more than its share of the load
+   */
+  BufferPoolStats GetInstanceStats(size_t instance_index);
+
+  /** Starts the page cleaner of every instance. */
+  void RunPageCleaner(size_t clean_target) override;
+
+  /** Stops the page cleaner of every instance. */
+  void StopPageCleaner() override;
+
+  /** Records the resident pages of every instance, each in its own file. */
+  void SaveWarmPages() override;
+
+  /** Reloads the pages recorded by every instance. */
+  void LoadWarmPages(size_t warm_percent) override;
+
+  /**
+   * Resizes every instance to pool_size frames, one instance at a time. The number of instances never changes, so
+   * every page keeps living in the instance page_id % num_instances.
+   * @param pool_size the new number of frames of each instance
+   * @return false if pool_size is 0
+   */
+  bool Resize(size_t pool_size) override;
+
+  /** Sends the page I/O of every instance through disk_scheduler. */
+  void SetDiskScheduler(DiskScheduler *disk_scheduler) override;
+
+  /** Makes the page ids of every instance continue after the end of the database file. */
+  void ContinuePageIds() override;
+
  protected:
   /**
    * @param page_id id of page
@@ -53,6 +94,14 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   Page *FetchPgImp(page_id_t page_id) override;
 
+  /**
+   * Fetch the requested page, recycling frames from the given ring on a miss.
+   * @param page_id id of page to be fetched
+   * @param ring the scan's buffer ring
+   * @return the requested page
+   */
+  Page *FetchPgForScanImp(page_id_t page_id, BufferRing *ring) override;
+
   /**
    * Unpin the target page from the buffer pool.
    * @param page_id id of page to be unpinned
@@ -61,6 +110,21 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   bool UnpinPgImp(page_id_t page_id, bool is_dirty) override;
 
+  /**
+   * Unpin a page given the frame that holds it, in the instance that owns the page.
+   * @param page the pinned page
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  bool UnpinFrameImp(Page *page, bool is_dirty) override;
+
+  /**
+   * Queue each page for background loading in the instance that owns it.
+   * @param page_ids ids of the pages to load
+   * @param on_loaded called for each page once it is in memory; may be empty
+   */
+  void PrefetchPgsImp(const std::vector<page_id_t> &page_ids, const PrefetchCallback &on_loaded) override;
+
   /**
    * Flushes the target page to disk.
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
@@ -69,7 +133,8 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   bool FlushPgImp(page_id_t page_id) override;
 
   /**
-   * Creates a new page in the buffer pool.
+   * Creates a new page in the buffer pool. Instances are tried round robin from a lock-free cursor, skipping the ones
+   * whose frames are all pinned.
    * @param[out] page_id id of created page
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
@@ -83,15 +148,21 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   bool DeletePgImp(page_id_t page_id) override;
 
   /**
-   * Flushes all the pages in the buffer pool to disk.
+   * Flushes the dirty pages of all instances to disk. The pages are merged and sorted by page id, so consecutive pages
+   * of different instances go out in one vectored write, and every instance's share is written by its own thread.
+   * The database file is synced once at the end.
    */
   void FlushAllPgsImp() override;
 
  private:
-  BufferPoolManager **managers_;
+  BufferPoolManagerInstance **managers_;
   size_t num_instances_;
-  size_t pool_size_;
-  std::mutex latch_;
-  size_t next_instance_;
+  /** The disk manager all instances share, for flushing them together. */
+  DiskManager *disk_manager_;
+  /** The scheduler the instances use, or nullptr. */
+  DiskScheduler *disk_scheduler_{nullptr};
+  std::atomic<size_t> pool_size_;
+  /** The instance the next NewPage starts at; only ever incremented, so it is taken modulo num_instances_. */
+  std::atomic<size_t> next_instance_{0};
 };
 }  // namespace bustub
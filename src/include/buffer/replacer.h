@@ -12,10 +12,15 @@
 
 #pragma once
 
+#include <vector>
+
 #include "common/config.h"
 
 namespace bustub {
 
+/** The replacement policies a buffer pool can be configured with. */
+enum class ReplacerType { LRU, LRU_K, CLOCK };
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -37,14 +42,42 @@ class Replacer {
    */
   virtual void Pin(frame_id_t frame_id) = 0;
 
+  /**
+   * Pins a frame like Pin, but without counting it as an access to its page, e.g. because the page is only being read
+   * ahead and nobody has asked for it yet. Policies that keep no access history just pin the frame.
+   * @param frame_id the id of the frame to pin
+   */
+  virtual void PinWithoutAccess(frame_id_t frame_id) { Pin(frame_id); }
+
   /**
    * Unpins a frame, indicating that it can now be victimized.
    * @param frame_id the id of the frame to unpin
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Drops everything the replacer knows about a frame, e.g. because its page was deleted and the frame is going back
+   * to the free list. Policies that keep per-frame history must forget it here.
+   * @param frame_id the id of the frame to remove
+   */
+  virtual void Remove(frame_id_t frame_id) { Pin(frame_id); }
+
+  /**
+   * Peeks at the frames that would be victimized next, without removing them.
+   * @param max_frames the maximum number of frames to return
+   * @return up to max_frames evictable frames, the next victim first
+   */
+  virtual std::vector<frame_id_t> EvictionCandidates(size_t max_frames) = 0;
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual size_t Size() = 0;
+
+  /**
+   * Grows or shrinks the replacer to num_frames frames in place. What it knows about the frames below num_frames is
+   * kept; frames at or above it are forgotten. Must not run concurrently with any other call.
+   * @param num_frames the new number of frames
+   */
+  virtual void Resize(size_t num_frames) = 0;
 };
 
 }  // namespace bustub
@@ -23,7 +23,16 @@ namespace bustub {
 
 class BustubInstance {
  public:
-  explicit BustubInstance(const std::string &db_file_name) {
+  /**
+   * @param db_file_name the database file
+   * @param pool_size the number of buffer pool frames, which ResizeBufferPool can change later
+   * @param warm_percent how much of the pool to reload, in the background, from the pages that were resident when
+   * this database was last shut down. 0, the default, turns warm restart off: nothing is reloaded, and the resident
+   * pages are not recorded at shutdown either.
+   */
+  explicit BustubInstance(const std::string &db_file_name, size_t pool_size = BUFFER_POOL_SIZE,
+                          size_t warm_percent = WARM_POOL_PERCENT)
+      : warm_percent_(warm_percent) {
     enable_logging = false;
 
     // storage related
@@ -32,7 +41,10 @@ class BustubInstance {
     // log related
     log_manager_ = new LogManager(disk_manager_);
 
-    buffer_pool_manager_ = new BufferPoolManagerInstance(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
+    buffer_pool_manager_ = new BufferPoolManagerInstance(pool_size, disk_manager_, log_manager_);
+    if (warm_percent_ > 0) {
+      buffer_pool_manager_->LoadWarmPages(warm_percent_);
+    }
 
     // txn related
     lock_manager_ = new LockManager();
@@ -46,6 +58,10 @@ class BustubInstance {
     if (enable_logging) {
       log_manager_->StopFlushThread();
     }
+    buffer_pool_manager_->StopPageCleaner();
+    if (warm_percent_ > 0) {
+      buffer_pool_manager_->SaveWarmPages();
+    }
     delete checkpoint_manager_;
     delete log_manager_;
     delete buffer_pool_manager_;
@@ -54,12 +70,32 @@ class BustubInstance {
     delete disk_manager_;
   }
 
+  /**
+   * Starts writing dirty pages back in the background, ahead of their eviction.
+   * @param clean_target the number of clean evictable frames to keep available
+   */
+  void RunPageCleaner(size_t clean_target = PAGE_CLEANER_TARGET) { buffer_pool_manager_->RunPageCleaner(clean_target); }
+
+  /** Stops the background page cleaner. */
+  void StopPageCleaner() { buffer_pool_manager_->StopPageCleaner(); }
+
+  /**
+   * Grows or shrinks the buffer pool without restarting. Must not be called while this thread holds pinned pages.
+   * @param pool_size the new number of buffer pool frames
+   * @return false if pool_size is 0
+   */
+  bool ResizeBufferPool(size_t pool_size) { return buffer_pool_manager_->Resize(pool_size); }
+
   DiskManager *disk_manager_;
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   TransactionManager *transaction_manager_;
   LogManager *log_manager_;
   CheckpointManager *checkpoint_manager_;
+
+ private:
+  /** Share of the pool reloaded at startup, 0 if warm restart is off. */
+  size_t warm_percent_;
 };
 
 }  // namespace bustub
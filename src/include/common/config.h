@@ -16,6 +16,14 @@
 #include <chrono>  // NOLINT
 #include <cstdint>
 
+/**
+ * The size of a database page in bytes, set with the BUSTUB_PAGE_SIZE CMake option. Every page layout is derived from
+ * it, so a database file can only be opened by a build with the page size it was created with.
+ */
+#ifndef BUSTUB_PAGE_SIZE
+#define BUSTUB_PAGE_SIZE 4096
+#endif
+
 namespace bustub {
 
 /** Cycle detection is performed every CYCLE_DETECTION_INTERVAL milliseconds. */
@@ -27,14 +35,35 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** A running page cleaner looks for dirty eviction candidates every PAGE_CLEANER_INTERVAL milliseconds. */
+extern std::chrono::milliseconds page_cleaner_interval;
+
+/** True if buffer pool frame arenas of at least one huge page should ask for transparent huge pages. */
+extern std::atomic<bool> enable_huge_pages;
+
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
 static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
-static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
+static constexpr int PAGE_SIZE = BUSTUB_PAGE_SIZE;                            // size of a data page in byte
+static constexpr int CACHE_LINE_SIZE = 64;                                    // size of a cpu cache line in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int LRUK_REPLACER_K = 2;                                     // k used by the LRU-K replacer
+static constexpr int SCAN_RING_SIZE = 4;                                      // frames per instance in a scan ring
+static constexpr int PAGE_CLEANER_TARGET = 4;                                 // frames the page cleaner keeps clean
+static constexpr int WARM_POOL_PERCENT = 0;                                   // share of the pool a restart reloads
+static constexpr int OPTIMISTIC_READ_ATTEMPTS = 3;                            // optimistic reads before a read latch
+static constexpr int ASYNC_IO_QUEUE_DEPTH = 64;                               // most async disk requests in flight
+static constexpr int ASYNC_IO_WORKERS = 4;                                    // pread/pwrite threads without io_uring
+static constexpr int PREFETCH_BATCH_SIZE = 16;                                // pages the prefetcher reads at once
+static constexpr int DISK_SCHEDULER_WORKERS = 2;                              // requests a DiskScheduler runs at once
+static constexpr int FLUSH_STAGING_PAGES = 64;                                // pages a flush copies before writing
+
+// The hash table directory needs 4 KiB, and pages are copied through stack buffers of PAGE_SIZE bytes.
+static_assert(PAGE_SIZE >= 4096 && PAGE_SIZE <= 65536 && (PAGE_SIZE & (PAGE_SIZE - 1)) == 0,
+              "PAGE_SIZE must be a power of two from 4 KiB to 64 KiB");
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
@@ -122,21 +122,26 @@ class ExtendibleHashTable {
   inline uint32_t KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page);
 
   /**
-   * Fetches the directory page from the buffer pool manager.
+   * Returns the directory's page id, creating the directory and its first bucket on first use.
+   *
+   * @return the page_id of the directory page
+   */
+  page_id_t GetDirectoryPageId();
+
+  /**
+   * Fetches the directory page from the buffer pool manager. The caller must unpin it.
    *
    * @return a pointer to the directory page
    */
   HashTableDirectoryPage *FetchDirectoryPage();
 
   /**
-   * Fetches the a bucket page from the buffer pool manager using the bucket's page_id.
+   * Fetches the directory page from the buffer pool manager. The directory is protected by table_latch_, so the guard
+   * only holds the pin.
    *
-   * @param bucket_page_id the page_id to fetch
-   * @return a pointer to a bucket page
+   * @return a guard for the directory page
    */
-  Page *FetchBucketPage(page_id_t bucket_page_id);
-
-  HASH_TABLE_BUCKET_TYPE *RetrieveBucket(Page *page);
+  BasicPageGuard FetchDirectoryPageGuarded();
 
   /**
    * Performs insertion with an optional bucket splitting.
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include "buffer/buffer_ring.h"
 #include "catalog/catalog.h"
 #include "execution/expressions/abstract_expression.h"
 #include "execution/plans/abstract_plan.h"
@@ -29,9 +30,11 @@ class SeqScanPlanNode : public AbstractPlanNode {
    * @param output The output schema of this sequential scan plan node
    * @param predicate The predicate applied during the scan operation
    * @param table_oid The identifier of table to be scanned
+   * @param scan_strategy How the scan should use the buffer pool; BULK_READ keeps large scans in a private ring
    */
-  SeqScanPlanNode(const Schema *output, const AbstractExpression *predicate, table_oid_t table_oid)
-      : AbstractPlanNode(output, {}), predicate_{predicate}, table_oid_{table_oid} {}
+  SeqScanPlanNode(const Schema *output, const AbstractExpression *predicate, table_oid_t table_oid,
+                  ScanStrategy scan_strategy = ScanStrategy::NORMAL)
+      : AbstractPlanNode(output, {}), predicate_{predicate}, table_oid_{table_oid}, scan_strategy_{scan_strategy} {}
 
   /** @return The type of the plan node */
   PlanType GetType() const override { return PlanType::SeqScan; }
@@ -42,11 +45,16 @@ class SeqScanPlanNode : public AbstractPlanNode {
   /** @return The identifier of the table that should be scanned */
   table_oid_t GetTableOid() const { return table_oid_; }
 
+  /** @return How the scan should use the buffer pool */
+  ScanStrategy GetScanStrategy() const { return scan_strategy_; }
+
  private:
   /** The predicate that all returned tuples must satisfy */
   const AbstractExpression *predicate_;
   /** The table whose tuples should be scanned */
   table_oid_t table_oid_;
+  /** Whether the scan reads through a private buffer ring */
+  ScanStrategy scan_strategy_;
 };
 
 }  // namespace bustub
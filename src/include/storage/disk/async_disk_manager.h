@@ -0,0 +1,169 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.h
+//
+// Identification: src/include/storage/disk/async_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <future>  // NOLINT
+#include <mutex>   // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+#include "storage/disk/disk_request.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace bustub {
+
+/** How an AsyncDiskManager performs its I/O. */
+enum class AsyncIoBackend {
+  /** One io_uring instance; a batch of requests is submitted with a single system call. */
+  IO_URING,
+  /** ASYNC_IO_WORKERS threads doing pread and pwrite; used when io_uring is not available. */
+  THREAD_POOL
+};
+
+/**
+ * AsyncDiskManager reads and writes database pages without making the calling thread wait for the disk. Many requests
+ * can be in flight at once, up to the queue depth, and a batch of them costs one system call.
+ *
+ * ReadPage and WritePage keep their blocking contract by waiting for their own request, so a buffer pool on top of
+ * this disk manager has as many foreground misses in flight as threads missing at the same time. Callers that can
+ * overlap their own work use the future or callback versions, or Submit for a batch; the buffer pool's prefetch
+ * thread submits the reads of each batch of prefetched pages together.
+ *
+ * Everything else (the free-page bitmap, the log) is inherited from DiskManager unchanged.
+ */
+class AsyncDiskManager : public DiskManager {
+ public:
+  /**
+   * Opens the database file like DiskManager does and starts the I/O backend.
+   * ShutDown closes the file, so it must not be called while requests are in flight.
+   * @param db_file the file name of the database file
+   * @param backend the backend to use; IO_URING falls back to THREAD_POOL if the kernel refuses to set up a ring
+   * @param queue_depth the most requests in flight at once
+   * @param options the file layout, as for DiskManager
+   */
+  explicit AsyncDiskManager(const std::string &db_file, AsyncIoBackend backend = AsyncIoBackend::IO_URING,
+                            size_t queue_depth = ASYNC_IO_QUEUE_DEPTH,
+                            const DiskManagerOptions &options = DiskManagerOptions{});
+
+  /** Waits for every request in flight, then stops the backend. */
+  ~AsyncDiskManager() override;
+
+  /** Writes a page and waits for the write. */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /** Reads a page and waits for the read. */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /**
+   * Starts reading a page.
+   * @return a future that becomes true once the whole page is in page_data
+   */
+  std::future<bool> ReadPageAsync(page_id_t page_id, char *page_data);
+
+  /**
+   * Starts writing a page. page_data must not change until the returned future is ready.
+   * @return a future that becomes true once the whole page was written
+   */
+  std::future<bool> WritePageAsync(page_id_t page_id, const char *page_data);
+
+  /** Starts reading a page and calls callback when the read has finished. */
+  void ReadPageAsync(page_id_t page_id, char *page_data, DiskCallback callback);
+
+  /** Starts writing a page and calls callback when the write has finished. */
+  void WritePageAsync(page_id_t page_id, const char *page_data, DiskCallback callback);
+
+  /**
+   * Starts all requests at once: with io_uring they go to the kernel in as few system calls as the queue depth allows.
+   * Blocks only while the queue is full. Requests may finish in any order.
+   * @param requests the requests, each with a callback
+   */
+  void Submit(std::vector<DiskRequest> requests) override;
+
+  /** @return the backend in use, which is THREAD_POOL if io_uring was asked for but not available */
+  AsyncIoBackend GetBackend() const { return backend_; }
+
+ private:
+  /** A submitted request, alive until its completion was handled. */
+  struct InFlight;
+
+  /** Maps the rings of a new io_uring instance. @return false if the kernel does not support io_uring */
+  bool SetUpRing(unsigned queue_depth);
+  /** Unmaps the rings and closes the io_uring instance. */
+  void TearDownRing();
+  /**
+   * Queues one submission entry, a no-op that stops the completion thread if in_flight is nullptr. The caller holds
+   * submit_latch_ and has checked that there is room.
+   */
+  void PrepareSubmission(InFlight *in_flight);
+  /** Hands the prepared entries to the kernel. The caller holds submit_latch_. */
+  void EnterRing(unsigned to_submit);
+  /** Reaps completions until the shutdown entry completes, resubmitting the rest of short transfers. */
+  void CompletionLoop();
+  /** Takes requests off queue_ until the disk manager shuts down. */
+  void WorkerLoop();
+  /**
+   * Performs a request with pread or pwrite, going on after short transfers.
+   * @return the bytes transferred, fewer than PAGE_SIZE only if a read reached the end of the file, or -errno
+   */
+  ssize_t RunSync(const DiskRequest &request);
+  /**
+   * Zero-fills the rest of a read that reached the end of the file, counts a successful write and calls the request's
+   * callback.
+   * @param result the bytes transferred over all attempts, or -errno
+   */
+  void Complete(DiskRequest *request, ssize_t result);
+
+  AsyncIoBackend backend_;
+  /** The most requests in flight at once. */
+  size_t queue_depth_;
+  /** Requests handed to the backend that have not completed yet. */
+  size_t in_flight_{0};
+  /** Protects in_flight_, the submission ring and queue_. */
+  std::mutex submit_latch_;
+  /** Notified when a request completes, for submitters waiting for room and for the destructor. */
+  std::condition_variable room_cv_;
+
+  // io_uring state, see io_uring_setup(2).
+  int ring_fd_{-1};
+  void *sq_ring_{nullptr};
+  size_t sq_ring_size_{0};
+  void *cq_ring_{nullptr};
+  size_t cq_ring_size_{0};
+  io_uring_sqe *sqes_{nullptr};
+  size_t sqes_size_{0};
+  unsigned *sq_tail_{nullptr};
+  unsigned *sq_mask_{nullptr};
+  unsigned *sq_array_{nullptr};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned *cq_mask_{nullptr};
+  io_uring_cqe *cqes_{nullptr};
+  /** Reaps io_uring completions and runs their callbacks. */
+  std::thread completion_thread_;
+
+  // Thread pool state.
+  /** Requests waiting for a worker, oldest first. */
+  std::deque<DiskRequest> queue_;
+  /** Wakes the workers when requests arrive or the disk manager shuts down. */
+  std::condition_variable queue_cv_;
+  std::vector<std::thread> workers_;
+  bool stopping_{false};
+};
+
+}  // namespace bustub
@@ -0,0 +1,126 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_disk_manager.h
+//
+// Identification: src/include/storage/disk/compressed_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * CompressedDiskManager stores every page compressed with PageCodec, so that sparse pages cost less disk bandwidth than
+ * full ones.
+ *
+ * A compressed page goes into a slot of the database file whose size is the smallest of SLOT_SIZES that fits it; a
+ * page that does not compress below PAGE_SIZE is stored as it is in a PAGE_SIZE slot. Every slot is aligned to its
+ * size. The indirection map from page id to slot is kept in memory and written through to <db name>.map, one
+ * fixed-size entry per page id, so that it survives a restart.
+ *
+ * A page that is rewritten always moves to a new slot, even if it would fit its old one. The old slot stays pending
+ * until Sync has made the map that points elsewhere durable, and only then goes on the free list of its size class, so
+ * a slot that a synced map entry points to is never overwritten. Writes are only durable once Sync returns, though: a
+ * crash before it can leave a map entry written since the last Sync pointing at a slot whose new bytes never reached
+ * the disk, which then reads as whatever the slot held before. A page is never read and written at the same time by
+ * the buffer pool; other callers must not do so either, since a read could find its slot reused.
+ *
+ * The free-page bitmap and the log are inherited from DiskManager. Deallocating a page keeps its slot until the id is
+ * written again. Segments and direct I/O are not supported.
+ */
+class CompressedDiskManager : public DiskManager {
+ public:
+  /** Slot sizes in bytes, smallest first; the last one holds an uncompressed page. */
+  static constexpr std::array<uint32_t, 4> SLOT_SIZES = {PAGE_SIZE / 8, PAGE_SIZE / 4, PAGE_SIZE / 2, PAGE_SIZE};
+
+  /**
+   * Opens or creates the database file and its indirection map.
+   * @param db_file the file name of the database file
+   */
+  explicit CompressedDiskManager(const std::string &db_file);
+
+  /** Closes the indirection map. */
+  ~CompressedDiskManager() override;
+
+  /** Compresses a page into a new slot. */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /** Writes the pages one by one, since each one goes to its own slot. */
+  void WritePages(page_id_t first_page_id, const char *const *pages_data, size_t num_pages) override;
+
+  /**
+   * Reads a page's slot and decompresses it. A page that was never written reads as zeroes. A slot that cannot be
+   * read or decompressed also reads as zeroes, but is logged and counted in GetNumFailedReads.
+   */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /** Syncs the database file and the indirection map, then frees the slots that pages moved out of before it. */
+  bool Sync() override;
+
+  /** @return the bytes read from the database file, which are the compressed sizes of the pages read */
+  uint64_t GetBytesRead() const { return bytes_read_; }
+
+  /** @return the bytes written to the database file, which are the compressed sizes of the pages written */
+  uint64_t GetBytesWritten() const { return bytes_written_; }
+
+  /** @return the number of reads whose slot could not be read or decompressed */
+  uint64_t GetNumFailedReads() const { return num_failed_reads_; }
+
+  /** @return the size of the database file in bytes, as far as slots reach */
+  uint64_t GetFileEnd();
+
+ protected:
+  /** @return one past the highest page id in the indirection map */
+  page_id_t GetNumStoredPages() override;
+
+ private:
+  /** Where a page lives, as stored in the map file. A length of 0 means the page was never written. */
+  struct PageSlot {
+    uint64_t offset_;
+    /** The bytes of the slot in use; PAGE_SIZE if the page is stored uncompressed. */
+    uint32_t length_;
+    uint32_t slot_size_;
+  };
+
+  /** @return the index in SLOT_SIZES of the smallest slot that holds length bytes */
+  static size_t SizeClass(uint32_t length);
+  /** Takes a free slot of the size class or grows the file. The caller holds map_latch_. */
+  uint64_t AllocateSlot(size_t size_class);
+  /** Puts the aligned slots that tile [begin, end) on the free lists, largest first. The caller holds map_latch_. */
+  void AddFreeRange(uint64_t begin, uint64_t end);
+  /** Writes a page's entry through to the map file. The caller holds map_latch_. */
+  void PersistSlot(page_id_t page_id);
+
+  /** The indirection map file. */
+  int map_fd_{-1};
+  std::string map_name_;
+  /** Protects slots_, free_slots_, pending_free_slots_ and file_end_. */
+  std::mutex map_latch_;
+  /** The slot of every page id, indexed by page id. */
+  std::vector<PageSlot> slots_;
+  /** The offsets of free slots, one list per size class. */
+  std::array<std::vector<uint64_t>, SLOT_SIZES.size()> free_slots_;
+  /** Slots that pages moved out of since the last Sync, one list per size class; the map on disk may still use them. */
+  std::array<std::vector<uint64_t>, SLOT_SIZES.size()> pending_free_slots_;
+  /** The end of the last slot; new slots are cut from here. */
+  uint64_t file_end_{0};
+  std::atomic<uint64_t> bytes_read_{0};
+  std::atomic<uint64_t> bytes_written_{0};
+  std::atomic<uint64_t> num_failed_reads_{0};
+};
+
+}  // namespace bustub
@@ -12,48 +12,152 @@
 
 #pragma once
 
+#include <sys/types.h>
+
 #include <atomic>
 #include <fstream>
 #include <future>  // NOLINT
+#include <limits>
 #include <mutex>   // NOLINT
+#include <shared_mutex>
 #include <string>
+#include <vector>
 
 #include "common/config.h"
+#include "storage/disk/disk_request.h"
 
 namespace bustub {
 
+/** How DiskManager lays out the database on disk. */
+struct DiskManagerOptions {
+  /**
+   * Pages per segment file, or 0 to keep the whole database in one file. With segments, page p lives in segment
+   * p / segment_pages_: segment 0 is the database file itself and segment k > 0 is <database file>.<k>.
+   */
+  size_t segment_pages_{0};
+  /** True to reserve the disk space of every new segment up front with fallocate. */
+  bool preallocate_{true};
+  /**
+   * True to open the database files with O_DIRECT, so that pages are cached by the buffer pool only and not a second
+   * time in the page cache. Falls back to buffered I/O if the filesystem refuses O_DIRECT. Buffers that are not
+   * PAGE_SIZE aligned go through an aligned bounce buffer; buffer pool frames are aligned and need none. The async
+   * requests of AsyncDiskManager go to the kernel as they are, so their buffers must be aligned.
+   */
+  bool direct_io_{false};
+};
+
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * Pages are read and written with pread and pwrite on one file descriptor, so any number of threads can read and write
+ * different pages at the same time. A written page is handed to the operating system but not made durable; Sync makes
+ * every write before it durable, so callers can write many pages and pay for one sync.
+ *
+ * File offsets are 64-bit, so the database can grow to the full page id range. It can also be split into segment files
+ * of a fixed number of pages (see DiskManagerOptions): each segment is created when the first page in it is written,
+ * together with any missing segments before it, and has its disk space reserved up front if preallocate_ is set.
+ * Segments are never shrunk or removed; freed pages are reused through the free-page bitmap instead.
+ *
+ * Deallocated pages are tracked in a bitmap, one bit per page id, that is kept next to the database file in
+ * <db name>.free so that it survives a restart. The buffer pool takes page ids from the bitmap before growing the file.
  */
 class DiskManager {
  public:
   /**
-   * Creates a new disk manager that writes to the specified database file.
+   * Creates a new disk manager that writes to the specified database file. Reopening a segmented database must use
+   * the same segment size it was created with.
    * @param db_file the file name of the database file to write to
+   * @param options the file layout
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, const DiskManagerOptions &options = DiskManagerOptions{});
 
-  ~DiskManager() = default;
+  /** Closes the database files if ShutDown did not. */
+  virtual ~DiskManager();
 
   /**
-   * Shut down the disk manager and close all the file resources.
+   * Shut down the disk manager and close all the file resources. Syncs the database file first.
    */
   void ShutDown();
 
   /**
-   * Write a page to the database file.
+   * Write a page to the database file. The write is not durable until the next Sync.
    * @param page_id id of the page
    * @param page_data raw page data
    */
-  void WritePage(page_id_t page_id, const char *page_data);
+  virtual void WritePage(page_id_t page_id, const char *page_data);
+
+  /**
+   * Write a run of consecutive pages with as few system calls as possible: one pwritev per segment the run touches,
+   * at most IOV_MAX pages each. The writes are not durable until the next Sync.
+   * @param first_page_id id of the first page
+   * @param pages_data the data of page first_page_id + i at index i; the buffers need not be contiguous
+   * @param num_pages the number of pages
+   */
+  virtual void WritePages(page_id_t first_page_id, const char *const *pages_data, size_t num_pages);
 
   /**
-   * Read a page from the database file.
+   * Read a page from the database file. A page past the end of the file reads as zeroes.
    * @param page_id id of the page
    * @param[out] page_data output buffer
    */
-  void ReadPage(page_id_t page_id, char *page_data);
+  virtual void ReadPage(page_id_t page_id, char *page_data);
+
+  /**
+   * Perform a batch of page reads and writes, calling each request's callback when it is done. This version performs
+   * them one at a time with ReadPage and WritePage before it returns; AsyncDiskManager keeps the whole batch in flight
+   * at once.
+   * @param requests the requests
+   */
+  virtual void Submit(std::vector<DiskRequest> requests);
+
+  /**
+   * Make every page written so far durable, with fdatasync on the free-page bitmap and then on every segment.
+   * @return false if the sync failed
+   */
+  virtual bool Sync();
+
+  /**
+   * Mark a page as free so that a later allocation can reuse its id. Deallocating a free page does nothing.
+   * @param page_id id of the page
+   */
+  void DeallocatePage(page_id_t page_id);
+
+  /**
+   * Take a free page out of the free-page bitmap. Only page ids with page_id % stride == offset are considered, so that
+   * every buffer pool instance gets back a page it owns. The bitmap is synced before the page is returned, so the page
+   * cannot come back as free after a crash once its new content is on disk.
+   * @param stride the number of buffer pool instances
+   * @param offset the index of the buffer pool instance that allocates the page
+   * @param limit only page ids below limit are considered
+   * @return the id of a reused page, or INVALID_PAGE_ID if there is no free page in the stripe
+   */
+  page_id_t ReuseFreePage(uint32_t stride, uint32_t offset, page_id_t limit = std::numeric_limits<page_id_t>::max());
+
+  /**
+   * Take a page out of the free-page bitmap if it is there, for a page id handed out without ReuseFreePage.
+   * @param page_id id of the page
+   * @return true if the page was free, so its old content may still be on disk
+   */
+  bool ClaimPage(page_id_t page_id);
+
+  /** @return the number of free pages waiting to be reused */
+  size_t GetNumFreePages();
+
+  /** @return one past the highest page id the database file holds or the free-page bitmap has freed */
+  page_id_t GetNumPages();
+
+  /** @return true if the page was deallocated and not reused since */
+  bool IsFreePage(page_id_t page_id);
+
+  /** @return the name of the database file */
+  const std::string &GetFileName() const { return file_name_; }
+
+  /** @return the number of segment files, 1 if the database is not segmented */
+  size_t GetNumSegments();
+
+  /** @return true if every database file was opened with O_DIRECT */
+  bool IsDirectIo() const { return options_.direct_io_ && !buffered_fallback_; }
 
   /**
    * Flush the entire log buffer into disk.
@@ -77,9 +181,12 @@ class DiskManager {
   /** @return true iff the in-memory content has not been flushed yet */
   bool GetFlushState() const;
 
-  /** @return the number of disk writes */
+  /** @return the number of page writes */
   int GetNumWrites() const;
 
+  /** @return the number of Sync calls */
+  int GetNumSyncs() const { return num_syncs_; }
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -89,20 +196,69 @@ class DiskManager {
   /** Checks if the non-blocking flush future was set. */
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
+ protected:
+  /**
+   * Finds the file and offset that hold a page. A write creates the page's segment if it does not exist yet.
+   * @param page_id id of the page
+   * @param for_write true if the page is about to be written
+   * @param[out] offset the byte offset of the page within the returned file
+   * @return the file descriptor, or -1 if a read falls in a segment that does not exist, which reads as zeroes
+   */
+  int LocatePage(page_id_t page_id, bool for_write, off_t *offset);
+
+  /** @return one past the highest page id the database files hold, without looking at the free-page bitmap */
+  virtual page_id_t GetNumStoredPages();
+
+  /** The database file (segment 0). Positional I/O has no shared cursor, so reads and writes need no latch. */
+  int db_fd_{-1};
+  std::atomic<int> num_writes_{0};
+  std::atomic<int> num_syncs_{0};
+
  private:
-  int GetFileSize(const std::string &file_name);
+  static int64_t GetFileSize(const std::string &file_name);
+  /**
+   * Opens a database file, with O_DIRECT if direct I/O is on, and buffered if the filesystem refuses O_DIRECT.
+   * @return the file descriptor, or -1
+   */
+  int OpenDataFile(const std::string &file_name, int flags);
+  /** @return the file name of a segment */
+  std::string GetSegmentName(size_t segment) const;
+  /**
+   * Creates and opens every segment up to and including the given one. The caller holds segments_latch_ exclusively.
+   * @return false if a segment could not be created
+   */
+  bool CreateSegments(size_t segment);
+  /** Closes every open segment. */
+  void CloseSegments();
+  /**
+   * The options the disk manager was created with. They never change afterwards: I/O runs without a latch, and files
+   * that did get O_DIRECT still need their unaligned buffers bounced after another file fell back to buffered I/O.
+   */
+  DiskManagerOptions options_;
+  /** Set once a database file had to be opened without O_DIRECT although direct I/O is on. */
+  std::atomic<bool> buffered_fallback_{false};
+  /** The open segment files, segment_fds_[i] for segment i; segments exist without gaps, and segment 0 is db_fd_. */
+  std::vector<int> segment_fds_;
+  /** Guards segment_fds_ of a segmented database, exclusively while a segment is created. */
+  std::shared_mutex segments_latch_;
+  /** Writes the byte of the free-page bitmap that holds page_id's bit. The caller holds free_pages_latch_. */
+  void PersistFreePageBit(page_id_t page_id);
+  /** Makes the bitmap file durable. The caller holds free_pages_latch_. @return false if the sync failed */
+  bool SyncFreePages();
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
   std::string file_name_;
   int num_flushes_;
-  int num_writes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
-  // With multiple buffer pool instances, need to protect file access
-  std::mutex db_io_latch_;
+  // free-page bitmap, bit i of byte i / 8 is set while page i is free
+  std::vector<uint8_t> free_pages_;
+  size_t num_free_pages_;
+  // the free-page bitmap file, opened on first use
+  int free_fd_{-1};
+  std::string free_name_;
+  std::mutex free_pages_latch_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,38 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_request.h
+//
+// Identification: src/include/storage/disk/disk_request.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <functional>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * Called once when a request has finished, on the thread that performed it.
+ * The argument is true if the whole page was transferred; reads past the end of the file count as whole pages of
+ * zeroes. A callback must not wait for another request of the same disk manager or scheduler.
+ */
+using DiskCallback = std::function<void(bool)>;
+
+/** One page read or write, for AsyncDiskManager and DiskScheduler. */
+struct DiskRequest {
+  /** True to write page_data_ to the page, false to read the page into page_data_. */
+  bool is_write_;
+  page_id_t page_id_;
+  /** PAGE_SIZE bytes that must stay valid, and for writes unchanged, until the callback runs. */
+  char *page_data_;
+  DiskCallback callback_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,202 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_scheduler.h
+//
+// Identification: src/include/storage/disk/disk_scheduler.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <future>  // NOLINT
+#include <list>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "common/macros.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/disk/disk_request.h"
+
+namespace bustub {
+
+/** Who is waiting for a disk request. Requests of a lower value are always served first. */
+enum class IoPriority {
+  /** Page misses and evictions a query is waiting for. */
+  FOREGROUND = 0,
+  /** Log writes, which commits wait for. */
+  LOG = 1,
+  /** Checkpoints, flushes and the page cleaner. Limited by the background bandwidth cap. */
+  BACKGROUND = 2
+};
+
+/** The number of IoPriority values, one queue each. */
+static constexpr size_t NUM_IO_PRIORITIES = 3;
+
+/** What one queue of a DiskScheduler has seen. */
+struct DiskQueueStats {
+  /** Requests submitted at this priority. */
+  uint64_t requests_{0};
+  /** Requests that were folded into one already queued for the same page, or served from a queued write. */
+  uint64_t merged_{0};
+  /** Disk operations performed for this queue; a run of background writes written together counts once. */
+  uint64_t operations_{0};
+  /** Entries waiting at the time of the snapshot. */
+  size_t depth_{0};
+  size_t max_depth_{0};
+  /** Time from queueing to the start of the disk operation, summed over operations. */
+  std::chrono::nanoseconds total_wait_{0};
+  std::chrono::nanoseconds max_wait_{0};
+
+  /** @return the mean wait per operation */
+  std::chrono::nanoseconds AverageWait() const {
+    return operations_ == 0 ? std::chrono::nanoseconds(0) : total_wait_ / static_cast<int64_t>(operations_);
+  }
+};
+
+/** A snapshot of DiskScheduler's counters. */
+struct DiskSchedulerStats {
+  /** Indexed by IoPriority. */
+  std::array<DiskQueueStats, NUM_IO_PRIORITIES> queues_;
+  /** Background operations that had to wait for the bandwidth cap. */
+  uint64_t throttled_{0};
+};
+
+/**
+ * DiskScheduler sits in front of a DiskManager and decides which request goes to the disk next. Its worker threads
+ * always take a foreground request before a log write, and a log write before a background request. Background
+ * requests are also held to a bandwidth cap, so checkpoints and the page cleaner cannot take the whole disk away from
+ * the queries.
+ *
+ * Requests for the same page are merged while they wait. A write replaces a queued write of the same page, since
+ * only the newest data needs to reach the disk. A read of a page with a queued write copies the write's data, so it
+ * never sees the disk from before that write. A read joins a queued read of the same page. A merged request moves
+ * up to the higher of the two priorities. Requests for one page run one at a time, in the order they were queued.
+ * Background writes of consecutive pages that are waiting together go to the disk in one DiskManager::WritePages.
+ *
+ * Log writes are appended in the order they were queued, one at a time.
+ */
+class DiskScheduler {
+ public:
+  /**
+   * Starts the worker threads.
+   * @param disk_manager the disk manager to forward requests to; it must outlive the scheduler
+   * @param num_workers the number of requests that can be at the disk at once
+   */
+  explicit DiskScheduler(DiskManager *disk_manager, size_t num_workers = DISK_SCHEDULER_WORKERS);
+
+  /** Finishes every queued request, ignoring the bandwidth cap, and joins the workers. */
+  ~DiskScheduler();
+
+  DISALLOW_COPY_AND_MOVE(DiskScheduler);
+
+  /**
+   * Queues a page read or write. The callback runs on a worker thread, or on the calling thread if a read is served
+   * from a queued write.
+   * @param request the request; page_data_ must stay valid, and for a write unchanged, until the callback runs
+   * @param priority who is waiting for it
+   */
+  void Schedule(DiskRequest request, IoPriority priority);
+
+  /**
+   * Queues a page read or write.
+   * @return a future that becomes true once the request is done
+   */
+  std::future<bool> Schedule(bool is_write, page_id_t page_id, char *page_data, IoPriority priority);
+
+  /**
+   * Queues an append to the log file, at LOG priority.
+   * @param log_data the log bytes; they must stay valid until the callback runs
+   * @param size the number of bytes
+   * @param callback called once the bytes were handed to DiskManager::WriteLog
+   */
+  void ScheduleLogWrite(char *log_data, int size, DiskCallback callback);
+
+  /**
+   * Caps the rate at which background requests go to the disk.
+   * @param bytes_per_second the cap, or 0 for no cap
+   */
+  void SetBackgroundBandwidth(size_t bytes_per_second);
+
+  /** @return the counters of every queue */
+  DiskSchedulerStats GetStats();
+
+ private:
+  /** Everything queued for one page, which is done in one visit to the disk: the read first, then the write. */
+  struct PageEntry {
+    page_id_t page_id_;
+    IoPriority priority_;
+    std::chrono::steady_clock::time_point queued_at_;
+    /** Buffers to read the page into, with their callbacks. The first one is read from disk, the others copied. */
+    std::vector<std::pair<char *, DiskCallback>> readers_;
+    /** The newest data to write after the read, or nullptr. */
+    char *write_data_{nullptr};
+    /** The callbacks of every write merged into this one. */
+    std::vector<DiskCallback> writers_;
+    /** The entry's position in queues_[priority_]. */
+    std::list<page_id_t>::iterator position_;
+  };
+
+  struct LogEntry {
+    char *log_data_;
+    int size_;
+    DiskCallback callback_;
+    std::chrono::steady_clock::time_point queued_at_;
+  };
+
+  /** What a worker took off the queues for one disk operation. */
+  struct Work;
+
+  void WorkerLoop();
+  /**
+   * Takes the next request allowed to run. The caller holds latch_.
+   * @param[out] work the request
+   * @param[out] wake_at set if the only runnable requests are background ones held back by the cap
+   * @return true if work was taken
+   */
+  bool TakeWork(Work *work, std::chrono::steady_clock::time_point *wake_at);
+  /** Takes the queued entry of a page. The caller holds latch_. */
+  PageEntry TakeEntry(page_id_t page_id);
+  /** Performs work and runs its callbacks, without the latch. */
+  void Perform(Work *work);
+  /** Moves an entry to a higher priority queue. The caller holds latch_. */
+  void Promote(PageEntry *entry, IoPriority priority);
+  /** Records a queue's new depth. The caller holds latch_. */
+  void UpdateDepth(IoPriority priority);
+  /** Records the wait of an operation that starts now. The caller holds latch_. */
+  void RecordWait(IoPriority priority, std::chrono::steady_clock::time_point queued_at);
+
+  DiskManager *disk_manager_;
+  /** Protects everything below. */
+  std::mutex latch_;
+  /** Wakes the workers when requests arrive, a page becomes free, or the scheduler stops. */
+  std::condition_variable work_cv_;
+  /** The pages waiting in each page queue, oldest first. The log queue is log_queue_. */
+  std::array<std::list<page_id_t>, NUM_IO_PRIORITIES> queues_;
+  /** The queued entry of every page that has one. */
+  std::unordered_map<page_id_t, PageEntry> entries_;
+  std::deque<LogEntry> log_queue_;
+  /** Pages a worker is reading or writing now; their next entry waits. */
+  std::unordered_set<page_id_t> pages_in_flight_;
+  bool log_in_flight_{false};
+  /** 0 for no cap. */
+  size_t background_bytes_per_second_{0};
+  /** When the next background operation may start under the cap. */
+  std::chrono::steady_clock::time_point next_background_{};
+  bool stopping_{false};
+  DiskSchedulerStats stats_;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,55 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_codec.h
+//
+// Identification: src/include/storage/disk/page_codec.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+namespace bustub {
+
+/**
+ * PageCodec is a small LZ77 compressor in the style of LZ4, fast enough to run on every page read and write.
+ *
+ * The compressed form is a series of sequences. Each starts with a token byte: its high nibble is the number of
+ * literal bytes that follow, its low nibble the length of the match after them minus 4. A nibble of 15 continues in
+ * extra bytes that are added up until one is below 255. The literals come next, then the match as a 2-byte
+ * little-endian distance back into the output. The last sequence has literals only.
+ *
+ * Runs of zeroes, which dominate sparse table pages and half-full buckets, become a few bytes each.
+ */
+class PageCodec {
+ public:
+  /** The shortest match worth encoding. */
+  static constexpr size_t MIN_MATCH = 4;
+
+  /**
+   * Compresses a buffer.
+   * @param src the bytes to compress, at most 64 KiB
+   * @param src_size the number of bytes
+   * @param[out] dst where the compressed bytes go
+   * @param dst_capacity the size of dst
+   * @return the compressed size, or 0 if it would not fit in dst_capacity
+   */
+  static size_t Compress(const char *src, size_t src_size, char *dst, size_t dst_capacity);
+
+  /**
+   * Decompresses what Compress produced. Malformed input is detected and never read or written out of bounds.
+   * @param src the compressed bytes
+   * @param src_size the number of compressed bytes
+   * @param[out] dst where the original bytes go
+   * @param dst_size the original size
+   * @return true if src decoded to exactly dst_size bytes
+   */
+  static bool Decompress(const char *src, size_t src_size, char *dst, size_t dst_size);
+};
+
+}  // namespace bustub
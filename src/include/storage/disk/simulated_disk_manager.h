@@ -0,0 +1,139 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// simulated_disk_manager.h
+//
+// Identification: src/include/storage/disk/simulated_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/** The timing of a storage device, as SimulatedDiskManager plays it. */
+struct DiskProfile {
+  /** Time from issuing a read until its data starts to flow. */
+  std::chrono::nanoseconds read_latency_;
+  /** Time from issuing a write until its data starts to flow. */
+  std::chrono::nanoseconds write_latency_;
+  /** Added to a request that does not start at the page after the previous request's last one: seek and rotation. */
+  std::chrono::nanoseconds seek_time_;
+  /** Time a Sync takes once every request before it has finished. */
+  std::chrono::nanoseconds sync_latency_;
+  /** Bytes per second the device transfers, shared by all requests in flight; 0 for no limit. */
+  uint64_t bandwidth_;
+  /** Requests the device works on at once; later ones queue. */
+  size_t parallelism_;
+
+  /** A datacenter NVMe SSD: tens of microseconds, a few GB/s, a deep queue. */
+  static DiskProfile Nvme();
+
+  /** A SATA SSD: about 100 microseconds, 550 MB/s, a modest queue. */
+  static DiskProfile SataSsd();
+
+  /** A 7200 rpm disk: cheap sequential access, 8 ms for every seek, one request at a time. */
+  static DiskProfile Hdd();
+
+  /**
+   * A device that takes the same time for every request, however many are in flight, with no bandwidth limit; what a
+   * remote disk with a fixed round trip looks like.
+   */
+  static DiskProfile FixedLatency(std::chrono::nanoseconds latency);
+};
+
+/**
+ * SimulatedDiskManager keeps the database pages in memory and makes every read, write and sync take as long as it
+ * would on the device of a DiskProfile, so that benchmarks of the buffer pool and the indexes see realistic miss costs
+ * without a real device and without the page cache hiding them.
+ *
+ * The device is modelled as parallelism_ channels that each work on one request at a time, and one transfer path of
+ * bandwidth_ that they share. A request waits for a free channel, spends its latency (plus seek_time_ if it does not
+ * continue where the previous request ended), then waits for the transfer path and moves its bytes. WritePages pays
+ * the latency once for the whole run, which is where write coalescing wins. The calling thread sleeps for the
+ * request's simulated duration.
+ *
+ * The pages in the database file when the disk manager is created are loaded into memory first, so a database built
+ * with DiskManager can be benchmarked on a simulated device. Pages are never written back to the file. The free-page
+ * bitmap and the log are inherited from DiskManager unchanged.
+ */
+class SimulatedDiskManager : public DiskManager {
+ public:
+  /**
+   * Opens the database file like DiskManager does and loads its pages into memory.
+   * @param db_file the file name of the database file
+   * @param profile the device to simulate
+   */
+  SimulatedDiskManager(const std::string &db_file, const DiskProfile &profile);
+
+  /** Copies the page into memory after the write's simulated time. */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /** Copies the pages into memory after the time of one request that transfers all of them. */
+  void WritePages(page_id_t first_page_id, const char *const *pages_data, size_t num_pages) override;
+
+  /** Copies the page out of memory after the read's simulated time. A page never written reads as zeroes. */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /** Waits for every request issued before it, then for the sync latency. */
+  bool Sync() override;
+
+  /** @return the simulated device */
+  const DiskProfile &GetProfile() const { return profile_; }
+
+  /** @return the number of page reads */
+  uint64_t GetNumReads() const { return num_reads_; }
+
+  /** @return the number of requests that paid seek_time_ */
+  uint64_t GetNumSeeks() const { return num_seeks_; }
+
+ protected:
+  /** @return one past the highest page id held in memory */
+  page_id_t GetNumStoredPages() override;
+
+ private:
+  /**
+   * Books a request on the simulated device.
+   * @param first_page_id the first page of the request
+   * @param num_pages the pages it transfers
+   * @param latency the request's latency before any seek
+   * @return when the request completes
+   */
+  std::chrono::steady_clock::time_point Book(page_id_t first_page_id, size_t num_pages,
+                                             std::chrono::nanoseconds latency);
+  /** Sleeps until deadline, spinning the last stretch since sleeps overshoot by more than an NVMe latency. */
+  static void WaitUntil(std::chrono::steady_clock::time_point deadline);
+  /** @return the page's memory, allocated zeroed if it does not exist yet. The caller holds pages_latch_. */
+  char *GetPage(page_id_t page_id);
+
+  const DiskProfile profile_;
+  /** Protects the device state below. */
+  std::mutex device_latch_;
+  /** When each channel finishes its last booked request. */
+  std::vector<std::chrono::steady_clock::time_point> channels_;
+  /** When the transfer path finishes its last booked transfer. */
+  std::chrono::steady_clock::time_point transfer_free_{};
+  /** The page after the last one the previous request touched, where the head is. */
+  page_id_t next_page_{INVALID_PAGE_ID};
+  /** Protects pages_. */
+  std::mutex pages_latch_;
+  /** The pages, indexed by page id; nullptr for a page never written. */
+  std::vector<std::unique_ptr<char[]>> pages_;
+  std::atomic<uint64_t> num_reads_{0};
+  std::atomic<uint64_t> num_seeks_{0};
+};
+
+}  // namespace bustub
@@ -10,10 +10,13 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <atomic>
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
 #include <vector>
 
+#include "common/rwlatch.h"
 #include "concurrency/transaction.h"
 #include "storage/index/index_iterator.h"
 #include "storage/page/b_plus_tree_internal_page.h"
@@ -23,6 +26,9 @@ namespace bustub {
 
 #define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
 
+/** What a traversal is for; a write traversal keeps the latches on pages the operation may still change. */
+enum class Operation { FIND, INSERT, DELETE };
+
 /**
  * Main class providing the API for the Interactive B+ Tree.
  *
@@ -32,6 +38,19 @@ namespace bustub {
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ *
+ * The tree is safe to use from many threads. Readers latch pages top-down and let go of a parent as soon as they hold
+ * the child. Writers crab down with write latches and keep them in the transaction's page set; once a child is safe,
+ * meaning the operation cannot split or merge it, every latch above it is released. root_latch_ protects
+ * root_page_id_ and sits in the page set as a nullptr entry while a writer may still change the root.
+ *
+ * With optimistic lock coupling, which is on by default, traversals latch only the leaf. On the way down they read each
+ * internal page between Page::OptimisticRead and Page::Validate and start over if a writer got in between, so readers
+ * write nothing shared but pin counts. Inserts and removes that fit in their leaf go the same way with the leaf
+ * write-latched; a split or merge falls back to latch crabbing.
+ *
+ * A leaf splits once it holds leaf_max_size pairs, an internal page once it holds more than internal_max_size
+ * children, so an internal page needs room for one child more than its max size.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
@@ -40,7 +59,10 @@ class BPlusTree {
 
  public:
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE - 1);
+
+  // Deletes the pages whose deletion was deferred, if nobody has them pinned anymore
+  ~BPlusTree();
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
@@ -54,6 +76,9 @@ class BPlusTree {
   // return the value associated with a given key
   bool GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr);
 
+  // Choose optimistic lock coupling (the default) or latch crabbing for traversals
+  void SetOptimistic(bool optimistic) { optimistic_ = optimistic; }
+
   // index iterator
   INDEXITERATOR_TYPE Begin();
   INDEXITERATOR_TYPE Begin(const KeyType &key);
@@ -77,9 +102,37 @@ class BPlusTree {
   // read data from file and remove one by one
   void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
   // expose for test purpose
+  // Returns the leaf pinned and read-latched, nullptr if the tree is empty
   Page *FindLeafPage(const KeyType &key, bool leftMost = false);
 
  private:
+  // Crabs down to the leaf for key with read latches; returns the leaf pinned and read-latched, nullptr if empty
+  Page *FindLeafPageRead(const KeyType &key, bool leftMost);
+
+  // Looks for the leaf with optimistic lock coupling and latches it for reading, or for writing if exclusive.
+  // Returns nullptr if the tree is empty or writers kept getting in the way
+  Page *FindLeafPageOptimistic(const KeyType &key, bool leftMost, bool exclusive);
+
+  // One optimistic descent; returns false if a writer got in the way, otherwise the latched leaf or nullptr if empty
+  bool TryFindLeafPageOptimistic(const KeyType &key, bool leftMost, bool exclusive, Page **leaf);
+
+  // Crabs down to the leaf for key with write latches, leaving the unsafe path latched in the transaction's page set.
+  // The caller holds root_latch_ for writing, recorded as nullptr in the page set, and the tree is not empty
+  Page *FindLeafPageWrite(const KeyType &key, Operation op, Transaction *transaction);
+
+  // Returns true if op cannot split or merge node, so the latches above it can go
+  bool IsSafe(BPlusTreePage *node, Operation op) const;
+
+  // Releases every latch in the transaction's page set and unpins those pages, then deletes the deleted page set and
+  // any page whose deletion was deferred
+  void ReleaseWriteLatches(Transaction *transaction, bool is_dirty);
+
+  // Tries again to delete the pages a merge emptied while they were pinned
+  void DeleteDeferredPages();
+
+  // Fetches a page, throwing if the buffer pool has no frame for it
+  Page *FetchPageOrThrow(page_id_t page_id);
+
   void StartNewTree(const KeyType &key, const ValueType &value);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
@@ -111,7 +164,15 @@ class BPlusTree {
 
   // member variable
   std::string index_name_;
-  page_id_t root_page_id_;
+  mutable ReaderWriterLatch root_latch_;
+  // Written under root_latch_ and read without it by optimistic traversals
+  std::atomic<page_id_t> root_page_id_;
+  bool optimistic_{true};
+  // Pages a merge emptied while another thread still had them pinned, deleted once the pins are gone
+  std::mutex deferred_deletes_latch_;
+  std::vector<page_id_t> deferred_deletes_;
+  // Size of deferred_deletes_, so that releasing latches does not take deferred_deletes_latch_ while it is empty
+  std::atomic<size_t> num_deferred_deletes_{0};
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
@@ -19,25 +19,60 @@ namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+/**
+ * IndexIterator walks the leaf chain of a B+ tree in key order. It holds a pin and the read latch of the leaf it is
+ * on, and gives them up before it latches the next leaf: a writer merging two leaves latches the right one first, so
+ * holding both here could deadlock. An iterator is therefore not a snapshot; keys inserted or removed behind it by
+ * concurrent writers may or may not be seen.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
  public:
-  // you may define your own constructor based on your member variables
+  /** Creates the end iterator. */
   IndexIterator();
+
+  /**
+   * Takes over a pinned and read-latched leaf page and moves on to the first pair at or after index.
+   * @param buffer_pool_manager the buffer pool the page was pinned in
+   * @param page the leaf page, nullptr for the end iterator
+   * @param index the position in the leaf
+   */
+  IndexIterator(BufferPoolManager *buffer_pool_manager, Page *page, int index);
   ~IndexIterator();
 
+  IndexIterator(const IndexIterator &) = delete;
+  IndexIterator &operator=(const IndexIterator &) = delete;
+  IndexIterator(IndexIterator &&that) noexcept;
+  IndexIterator &operator=(IndexIterator &&that) noexcept;
+
   bool IsEnd();
 
   const MappingType &operator*();
 
   IndexIterator &operator++();
 
-  bool operator==(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator==(const IndexIterator &itr) const {
+    return page_ == nullptr ? itr.page_ == nullptr : page_ == itr.page_ && index_ == itr.index_;
+  }
 
-  bool operator!=(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator!=(const IndexIterator &itr) const { return !(*this == itr); }
 
  private:
-  // add your own private member variables here
+  /**
+   * Follows the leaf chain until the iterator is on a pair, or at the end.
+   * @throws Exception OUT_OF_MEMORY if the next leaf cannot be fetched; the iterator is then at the end
+   */
+  void SkipExhaustedLeaves();
+  /** Releases the leaf, if the iterator holds one, and becomes the end iterator. */
+  void Release();
+
+  BufferPoolManager *buffer_pool_manager_{nullptr};
+  /** The current leaf, pinned and read-latched; nullptr at the end. */
+  Page *page_{nullptr};
+  LeafPage *leaf_{nullptr};
+  int index_{0};
 };
 
 }  // namespace bustub
@@ -61,6 +61,11 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   void CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager);
   void CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
   void CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
+  void Adopt(const ValueType &child, BufferPoolManager *buffer_pool_manager);
   MappingType array_[0];
+
+  static_assert(sizeof(BPlusTreePage) == INTERNAL_PAGE_HEADER_SIZE,
+                "INTERNAL_PAGE_HEADER_SIZE must match the header fields");
+  static_assert(INTERNAL_PAGE_SIZE >= 3, "an internal page must hold enough children to split");
 };
 }  // namespace bustub
@@ -69,5 +69,9 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   void CopyFirstFrom(const MappingType &item);
   page_id_t next_page_id_;
   MappingType array_[0];
+
+  static_assert(sizeof(BPlusTreePage) + sizeof(page_id_t) == LEAF_PAGE_HEADER_SIZE,
+                "LEAF_PAGE_HEADER_SIZE must match the header fields");
+  static_assert(LEAF_PAGE_SIZE >= 3, "a leaf page must hold enough pairs to split");
 };
 }  // namespace bustub
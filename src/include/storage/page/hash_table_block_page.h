@@ -144,6 +144,9 @@ class HashTableBlockPage {
   // 0 if tombstone/brand new (never occupied), 1 otherwise.
   std::atomic_char readable_[(BLOCK_ARRAY_SIZE - 1) / 8 + 1];
   MappingType array_[0];
+
+  static_assert(HashTablePairPageSize(BLOCK_ARRAY_SIZE, sizeof(MappingType), alignof(MappingType)) <= PAGE_SIZE,
+                "a block page must fit in PAGE_SIZE");
 };
 
 }  // namespace bustub
@@ -47,6 +47,15 @@ class HashTableBucketPage {
    */
   bool GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result);
 
+  /**
+   * GetValue for a reader that holds no latch on the page and validates its version afterwards. Only the readable
+   * bitmap and the readable slots are read, each with relaxed atomic loads, so a concurrent writer can make the result
+   * wrong but cannot make the read a data race.
+   *
+   * @return true if at least one key matched
+   */
+  bool GetValueOptimistic(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) const;
+
   /**
    * Attempts to insert a key and value in the bucket.  Uses the occupied_
    * and readable_ arrays to keep track of each slot's availability.
@@ -154,6 +163,9 @@ class HashTableBucketPage {
   char readable_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
   // #define MappingType std::pair<KeyType, ValueType>
   MappingType array_[BUCKET_ARRAY_SIZE];
+
+  static_assert(HashTablePairPageSize(BUCKET_ARRAY_SIZE, sizeof(MappingType), alignof(MappingType)) <= PAGE_SIZE,
+                "a bucket page must fit in PAGE_SIZE");
 };
 
 }  // namespace bustub
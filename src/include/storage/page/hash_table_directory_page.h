@@ -194,4 +194,6 @@ class HashTableDirectoryPage {
   page_id_t bucket_page_ids_[DIRECTORY_ARRAY_SIZE];  // Array of bucket page_id_t
 };
 
+static_assert(sizeof(HashTableDirectoryPage) <= PAGE_SIZE, "the directory page must fit in PAGE_SIZE");
+
 }  // namespace bustub
@@ -97,4 +97,6 @@ class HashTableHeaderPage {
   __attribute__((unused)) page_id_t block_page_ids_[0];
 };
 
+static_assert(sizeof(HashTableHeaderPage) < PAGE_SIZE, "the header page must have room for block page ids");
+
 }  // namespace bustub
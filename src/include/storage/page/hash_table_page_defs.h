@@ -43,3 +43,18 @@
  * 表示一个bucket page能存多少个(key, value) pairs
  */
 #define BUCKET_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+
+namespace bustub {
+
+/**
+ * The bytes a block or bucket page takes: the occupied_ and readable_ bitmaps, padding up to the alignment of the
+ * pairs, then the pairs.
+ * @param num_pairs the number of (key, value) pairs, BLOCK_ARRAY_SIZE or BUCKET_ARRAY_SIZE
+ * @param pair_size sizeof(MappingType)
+ * @param pair_align alignof(MappingType)
+ */
+constexpr size_t HashTablePairPageSize(size_t num_pairs, size_t pair_size, size_t pair_align) {
+  return (2 * ((num_pairs - 1) / 8 + 1) + pair_align - 1) / pair_align * pair_align + num_pairs * pair_size;
+}
+
+}  // namespace bustub
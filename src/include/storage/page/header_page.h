@@ -47,5 +47,8 @@ class HeaderPage : public Page {
   int FindRecord(const std::string &name);
 
   void SetRecordCount(int record_count);
+
+  // The record count, then 36 bytes per record.
+  static_assert((PAGE_SIZE - 4) / 36 >= 100, "the header page must hold the records of 100 tables and indexes");
 };
 }  // namespace bustub
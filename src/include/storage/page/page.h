@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -24,14 +25,17 @@ namespace bustub {
  * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
  * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
  * pin count, dirty flag, page id, etc.
+ *
+ * The data itself lives in the buffer pool's frame arena; a Page only points at it. Page objects are cache line
+ * aligned, so threads latching and pinning neighbouring frames do not share cache lines.
  */
-class Page {
+class alignas(CACHE_LINE_SIZE) Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManagerInstance;
 
  public:
-  /** Constructor. Zeros out the page data. */
-  Page() { ResetMemory(); }
+  /** Constructor. The page has no data until the buffer pool points it at its frame. */
+  Page() = default;
 
   /** Default destructor. */
   ~Page() = default;
@@ -48,11 +52,38 @@ class Page {
   /** @return true if the page in memory has been modified from the page on disk, false otherwise */
   inline bool IsDirty() { return is_dirty_; }
 
-  /** Acquire the page write latch. */
-  inline void WLatch() { rwlatch_.WLock(); }
-
-  /** Release the page write latch. */
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
+  /** Acquire the page write latch. The version becomes odd, which fails every optimistic read until WUnlatch. */
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.fetch_add(1, std::memory_order_relaxed);
+    // The odd version must be visible before any change to the data.
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  /** Release the page write latch. The version becomes even again, and different from before WLatch. */
+  inline void WUnlatch() {
+    version_.fetch_add(1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
+
+  /**
+   * Start an optimistic read. Unlike RLatch this writes nothing shared, so readers on different cores do not fight
+   * over the latch's cache line. The caller must keep the page pinned, read (or better, copy) the data, and then call
+   * Validate; only if that returns true was the data not changed by a writer in the meantime. Whatever was read must
+   * be treated as garbage until then, so readers should not follow pointers or lengths they found in it.
+   * @return the version to hand to Validate
+   */
+  inline uint64_t OptimisticRead() const { return version_.load(std::memory_order_acquire); }
+
+  /**
+   * @param version what OptimisticRead returned
+   * @return true if no writer held the write latch at OptimisticRead or since then
+   */
+  inline bool Validate(uint64_t version) const {
+    // Order the reads of the data before the second read of the version.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (version & 1) == 0 && version_.load(std::memory_order_relaxed) == version;
+  }
 
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
@@ -78,16 +109,20 @@ class Page {
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
 
-  /** The actual data that is stored within a page. */
-  char data_[PAGE_SIZE]{};
+  /** The actual data that is stored within a page: PAGE_SIZE bytes in the frame arena, PAGE_SIZE aligned. */
+  char *data_ = nullptr;
   /** The ID of this page. */
   page_id_t page_id_ = INVALID_PAGE_ID;
+  /** The buffer pool frame this page object is, set once when the frame is allocated. */
+  frame_id_t frame_id_ = -1;
   /** The pin count of this page. */
   int pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
+  /** Bumped by WLatch and by WUnlatch, so it is odd while a writer holds the latch. */
+  std::atomic<uint64_t> version_{0};
 };
 
 }  // namespace bustub
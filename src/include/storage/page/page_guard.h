@@ -0,0 +1,224 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard.h
+//
+// Identification: src/include/storage/page/page_guard.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "storage/page/page.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+class ReadPageGuard;
+class WritePageGuard;
+
+/**
+ * BasicPageGuard owns one pin on a page and gives it back when it goes out of scope. It remembers the frame it pinned,
+ * so unpinning needs no page table lookup, and it remembers whether the page was modified through it.
+ *
+ * A guard is move-only. A default-constructed guard, a moved-from guard and a guard for a page that could not be
+ * fetched are all empty: IsValid() returns false and Drop() does nothing.
+ */
+class BasicPageGuard {
+ public:
+  BasicPageGuard() = default;
+
+  /**
+   * Takes over a pin the caller already holds.
+   * @param bpm the buffer pool manager the page was pinned in
+   * @param page the pinned page, nullptr for an empty guard
+   */
+  BasicPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+
+  BasicPageGuard(const BasicPageGuard &) = delete;
+  BasicPageGuard &operator=(const BasicPageGuard &) = delete;
+
+  /** Takes over the other guard's pin; the other guard becomes empty. */
+  BasicPageGuard(BasicPageGuard &&that) noexcept;
+
+  /** Drops this guard's pin, then takes over the other guard's pin; the other guard becomes empty. */
+  BasicPageGuard &operator=(BasicPageGuard &&that) noexcept;
+
+  /** Drops the pin, if the guard still holds one. */
+  ~BasicPageGuard();
+
+  /** Unpins the page, marking it dirty if it was modified through the guard, and empties the guard. */
+  void Drop();
+
+  /**
+   * Takes the page's read latch and hands the pin over to a read guard. This guard becomes empty.
+   * @return a read guard for the page
+   */
+  ReadPageGuard UpgradeRead();
+
+  /**
+   * Takes the page's write latch and hands the pin over to a write guard. This guard becomes empty.
+   * @return a write guard for the page, which keeps the page dirty if this guard had marked it
+   */
+  WritePageGuard UpgradeWrite();
+
+  /** @return true if the guard holds a page */
+  bool IsValid() const { return page_ != nullptr; }
+
+  /** @return the id of the guarded page */
+  page_id_t PageId() { return page_->GetPageId(); }
+
+  /** @return the guarded page, for page types that derive from Page. Does not mark the page dirty. */
+  Page *GetPage() { return page_; }
+
+  /** @return the page's data for reading */
+  const char *GetData() { return page_->GetData(); }
+
+  /** @return the page's data for writing; the page is marked dirty */
+  char *GetDataMut() {
+    is_dirty_ = true;
+    return page_->GetData();
+  }
+
+  /** @return the page's data viewed as T, without marking the page dirty. Only use T's read-only methods. */
+  template <class T>
+  T *As() {
+    return reinterpret_cast<T *>(page_->GetData());
+  }
+
+  /** @return the page's data viewed as T; the page is marked dirty */
+  template <class T>
+  T *AsMut() {
+    return reinterpret_cast<T *>(GetDataMut());
+  }
+
+  /** Marks the page dirty, for changes made through GetPage(). */
+  void SetDirty() { is_dirty_ = true; }
+
+ private:
+  friend class ReadPageGuard;
+  friend class WritePageGuard;
+
+  BufferPoolManager *bpm_{nullptr};
+  Page *page_{nullptr};
+  bool is_dirty_{false};
+};
+
+/**
+ * ReadPageGuard owns one pin and the read latch on a page. Drop() releases the latch before the pin.
+ */
+class ReadPageGuard {
+ public:
+  ReadPageGuard() = default;
+
+  /**
+   * Takes over a pin and a read latch the caller already holds.
+   * @param bpm the buffer pool manager the page was pinned in
+   * @param page the pinned and read-latched page, nullptr for an empty guard
+   */
+  ReadPageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+
+  ReadPageGuard(const ReadPageGuard &) = delete;
+  ReadPageGuard &operator=(const ReadPageGuard &) = delete;
+  ReadPageGuard(ReadPageGuard &&that) noexcept = default;
+
+  /** Releases this guard's latch and pin, then takes over the other guard's; the other guard becomes empty. */
+  ReadPageGuard &operator=(ReadPageGuard &&that) noexcept;
+
+  /** Releases the latch and the pin, if the guard still holds them. */
+  ~ReadPageGuard();
+
+  /** Releases the read latch, unpins the page and empties the guard. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  bool IsValid() const { return guard_.IsValid(); }
+
+  /** @return the id of the guarded page */
+  page_id_t PageId() { return guard_.PageId(); }
+
+  /** @return the guarded page, for page types that derive from Page */
+  Page *GetPage() { return guard_.GetPage(); }
+
+  /** @return the page's data */
+  const char *GetData() { return guard_.GetData(); }
+
+  /** @return the page's data viewed as T. Only use T's read-only methods. */
+  template <class T>
+  T *As() {
+    return guard_.As<T>();
+  }
+
+ private:
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
+};
+
+/**
+ * WritePageGuard owns one pin and the write latch on a page. Drop() releases the latch before the pin.
+ */
+class WritePageGuard {
+ public:
+  WritePageGuard() = default;
+
+  /**
+   * Takes over a pin and a write latch the caller already holds.
+   * @param bpm the buffer pool manager the page was pinned in
+   * @param page the pinned and write-latched page, nullptr for an empty guard
+   */
+  WritePageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+
+  WritePageGuard(const WritePageGuard &) = delete;
+  WritePageGuard &operator=(const WritePageGuard &) = delete;
+  WritePageGuard(WritePageGuard &&that) noexcept = default;
+
+  /** Releases this guard's latch and pin, then takes over the other guard's; the other guard becomes empty. */
+  WritePageGuard &operator=(WritePageGuard &&that) noexcept;
+
+  /** Releases the latch and the pin, if the guard still holds them. */
+  ~WritePageGuard();
+
+  /** Releases the write latch, unpins the page, marking it dirty if it was modified, and empties the guard. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  bool IsValid() const { return guard_.IsValid(); }
+
+  /** @return the id of the guarded page */
+  page_id_t PageId() { return guard_.PageId(); }
+
+  /** @return the guarded page, for page types that derive from Page. Does not mark the page dirty. */
+  Page *GetPage() { return guard_.GetPage(); }
+
+  /** @return the page's data for reading */
+  const char *GetData() { return guard_.GetData(); }
+
+  /** @return the page's data for writing; the page is marked dirty */
+  char *GetDataMut() { return guard_.GetDataMut(); }
+
+  /** @return the page's data viewed as T, without marking the page dirty */
+  template <class T>
+  T *As() {
+    return guard_.As<T>();
+  }
+
+  /** @return the page's data viewed as T; the page is marked dirty */
+  template <class T>
+  T *AsMut() {
+    return guard_.AsMut<T>();
+  }
+
+  /** Marks the page dirty, for changes made through GetPage(). */
+  void SetDirty() { guard_.SetDirty(); }
+
+ private:
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
+};
+
+}  // namespace bustub
@@ -148,6 +148,7 @@ class TablePage : public Page {
   static constexpr size_t OFFSET_TUPLE_COUNT = 20;
   static constexpr size_t OFFSET_TUPLE_OFFSET = 24;  // Naming things is hard.
   static constexpr size_t OFFSET_TUPLE_SIZE = 28;
+  static_assert(SIZE_TABLE_PAGE_HEADER + SIZE_TUPLE < PAGE_SIZE, "a table page must hold its header and a slot");
 
   /** @return pointer to the end of the current free space, see header comment */
   uint32_t GetFreeSpacePointer() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_SPACE); }
@@ -28,6 +28,8 @@ class TmpTuplePage : public Page {
 
  private:
   static_assert(sizeof(page_id_t) == 4);
+  // The header is the page id, the LSN and the free space pointer.
+  static_assert(3 * sizeof(uint32_t) < PAGE_SIZE, "a tmp tuple page must hold its header");
 };
 
 }  // namespace bustub
@@ -99,8 +99,13 @@ class TableHeap {
    */
   bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn);
 
-  /** @return the begin iterator of this table */
-  TableIterator Begin(Transaction *txn);
+  /**
+   * @param txn the transaction performing the scan
+   * @param strategy BULK_READ makes the scan recycle a small private ring of frames instead of flushing the pool
+   * @param read_ahead the number of pages the scan prefetches ahead of the page it is on, 0 for none
+   * @return the begin iterator of this table
+   */
+  TableIterator Begin(Transaction *txn, ScanStrategy strategy = ScanStrategy::NORMAL, size_t read_ahead = 0);
 
   /** @return the end iterator of this table */
   TableIterator End();
@@ -13,7 +13,10 @@
 #pragma once
 
 #include <cassert>
+#include <memory>
+#include <utility>
 
+#include "buffer/buffer_ring.h"
 #include "common/rid.h"
 #include "concurrency/transaction.h"
 #include "storage/table/tuple.h"
@@ -29,10 +32,22 @@ class TableIterator {
   friend class Cursor;
 
  public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  /**
+   * @param table_heap the table being scanned
+   * @param rid the tuple the iterator starts at
+   * @param txn the transaction performing the scan
+   * @param ring the buffer ring the scan recycles frames from, nullptr to go through the shared replacer
+   * @param read_ahead the number of pages to prefetch ahead of the scan, 0 to read each page when it is reached
+   */
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, std::shared_ptr<BufferRing> ring = nullptr,
+                size_t read_ahead = 0);
 
   TableIterator(const TableIterator &other)
-      : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+      : table_heap_(other.table_heap_),
+        tuple_(new Tuple(*other.tuple_)),
+        txn_(other.txn_),
+        ring_(other.ring_),
+        read_ahead_(other.read_ahead_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -52,13 +67,21 @@ class TableIterator {
     table_heap_ = other.table_heap_;
     *tuple_ = *other.tuple_;
     txn_ = other.txn_;
+    ring_ = other.ring_;
+    read_ahead_ = other.read_ahead_;
     return *this;
   }
 
  private:
+  class ReadAhead;
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  /** Shared by all copies of the iterator, since they belong to the same scan. */
+  std::shared_ptr<BufferRing> ring_;
+  /** Follows the page chain ahead of the scan; shared by all copies of the iterator, null without read-ahead. */
+  std::shared_ptr<ReadAhead> read_ahead_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,350 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.cpp
+//
+// Identification: src/storage/disk/async_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/async_disk_manager.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+struct AsyncDiskManager::InFlight {
+  DiskRequest request_;
+  /**
+   * The part of the buffer left to transfer, as io_uring's READV and WRITEV want it; they work on every kernel that
+   * has io_uring.
+   */
+  iovec iov_;
+  /** Bytes transferred by earlier, short completions of this request. */
+  size_t done_;
+};
+
+AsyncDiskManager::AsyncDiskManager(const std::string &db_file, AsyncIoBackend backend, size_t queue_depth,
+                                   const DiskManagerOptions &options)
+    : DiskManager(db_file, options), backend_(backend), queue_depth_(std::max<size_t>(queue_depth, 1)) {
+  if (backend_ == AsyncIoBackend::IO_URING && !SetUpRing(static_cast<unsigned>(queue_depth_))) {
+    LOG_DEBUG("io_uring is not available, falling back to a thread pool");
+    backend_ = AsyncIoBackend::THREAD_POOL;
+  }
+  if (backend_ == AsyncIoBackend::IO_URING) {
+    completion_thread_ = std::thread(&AsyncDiskManager::CompletionLoop, this);
+  } else {
+    for (int i = 0; i < ASYNC_IO_WORKERS; i++) {
+      workers_.emplace_back(&AsyncDiskManager::WorkerLoop, this);
+    }
+  }
+}
+
+AsyncDiskManager::~AsyncDiskManager() {
+  {
+    std::unique_lock<std::mutex> lock(submit_latch_);
+    room_cv_.wait(lock, [&] { return in_flight_ == 0; });
+    stopping_ = true;
+    if (backend_ == AsyncIoBackend::IO_URING) {
+      // Nothing is in flight, so there is room for the no-op that stops the completion thread.
+      PrepareSubmission(nullptr);
+      EnterRing(1);
+    }
+  }
+  queue_cv_.notify_all();
+  if (completion_thread_.joinable()) {
+    completion_thread_.join();
+  }
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+  if (backend_ == AsyncIoBackend::IO_URING) {
+    TearDownRing();
+  }
+}
+
+void AsyncDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  if (!WritePageAsync(page_id, page_data).get()) {
+    LOG_DEBUG("I/O error while writing");
+  }
+}
+
+void AsyncDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  if (!ReadPageAsync(page_id, page_data).get()) {
+    LOG_DEBUG("I/O error while reading");
+  }
+}
+
+std::future<bool> AsyncDiskManager::ReadPageAsync(page_id_t page_id, char *page_data) {
+  auto done = std::make_shared<std::promise<bool>>();
+  std::future<bool> result = done->get_future();
+  ReadPageAsync(page_id, page_data, [done](bool ok) { done->set_value(ok); });
+  return result;
+}
+
+std::future<bool> AsyncDiskManager::WritePageAsync(page_id_t page_id, const char *page_data) {
+  auto done = std::make_shared<std::promise<bool>>();
+  std::future<bool> result = done->get_future();
+  WritePageAsync(page_id, page_data, [done](bool ok) { done->set_value(ok); });
+  return result;
+}
+
+void AsyncDiskManager::ReadPageAsync(page_id_t page_id, char *page_data, DiskCallback callback) {
+  std::vector<DiskRequest> requests;
+  requests.push_back({false, page_id, page_data, std::move(callback)});
+  Submit(std::move(requests));
+}
+
+void AsyncDiskManager::WritePageAsync(page_id_t page_id, const char *page_data, DiskCallback callback) {
+  std::vector<DiskRequest> requests;
+  // The buffer is only read from; DiskRequest has one pointer type for both directions.
+  requests.push_back({true, page_id, const_cast<char *>(page_data), std::move(callback)});
+  Submit(std::move(requests));
+}
+
+void AsyncDiskManager::Submit(std::vector<DiskRequest> requests) {
+  std::unique_lock<std::mutex> lock(submit_latch_);
+  unsigned prepared = 0;
+  for (DiskRequest &request : requests) {
+    if (in_flight_ >= queue_depth_) {
+      // Let the kernel start on what is prepared before waiting for room, or nothing could complete.
+      if (prepared > 0) {
+        EnterRing(prepared);
+        prepared = 0;
+      }
+      room_cv_.wait(lock, [&] { return in_flight_ < queue_depth_; });
+    }
+    in_flight_++;
+    if (backend_ == AsyncIoBackend::IO_URING) {
+      PrepareSubmission(new InFlight{std::move(request), {}, 0});
+      prepared++;
+    } else {
+      queue_.push_back(std::move(request));
+      queue_cv_.notify_one();
+    }
+  }
+  if (prepared > 0) {
+    EnterRing(prepared);
+  }
+}
+
+bool AsyncDiskManager::SetUpRing(unsigned queue_depth) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+  if (ring_fd_ < 0) {
+    return false;
+  }
+  // The kernel rounds the depth up to a power of two; never have more in flight than submission entries.
+  queue_depth_ = std::min<size_t>(queue_depth_, params.sq_entries);
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                  IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    TearDownRing();
+    return false;
+  }
+  cq_ring_ = single_mmap ? sq_ring_
+                         : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                IORING_OFF_CQ_RING);
+  if (cq_ring_ == MAP_FAILED) {
+    cq_ring_ = nullptr;
+    TearDownRing();
+    return false;
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    TearDownRing();
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+  auto *sq = static_cast<char *>(sq_ring_);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  auto *cq = static_cast<char *>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  return true;
+}
+
+void AsyncDiskManager::TearDownRing() {
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+    sqes_ = nullptr;
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  cq_ring_ = nullptr;
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+    sq_ring_ = nullptr;
+  }
+  close(ring_fd_);
+  ring_fd_ = -1;
+}
+
+void AsyncDiskManager::PrepareSubmission(InFlight *in_flight) {
+  // Only submitters move the tail, under submit_latch_; the kernel only reads it.
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & *sq_mask_;
+  io_uring_sqe *sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  if (in_flight == nullptr) {
+    sqe->opcode = IORING_OP_NOP;
+  } else {
+    const DiskRequest &request = in_flight->request_;
+    off_t offset;
+    const int fd = LocatePage(request.page_id_, request.is_write_, &offset);
+    in_flight->iov_.iov_base = request.page_data_ + in_flight->done_;
+    in_flight->iov_.iov_len = PAGE_SIZE - in_flight->done_;
+    if (fd < 0) {
+      // A no-op completes with 0 bytes: a read of a missing segment becomes a page of zeroes, a write fails.
+      sqe->opcode = IORING_OP_NOP;
+    } else {
+      sqe->opcode = request.is_write_ ? IORING_OP_WRITEV : IORING_OP_READV;
+      sqe->fd = fd;
+      sqe->addr = reinterpret_cast<uint64_t>(&in_flight->iov_);
+      sqe->len = 1;
+      sqe->off = static_cast<uint64_t>(offset) + in_flight->done_;
+    }
+    sqe->user_data = reinterpret_cast<uint64_t>(in_flight);
+  }
+  sq_array_[index] = index;
+  // The entry must be complete before the kernel can see the new tail.
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+}
+
+void AsyncDiskManager::EnterRing(unsigned to_submit) {
+  while (to_submit > 0) {
+    int64_t submitted = syscall(__NR_io_uring_enter, ring_fd_, to_submit, 0, 0, nullptr, 0);
+    if (submitted < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        continue;
+      }
+      throw Exception("io_uring_enter failed");
+    }
+    to_submit -= static_cast<unsigned>(submitted);
+  }
+}
+
+void AsyncDiskManager::CompletionLoop() {
+  while (true) {
+    // Only this thread moves the head; the kernel moves the tail.
+    const unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+      continue;
+    }
+    const io_uring_cqe cqe = cqes_[head & *cq_mask_];
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    if (cqe.user_data == 0) {
+      return;
+    }
+    std::unique_ptr<InFlight> in_flight(reinterpret_cast<InFlight *>(cqe.user_data));
+    // Like pread and pwrite, a transfer may stop short of the page or be interrupted; only a read that transferred
+    // nothing has reached the end of the file. The request keeps its place in in_flight_, so there is room to go on.
+    if (cqe.res == -EINTR || cqe.res == -EAGAIN ||
+        (cqe.res > 0 && in_flight->done_ + cqe.res < static_cast<size_t>(PAGE_SIZE))) {
+      in_flight->done_ += std::max(cqe.res, 0);
+      std::lock_guard<std::mutex> guard(submit_latch_);
+      PrepareSubmission(in_flight.release());
+      EnterRing(1);
+      continue;
+    }
+    Complete(&in_flight->request_, cqe.res < 0 ? cqe.res : static_cast<ssize_t>(in_flight->done_ + cqe.res));
+    {
+      std::lock_guard<std::mutex> guard(submit_latch_);
+      in_flight_--;
+    }
+    room_cv_.notify_all();
+  }
+}
+
+void AsyncDiskManager::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(submit_latch_);
+  while (true) {
+    queue_cv_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    DiskRequest request = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    Complete(&request, RunSync(request));
+    lock.lock();
+    in_flight_--;
+    room_cv_.notify_all();
+  }
+}
+
+ssize_t AsyncDiskManager::RunSync(const DiskRequest &request) {
+  off_t offset;
+  const int fd = LocatePage(request.page_id_, request.is_write_, &offset);
+  if (fd < 0) {
+    return 0;
+  }
+  size_t done = 0;
+  while (done < static_cast<size_t>(PAGE_SIZE)) {
+    ssize_t result = request.is_write_ ? pwrite(fd, request.page_data_ + done, PAGE_SIZE - done, offset + done)
+                                       : pread(fd, request.page_data_ + done, PAGE_SIZE - done, offset + done);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    if (result == 0) {
+      break;
+    }
+    done += result;
+  }
+  return static_cast<ssize_t>(done);
+}
+
+void AsyncDiskManager::Complete(DiskRequest *request, ssize_t result) {
+  bool ok = result == PAGE_SIZE;
+  if (result >= 0 && result < PAGE_SIZE && !request->is_write_) {
+    // The read reached the end of the file. Like DiskManager, the rest of the page reads as zeroes.
+    memset(request->page_data_ + result, 0, PAGE_SIZE - result);
+    ok = true;
+  }
+  if (!ok) {
+    LOG_DEBUG("I/O error on page %d: %zd", request->page_id_, result);
+  } else if (request->is_write_) {
+    num_writes_ += 1;
+  }
+  if (request->callback_) {
+    request->callback_(ok);
+  }
+}
+
+}  // namespace bustub
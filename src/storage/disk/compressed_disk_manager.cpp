@@ -0,0 +1,258 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_disk_manager.cpp
+//
+// Identification: src/storage/disk/compressed_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/compressed_disk_manager.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "storage/disk/page_codec.h"
+
+namespace bustub {
+
+namespace {
+
+/** @return false on an I/O error */
+bool WriteFully(int fd, const char *data, size_t size, off_t offset) {
+  size_t written = 0;
+  while (written < size) {
+    ssize_t result = pwrite(fd, data + written, size - written, offset + written);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      return false;
+    }
+    written += result;
+  }
+  return true;
+}
+
+/** @return false on an I/O error or if the file ends first */
+bool ReadFully(int fd, char *data, size_t size, off_t offset) {
+  size_t read_count = 0;
+  while (read_count < size) {
+    ssize_t result = pread(fd, data + read_count, size - read_count, offset + read_count);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      return false;
+    }
+    read_count += result;
+  }
+  return true;
+}
+
+}  // namespace
+
+CompressedDiskManager::CompressedDiskManager(const std::string &db_file) : DiskManager(db_file) {
+  std::string::size_type n = db_file.rfind('.');
+  map_name_ = (n == std::string::npos ? db_file : db_file.substr(0, n)) + ".map";
+  // A database file without any slot is new, and a map left over from an earlier database does not describe it.
+  struct stat stat_buf;
+  const bool fresh = fstat(db_fd_, &stat_buf) != 0 || stat_buf.st_size == 0;
+  map_fd_ = open(map_name_.c_str(), O_RDWR | O_CREAT | (fresh ? O_TRUNC : 0), 0644);
+  if (map_fd_ < 0 || fstat(map_fd_, &stat_buf) != 0) {
+    throw Exception("can't open page map file");
+  }
+  slots_.resize(stat_buf.st_size / sizeof(PageSlot));
+  if (!slots_.empty() &&
+      !ReadFully(map_fd_, reinterpret_cast<char *>(slots_.data()), slots_.size() * sizeof(PageSlot), 0)) {
+    throw Exception("can't read page map file");
+  }
+
+  // Every byte of the file up to the end of the last slot that is not in a slot is free.
+  std::vector<std::pair<uint64_t, uint32_t>> used;
+  for (const PageSlot &slot : slots_) {
+    if (slot.length_ != 0) {
+      used.emplace_back(slot.offset_, slot.slot_size_);
+    }
+  }
+  std::sort(used.begin(), used.end());
+  for (const auto &[offset, size] : used) {
+    if (offset > file_end_) {
+      AddFreeRange(file_end_, offset);
+    }
+    file_end_ = std::max(file_end_, offset + size);
+  }
+}
+
+CompressedDiskManager::~CompressedDiskManager() {
+  if (map_fd_ >= 0) {
+    close(map_fd_);
+  }
+}
+
+void CompressedDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  num_writes_ += 1;
+  // A page only saves bandwidth if it fits a smaller slot; anything else is stored as it is.
+  char compressed[PAGE_SIZE];
+  auto length = static_cast<uint32_t>(PageCodec::Compress(page_data, PAGE_SIZE, compressed, PAGE_SIZE - 1));
+  const char *data = compressed;
+  if (length == 0) {
+    length = PAGE_SIZE;
+    data = page_data;
+  }
+  const size_t size_class = SizeClass(length);
+
+  PageSlot old_slot{0, 0, 0};
+  uint64_t offset;
+  {
+    std::scoped_lock map_lock(map_latch_);
+    if (static_cast<size_t>(page_id) >= slots_.size()) {
+      slots_.resize(page_id + 1, PageSlot{0, 0, 0});
+    }
+    old_slot = slots_[page_id];
+    // Even a rewrite that fits the old slot goes to a new one: overwriting the old slot in place could leave the map on
+    // disk describing the old length over the new bytes after a crash.
+    offset = AllocateSlot(size_class);
+  }
+
+  const bool written = WriteFully(db_fd_, data, length, static_cast<off_t>(offset));
+  std::scoped_lock map_lock(map_latch_);
+  if (!written) {
+    LOG_DEBUG("I/O error while writing");
+    free_slots_[size_class].push_back(offset);
+    return;
+  }
+  bytes_written_ += length;
+  slots_[page_id] = PageSlot{offset, length, SLOT_SIZES[size_class]};
+  PersistSlot(page_id);
+  // The old slot is only reused once the next Sync has made the map on disk point elsewhere.
+  if (old_slot.length_ != 0) {
+    pending_free_slots_[SizeClass(old_slot.slot_size_)].push_back(old_slot.offset_);
+  }
+}
+
+void CompressedDiskManager::WritePages(page_id_t first_page_id, const char *const *pages_data, size_t num_pages) {
+  for (size_t i = 0; i < num_pages; i++) {
+    WritePage(static_cast<page_id_t>(first_page_id + i), pages_data[i]);
+  }
+}
+
+void CompressedDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  PageSlot slot{0, 0, 0};
+  {
+    std::scoped_lock map_lock(map_latch_);
+    if (static_cast<size_t>(page_id) < slots_.size()) {
+      slot = slots_[page_id];
+    }
+  }
+  if (slot.length_ == 0) {
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  if (slot.length_ == PAGE_SIZE) {
+    if (!ReadFully(db_fd_, page_data, PAGE_SIZE, static_cast<off_t>(slot.offset_))) {
+      LOG_WARN("I/O error while reading page %d", page_id);
+      num_failed_reads_ += 1;
+      memset(page_data, 0, PAGE_SIZE);
+    }
+    bytes_read_ += PAGE_SIZE;
+    return;
+  }
+  char compressed[PAGE_SIZE];
+  if (!ReadFully(db_fd_, compressed, slot.length_, static_cast<off_t>(slot.offset_)) ||
+      !PageCodec::Decompress(compressed, slot.length_, page_data, PAGE_SIZE)) {
+    LOG_WARN("can't read compressed page %d", page_id);
+    num_failed_reads_ += 1;
+    memset(page_data, 0, PAGE_SIZE);
+  }
+  bytes_read_ += slot.length_;
+}
+
+bool CompressedDiskManager::Sync() {
+  // Every slot pending now was replaced in the map before it went pending, so this sync covers it; slots that go
+  // pending while it runs wait for the next one.
+  std::array<std::vector<uint64_t>, SLOT_SIZES.size()> pending;
+  {
+    std::scoped_lock map_lock(map_latch_);
+    pending.swap(pending_free_slots_);
+  }
+  const bool synced = DiskManager::Sync() && fdatasync(map_fd_) == 0;
+  std::scoped_lock map_lock(map_latch_);
+  for (size_t size_class = 0; size_class < SLOT_SIZES.size(); size_class++) {
+    auto &into = synced ? free_slots_[size_class] : pending_free_slots_[size_class];
+    into.insert(into.end(), pending[size_class].begin(), pending[size_class].end());
+  }
+  return synced;
+}
+
+uint64_t CompressedDiskManager::GetFileEnd() {
+  std::scoped_lock map_lock(map_latch_);
+  return file_end_;
+}
+
+page_id_t CompressedDiskManager::GetNumStoredPages() {
+  std::scoped_lock map_lock(map_latch_);
+  for (auto page_id = static_cast<page_id_t>(slots_.size()) - 1; page_id >= 0; page_id--) {
+    if (slots_[page_id].length_ != 0) {
+      return page_id + 1;
+    }
+  }
+  return 0;
+}
+
+size_t CompressedDiskManager::SizeClass(uint32_t length) {
+  size_t size_class = 0;
+  while (SLOT_SIZES[size_class] < length) {
+    size_class++;
+  }
+  return size_class;
+}
+
+uint64_t CompressedDiskManager::AllocateSlot(size_t size_class) {
+  // A free slot of the right size, or failing that the smallest larger one, split in two until it fits.
+  for (size_t from = size_class; from < SLOT_SIZES.size(); from++) {
+    if (!free_slots_[from].empty()) {
+      const uint64_t offset = free_slots_[from].back();
+      free_slots_[from].pop_back();
+      AddFreeRange(offset + SLOT_SIZES[size_class], offset + SLOT_SIZES[from]);
+      return offset;
+    }
+  }
+  const uint64_t size = SLOT_SIZES[size_class];
+  const uint64_t offset = (file_end_ + size - 1) / size * size;
+  AddFreeRange(file_end_, offset);
+  file_end_ = offset + size;
+  return offset;
+}
+
+void CompressedDiskManager::AddFreeRange(uint64_t begin, uint64_t end) {
+  // Every slot size is a multiple of the smallest one, so every range ends on a boundary of the smallest size.
+  while (begin < end) {
+    size_t size_class = SLOT_SIZES.size() - 1;
+    while (begin % SLOT_SIZES[size_class] != 0 || begin + SLOT_SIZES[size_class] > end) {
+      size_class--;
+    }
+    free_slots_[size_class].push_back(begin);
+    begin += SLOT_SIZES[size_class];
+  }
+}
+
+void CompressedDiskManager::PersistSlot(page_id_t page_id) {
+  const off_t offset = static_cast<off_t>(page_id) * sizeof(PageSlot);
+  if (!WriteFully(map_fd_, reinterpret_cast<const char *>(&slots_[page_id]), sizeof(PageSlot), offset)) {
+    LOG_DEBUG("I/O error while writing page map file");
+  }
+}
+
+}  // namespace bustub
@@ -10,11 +10,23 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <mutex>  // NOLINT
+#include <shared_mutex>
 #include <string>
 #include <thread>  // NOLINT
 
@@ -26,18 +38,35 @@ namespace bustub {
 
 static char *buffer_used;
 
+/**
+ * A PAGE_SIZE aligned page per thread, for direct I/O on page buffers that are not aligned
+ */
+static char *BounceBuffer() {
+  thread_local std::unique_ptr<char, decltype(&free)> buffer(
+      static_cast<char *>(aligned_alloc(PAGE_SIZE, PAGE_SIZE)), &free);
+  return buffer.get();
+}
+
+static bool IsPageAligned(const char *data) { return reinterpret_cast<uintptr_t>(data) % PAGE_SIZE == 0; }
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, const DiskManagerOptions &options)
+    : options_(options),
+      file_name_(db_file),
+      num_flushes_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr),
+      num_free_pages_(0) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  free_name_ = file_name_.substr(0, n) + ".free";
 
   log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
   // directory or file does not exist
@@ -53,30 +82,62 @@ DiskManager::DiskManager(const std::string &db_file)
     }
   }
 
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-    if (!db_io_.is_open()) {
+  db_fd_ = OpenDataFile(db_file, O_RDWR);
+  if (db_fd_ >= 0) {
+    // reopening a database: pick up the pages it had freed
+    std::ifstream free_in(free_name_, std::ios::binary);
+    free_pages_.assign(std::istreambuf_iterator<char>(free_in), std::istreambuf_iterator<char>());
+    for (uint8_t byte : free_pages_) {
+      num_free_pages_ += __builtin_popcount(byte);
+    }
+    segment_fds_.push_back(db_fd_);
+    // the segments after the first one end at the first that is missing
+    while (options_.segment_pages_ > 0) {
+      int fd = OpenDataFile(GetSegmentName(segment_fds_.size()), O_RDWR);
+      if (fd < 0) {
+        break;
+      }
+      segment_fds_.push_back(fd);
+    }
+  } else {
+    // directory or file does not exist
+    // a bitmap left over from an earlier database of the same name does not describe the new file, nor do segments
+    remove(free_name_.c_str());
+    size_t stale = 1;
+    while (options_.segment_pages_ > 0 && remove(GetSegmentName(stale).c_str()) == 0) {
+      stale++;
+    }
+    if (!CreateSegments(0)) {
       throw Exception("can't open db file");
     }
+    db_fd_ = segment_fds_[0];
   }
   buffer_used = nullptr;
 }
 
+DiskManager::~DiskManager() {
+  CloseSegments();
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  if (free_fd_ >= 0) {
+    close(free_fd_);
+    free_fd_ = -1;
+  }
+}
+
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
+  if (db_fd_ >= 0) {
+    Sync();
+    CloseSegments();
+  }
   {
-    std::scoped_lock scoped_db_io_latch(db_io_latch_);
-    db_io_.close();
+    std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+    if (free_fd_ >= 0) {
+      close(free_fd_);
+      free_fd_ = -1;
+    }
   }
   log_io_.close();
 }
@@ -85,49 +146,386 @@ void DiskManager::ShutDown() {
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
+  off_t offset;
+  int fd = LocatePage(page_id, true, &offset);
   num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
+  if (fd < 0) {
+    LOG_DEBUG("can't create segment for page %d", page_id);
     return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  if (options_.direct_io_ && !IsPageAligned(page_data)) {
+    char *bounce = BounceBuffer();
+    memcpy(bounce, page_data, PAGE_SIZE);
+    page_data = bounce;
+  }
+  size_t written = 0;
+  while (written < static_cast<size_t>(PAGE_SIZE)) {
+    ssize_t result = pwrite(fd, page_data + written, PAGE_SIZE - written, offset + written);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    // check for I/O error
+    if (result <= 0) {
+      LOG_DEBUG("I/O error while writing");
+      return;
+    }
+    written += result;
+  }
+}
+
+/**
+ * Write consecutive pages with one vectored write per segment and IOV_MAX pages
+ */
+void DiskManager::WritePages(page_id_t first_page_id, const char *const *pages_data, size_t num_pages) {
+  if (options_.direct_io_ && !std::all_of(pages_data, pages_data + num_pages, IsPageAligned)) {
+    // every buffer of a direct vectored write must be aligned, so unaligned runs go one page at a time
+    for (size_t i = 0; i < num_pages; i++) {
+      WritePage(static_cast<page_id_t>(first_page_id + i), pages_data[i]);
+    }
+    return;
+  }
+  num_writes_ += static_cast<int>(num_pages);
+  std::vector<iovec> iov;
+  size_t next = 0;
+  while (next < num_pages) {
+    const auto page_id = static_cast<page_id_t>(first_page_id + next);
+    off_t offset;
+    int fd = LocatePage(page_id, true, &offset);
+    if (fd < 0) {
+      LOG_DEBUG("can't create segment for page %d", page_id);
+      return;
+    }
+    // a vectored write stops at the end of the page's segment and at IOV_MAX buffers
+    size_t count = std::min<size_t>(num_pages - next, IOV_MAX);
+    if (options_.segment_pages_ > 0) {
+      count = std::min(count, options_.segment_pages_ - static_cast<size_t>(page_id) % options_.segment_pages_);
+    }
+    iov.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      iov[i].iov_base = const_cast<char *>(pages_data[next + i]);
+      iov[i].iov_len = PAGE_SIZE;
+    }
+    // a short write leaves the remaining bytes in the iovecs from the first one not fully written
+    size_t first = 0;
+    while (first < count) {
+      ssize_t result = pwritev(fd, &iov[first], static_cast<int>(count - first), offset);
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      if (result <= 0) {
+        LOG_DEBUG("I/O error while writing");
+        return;
+      }
+      offset += result;
+      while (first < count && static_cast<size_t>(result) >= iov[first].iov_len) {
+        result -= iov[first].iov_len;
+        first++;
+      }
+      if (first < count) {
+        iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + result;
+        iov[first].iov_len -= result;
+      }
+    }
+    next += count;
+  }
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    // printf("offset = %d\n", offset);
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    if (db_io_.bad()) {
+  off_t offset;
+  int fd = LocatePage(page_id, false, &offset);
+  if (fd < 0) {
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  char *target = options_.direct_io_ && !IsPageAligned(page_data) ? BounceBuffer() : page_data;
+  size_t read_count = 0;
+  while (read_count < static_cast<size_t>(PAGE_SIZE)) {
+    ssize_t result = pread(fd, target + read_count, PAGE_SIZE - read_count, offset + read_count);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
       LOG_DEBUG("I/O error while reading");
       return;
     }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    // the file ends before the page does
+    if (result == 0) {
+      memset(target + read_count, 0, PAGE_SIZE - read_count);
+      break;
+    }
+    read_count += result;
+  }
+  if (target != page_data) {
+    memcpy(page_data, target, PAGE_SIZE);
+  }
+}
+
+/**
+ * Perform the requests one by one; errors are only logged by ReadPage and WritePage, so every callback sees success
+ */
+void DiskManager::Submit(std::vector<DiskRequest> requests) {
+  for (DiskRequest &request : requests) {
+    if (request.is_write_) {
+      WritePage(request.page_id_, request.page_data_);
+    } else {
+      ReadPage(request.page_id_, request.page_data_);
+    }
+    if (request.callback_) {
+      request.callback_(true);
+    }
+  }
+}
+
+/**
+ * Flush the database file's data to the device
+ */
+bool DiskManager::Sync() {
+  num_syncs_ += 1;
+  bool synced = true;
+  {
+    // The bitmap goes first: a page freed before this sync must not be on disk as reused while its bit is lost.
+    std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+    synced = SyncFreePages();
+  }
+  std::shared_lock segments_lock(segments_latch_);
+  for (int fd : segment_fds_) {
+    if (fdatasync(fd) != 0) {
+      LOG_DEBUG("I/O error while syncing");
+      synced = false;
+    }
+  }
+  return synced;
+}
+
+/**
+ * Map a page id to its segment file and the offset within it
+ */
+int DiskManager::LocatePage(page_id_t page_id, bool for_write, off_t *offset) {
+  if (options_.segment_pages_ == 0) {
+    *offset = static_cast<off_t>(page_id) * PAGE_SIZE;
+    return db_fd_;
+  }
+  const size_t segment = static_cast<size_t>(page_id) / options_.segment_pages_;
+  *offset = static_cast<off_t>(static_cast<size_t>(page_id) % options_.segment_pages_) * PAGE_SIZE;
+  {
+    std::shared_lock segments_lock(segments_latch_);
+    if (segment < segment_fds_.size()) {
+      return segment_fds_[segment];
+    }
+  }
+  if (!for_write) {
+    return -1;
+  }
+  std::unique_lock segments_lock(segments_latch_);
+  return CreateSegments(segment) ? segment_fds_[segment] : -1;
+}
+
+/**
+ * Create the missing segment files up to the given one, preallocating them if asked to
+ */
+bool DiskManager::CreateSegments(size_t segment) {
+  while (segment_fds_.size() <= segment) {
+    const std::string name = GetSegmentName(segment_fds_.size());
+    int fd = OpenDataFile(name, O_RDWR | O_CREAT | O_TRUNC);
+    if (fd < 0) {
+      return false;
+    }
+    if (options_.segment_pages_ > 0 && options_.preallocate_) {
+      // KEEP_SIZE reserves the blocks without moving the end of the file, which GetNumPages reads
+      const auto length = static_cast<off_t>(options_.segment_pages_) * PAGE_SIZE;
+      if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, length) != 0) {
+        LOG_DEBUG("can't preallocate %s", name.c_str());
+      }
+    }
+    segment_fds_.push_back(fd);
+  }
+  return true;
+}
+
+/**
+ * Open with O_DIRECT if asked to, and without it if the filesystem does not support it
+ */
+int DiskManager::OpenDataFile(const std::string &file_name, int flags) {
+  if (options_.direct_io_) {
+    int fd = open(file_name.c_str(), flags | O_DIRECT, 0644);
+    if (fd >= 0 || errno != EINVAL) {
+      return fd;
+    }
+    // direct_io_ stays on: other files may have O_DIRECT, and bouncing a buffer for a buffered file is only a copy
+    LOG_DEBUG("%s does not support O_DIRECT, falling back to buffered I/O", file_name.c_str());
+    buffered_fallback_ = true;
+  }
+  return open(file_name.c_str(), flags, 0644);
+}
+
+/**
+ * Close every segment file, including the database file itself
+ */
+void DiskManager::CloseSegments() {
+  std::unique_lock segments_lock(segments_latch_);
+  for (int fd : segment_fds_) {
+    close(fd);
+  }
+  segment_fds_.clear();
+  db_fd_ = -1;
+}
+
+/**
+ * Segment 0 is the database file, segment k is the database file name followed by .k
+ */
+std::string DiskManager::GetSegmentName(size_t segment) const {
+  return segment == 0 ? file_name_ : file_name_ + "." + std::to_string(segment);
+}
+
+/**
+ * Returns the number of segment files
+ */
+size_t DiskManager::GetNumSegments() {
+  std::shared_lock segments_lock(segments_latch_);
+  return segment_fds_.size();
+}
+
+/**
+ * Set the page's bit in the free-page bitmap and write it through to the bitmap file
+ */
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  size_t byte = static_cast<size_t>(page_id) / 8;
+  uint8_t mask = 1U << (page_id % 8);
+  if (byte >= free_pages_.size()) {
+    free_pages_.resize(byte + 1, 0);
+  }
+  if ((free_pages_[byte] & mask) != 0) {
+    return;
+  }
+  free_pages_[byte] |= mask;
+  num_free_pages_++;
+  PersistFreePageBit(page_id);
+}
+
+/**
+ * Clear the bit of the first free page in the stripe and write it through to the bitmap file
+ */
+page_id_t DiskManager::ReuseFreePage(uint32_t stride, uint32_t offset, page_id_t limit) {
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  if (num_free_pages_ == 0) {
+    return INVALID_PAGE_ID;
+  }
+  auto num_bits = std::min(static_cast<page_id_t>(free_pages_.size() * 8), limit);
+  for (auto page_id = static_cast<page_id_t>(offset); page_id < num_bits; page_id += stride) {
+    size_t byte = page_id / 8;
+    uint8_t mask = 1U << (page_id % 8);
+    if ((free_pages_[byte] & mask) != 0) {
+      free_pages_[byte] &= ~mask;
+      num_free_pages_--;
+      PersistFreePageBit(page_id);
+      SyncFreePages();
+      return page_id;
+    }
+  }
+  return INVALID_PAGE_ID;
+}
+
+/**
+ * Clear the page's bit if it is set and write it through to the bitmap file
+ */
+bool DiskManager::ClaimPage(page_id_t page_id) {
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  size_t byte = static_cast<size_t>(page_id) / 8;
+  uint8_t mask = 1U << (page_id % 8);
+  if (num_free_pages_ == 0 || byte >= free_pages_.size() || (free_pages_[byte] & mask) == 0) {
+    return false;
+  }
+  free_pages_[byte] &= ~mask;
+  num_free_pages_--;
+  PersistFreePageBit(page_id);
+  SyncFreePages();
+  return true;
+}
+
+/**
+ * Returns the number of pages in the free-page bitmap
+ */
+size_t DiskManager::GetNumFreePages() {
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  return num_free_pages_;
+}
+
+/**
+ * Returns the number of whole or partial pages in the database file, counting freed pages past its end
+ */
+page_id_t DiskManager::GetNumPages() {
+  const page_id_t num_pages = GetNumStoredPages();
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  for (auto page_id = static_cast<page_id_t>(free_pages_.size() * 8) - 1; page_id >= num_pages; page_id--) {
+    if ((free_pages_[page_id / 8] & (1U << (page_id % 8))) != 0) {
+      return page_id + 1;
     }
   }
+  return num_pages;
+}
+
+/**
+ * Returns the number of whole or partial pages in the database files
+ */
+page_id_t DiskManager::GetNumStoredPages() {
+  // every segment but the last is full, as far as page ids go
+  std::shared_lock segments_lock(segments_latch_);
+  size_t last = segment_fds_.empty() ? 0 : segment_fds_.size() - 1;
+  int64_t size = GetFileSize(GetSegmentName(last));
+  auto num_pages = static_cast<page_id_t>(last * options_.segment_pages_);
+  if (size > 0) {
+    num_pages += static_cast<page_id_t>((size + PAGE_SIZE - 1) / PAGE_SIZE);
+  }
+  return num_pages;
+}
+
+/**
+ * Returns the page's bit in the free-page bitmap
+ */
+bool DiskManager::IsFreePage(page_id_t page_id) {
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  size_t byte = static_cast<size_t>(page_id) / 8;
+  return byte < free_pages_.size() && (free_pages_[byte] & (1U << (page_id % 8))) != 0;
+}
+
+/**
+ * Private helper function to write one byte of the free-page bitmap
+ */
+void DiskManager::PersistFreePageBit(page_id_t page_id) {
+  if (free_name_.empty()) {
+    return;
+  }
+  if (free_fd_ < 0) {
+    // the bitmap file is only created once the first page is freed
+    free_fd_ = open(free_name_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (free_fd_ < 0) {
+      LOG_DEBUG("can't open free page file");
+      return;
+    }
+  }
+  size_t byte = static_cast<size_t>(page_id) / 8;
+  ssize_t result;
+  do {
+    result = pwrite(free_fd_, &free_pages_[byte], 1, static_cast<off_t>(byte));
+  } while (result < 0 && errno == EINTR);
+  if (result != 1) {
+    LOG_DEBUG("I/O error while writing free page file");
+  }
+}
+
+/**
+ * Private helper function to make the free-page bitmap durable
+ */
+bool DiskManager::SyncFreePages() {
+  if (free_fd_ < 0 || fdatasync(free_fd_) == 0) {
+    return true;
+  }
+  LOG_DEBUG("I/O error while syncing free page file");
+  return false;
 }
 
 /**
@@ -210,10 +608,10 @@ bool DiskManager::GetFlushState() const { return flush_log_; }
 /**
  * Private helper function to get disk file size
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
+int64_t DiskManager::GetFileSize(const std::string &file_name) {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
-  return rc == 0 ? static_cast<int>(stat_buf.st_size) : -1;
+  return rc == 0 ? static_cast<int64_t>(stat_buf.st_size) : -1;
 }
 
 }  // namespace bustub
@@ -0,0 +1,294 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_scheduler.cpp
+//
+// Identification: src/storage/disk/disk_scheduler.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/disk_scheduler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace bustub {
+
+/** The most background writes of consecutive pages written with one WritePages. */
+static constexpr size_t MAX_WRITE_RUN = 64;
+
+struct DiskScheduler::Work {
+  IoPriority priority_;
+  bool is_log_{false};
+  LogEntry log_;
+  /** One entry, or a run of write-only background entries for consecutive pages, in page id order. */
+  std::vector<PageEntry> pages_;
+};
+
+DiskScheduler::DiskScheduler(DiskManager *disk_manager, size_t num_workers) : disk_manager_(disk_manager) {
+  for (size_t i = 0; i < std::max<size_t>(num_workers, 1); i++) {
+    workers_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+DiskScheduler::~DiskScheduler() {
+  {
+    std::scoped_lock lock(latch_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void DiskScheduler::Schedule(DiskRequest request, IoPriority priority) {
+  std::unique_lock lock(latch_);
+  DiskQueueStats &stats = stats_.queues_[static_cast<size_t>(priority)];
+  stats.requests_++;
+  auto it = entries_.find(request.page_id_);
+  if (it == entries_.end()) {
+    PageEntry &entry = entries_[request.page_id_];
+    entry.page_id_ = request.page_id_;
+    entry.priority_ = priority;
+    entry.queued_at_ = std::chrono::steady_clock::now();
+    if (request.is_write_) {
+      entry.write_data_ = request.page_data_;
+      entry.writers_.push_back(std::move(request.callback_));
+    } else {
+      entry.readers_.emplace_back(request.page_data_, std::move(request.callback_));
+    }
+    auto &queue = queues_[static_cast<size_t>(priority)];
+    entry.position_ = queue.insert(queue.end(), request.page_id_);
+    UpdateDepth(priority);
+    lock.unlock();
+    work_cv_.notify_one();
+    return;
+  }
+
+  PageEntry &entry = it->second;
+  stats.merged_++;
+  if (request.is_write_) {
+    // Only the newest data has to reach the disk, but everyone who wrote waits for it.
+    entry.write_data_ = request.page_data_;
+    entry.writers_.push_back(std::move(request.callback_));
+  } else if (entry.write_data_ != nullptr) {
+    // The queued write is what the disk will hold, so there is nothing to read.
+    memcpy(request.page_data_, entry.write_data_, PAGE_SIZE);
+    lock.unlock();
+    request.callback_(true);
+    return;
+  } else {
+    entry.readers_.emplace_back(request.page_data_, std::move(request.callback_));
+  }
+  if (priority < entry.priority_) {
+    Promote(&entry, priority);
+    lock.unlock();
+    work_cv_.notify_one();
+  }
+}
+
+std::future<bool> DiskScheduler::Schedule(bool is_write, page_id_t page_id, char *page_data, IoPriority priority) {
+  auto done = std::make_shared<std::promise<bool>>();
+  std::future<bool> result = done->get_future();
+  Schedule(DiskRequest{is_write, page_id, page_data, [done](bool ok) { done->set_value(ok); }}, priority);
+  return result;
+}
+
+void DiskScheduler::ScheduleLogWrite(char *log_data, int size, DiskCallback callback) {
+  {
+    std::scoped_lock lock(latch_);
+    stats_.queues_[static_cast<size_t>(IoPriority::LOG)].requests_++;
+    log_queue_.push_back(LogEntry{log_data, size, std::move(callback), std::chrono::steady_clock::now()});
+    UpdateDepth(IoPriority::LOG);
+  }
+  work_cv_.notify_one();
+}
+
+void DiskScheduler::SetBackgroundBandwidth(size_t bytes_per_second) {
+  {
+    std::scoped_lock lock(latch_);
+    background_bytes_per_second_ = bytes_per_second;
+    next_background_ = std::chrono::steady_clock::now();
+  }
+  work_cv_.notify_all();
+}
+
+DiskSchedulerStats DiskScheduler::GetStats() {
+  std::scoped_lock lock(latch_);
+  return stats_;
+}
+
+void DiskScheduler::WorkerLoop() {
+  std::unique_lock lock(latch_);
+  while (true) {
+    Work work;
+    auto wake_at = std::chrono::steady_clock::time_point::max();
+    if (TakeWork(&work, &wake_at)) {
+      lock.unlock();
+      Perform(&work);
+      lock.lock();
+      if (work.is_log_) {
+        log_in_flight_ = false;
+      }
+      for (const PageEntry &entry : work.pages_) {
+        pages_in_flight_.erase(entry.page_id_);
+      }
+      // Requests for these pages may have been waiting for them.
+      work_cv_.notify_all();
+      continue;
+    }
+    if (stopping_ && entries_.empty() && log_queue_.empty()) {
+      return;
+    }
+    if (wake_at == std::chrono::steady_clock::time_point::max()) {
+      work_cv_.wait(lock);
+    } else {
+      work_cv_.wait_until(lock, wake_at);
+    }
+  }
+}
+
+bool DiskScheduler::TakeWork(Work *work, std::chrono::steady_clock::time_point *wake_at) {
+  const auto now = std::chrono::steady_clock::now();
+  for (size_t p = 0; p < NUM_IO_PRIORITIES; p++) {
+    const auto priority = static_cast<IoPriority>(p);
+    if (priority == IoPriority::LOG && !log_in_flight_ && !log_queue_.empty()) {
+      work->priority_ = priority;
+      work->is_log_ = true;
+      work->log_ = std::move(log_queue_.front());
+      log_queue_.pop_front();
+      log_in_flight_ = true;
+      RecordWait(priority, work->log_.queued_at_);
+      UpdateDepth(priority);
+      return true;
+    }
+    const bool capped = priority == IoPriority::BACKGROUND && background_bytes_per_second_ != 0 && !stopping_;
+    for (page_id_t page_id : queues_[p]) {
+      if (pages_in_flight_.count(page_id) != 0) {
+        continue;
+      }
+      if (capped && now < next_background_) {
+        *wake_at = next_background_;
+        return false;
+      }
+      work->priority_ = priority;
+      work->pages_.push_back(TakeEntry(page_id));
+      if (priority == IoPriority::BACKGROUND && work->pages_.front().readers_.empty()) {
+        // Gather the write-only background entries next to this page into one run.
+        auto joins = [this](page_id_t id) {
+          auto it = entries_.find(id);
+          return it != entries_.end() && it->second.priority_ == IoPriority::BACKGROUND &&
+                 it->second.readers_.empty() && pages_in_flight_.count(id) == 0;
+        };
+        page_id_t first = page_id;
+        while (first > 0 && work->pages_.size() < MAX_WRITE_RUN && joins(first - 1)) {
+          work->pages_.insert(work->pages_.begin(), TakeEntry(--first));
+        }
+        page_id_t last = page_id;
+        while (work->pages_.size() < MAX_WRITE_RUN && joins(last + 1)) {
+          work->pages_.push_back(TakeEntry(++last));
+        }
+      }
+      auto queued_at = work->pages_.front().queued_at_;
+      for (const PageEntry &entry : work->pages_) {
+        pages_in_flight_.insert(entry.page_id_);
+        queued_at = std::min(queued_at, entry.queued_at_);
+      }
+      RecordWait(priority, queued_at);
+      UpdateDepth(priority);
+      if (capped) {
+        if (queued_at < next_background_) {
+          stats_.throttled_++;
+        }
+        const auto bytes = static_cast<uint64_t>(work->pages_.size()) * PAGE_SIZE;
+        next_background_ = std::max(now, next_background_) +
+                           std::chrono::nanoseconds(bytes * 1000000000 / background_bytes_per_second_);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+DiskScheduler::PageEntry DiskScheduler::TakeEntry(page_id_t page_id) {
+  auto it = entries_.find(page_id);
+  PageEntry entry = std::move(it->second);
+  entries_.erase(it);
+  queues_[static_cast<size_t>(entry.priority_)].erase(entry.position_);
+  return entry;
+}
+
+void DiskScheduler::Perform(Work *work) {
+  if (work->is_log_) {
+    disk_manager_->WriteLog(work->log_.log_data_, work->log_.size_);
+    work->log_.callback_(true);
+    return;
+  }
+  if (work->pages_.size() > 1) {
+    std::vector<const char *> pages_data;
+    pages_data.reserve(work->pages_.size());
+    for (const PageEntry &entry : work->pages_) {
+      pages_data.push_back(entry.write_data_);
+    }
+    disk_manager_->WritePages(work->pages_.front().page_id_, pages_data.data(), pages_data.size());
+    for (PageEntry &entry : work->pages_) {
+      for (auto &callback : entry.writers_) {
+        callback(true);
+      }
+    }
+    return;
+  }
+
+  PageEntry &entry = work->pages_.front();
+  if (!entry.readers_.empty()) {
+    // Everyone reading the page waits for the same read.
+    char *first = entry.readers_.front().first;
+    disk_manager_->ReadPage(entry.page_id_, first);
+    for (auto &[page_data, callback] : entry.readers_) {
+      if (page_data != first) {
+        memcpy(page_data, first, PAGE_SIZE);
+      }
+      callback(true);
+    }
+  }
+  if (entry.write_data_ != nullptr) {
+    disk_manager_->WritePage(entry.page_id_, entry.write_data_);
+    for (auto &callback : entry.writers_) {
+      callback(true);
+    }
+  }
+}
+
+void DiskScheduler::Promote(PageEntry *entry, IoPriority priority) {
+  const IoPriority old_priority = entry->priority_;
+  queues_[static_cast<size_t>(old_priority)].erase(entry->position_);
+  auto &queue = queues_[static_cast<size_t>(priority)];
+  entry->position_ = queue.insert(queue.end(), entry->page_id_);
+  entry->priority_ = priority;
+  UpdateDepth(old_priority);
+  UpdateDepth(priority);
+}
+
+void DiskScheduler::UpdateDepth(IoPriority priority) {
+  DiskQueueStats &stats = stats_.queues_[static_cast<size_t>(priority)];
+  stats.depth_ = queues_[static_cast<size_t>(priority)].size();
+  if (priority == IoPriority::LOG) {
+    stats.depth_ += log_queue_.size();
+  }
+  stats.max_depth_ = std::max(stats.max_depth_, stats.depth_);
+}
+
+void DiskScheduler::RecordWait(IoPriority priority, std::chrono::steady_clock::time_point queued_at) {
+  DiskQueueStats &stats = stats_.queues_[static_cast<size_t>(priority)];
+  const auto wait = std::chrono::steady_clock::now() - queued_at;
+  stats.operations_++;
+  stats.total_wait_ += wait;
+  stats.max_wait_ = std::max<std::chrono::nanoseconds>(stats.max_wait_, wait);
+}
+
+}  // namespace bustub
@@ -0,0 +1,169 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_codec.cpp
+//
+// Identification: src/storage/disk/page_codec.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/page_codec.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+
+/** The hash table of recent 4-byte sequences has 2^HASH_BITS entries. */
+constexpr int HASH_BITS = 12;
+/** The longest distance a 2-byte offset can reach back. */
+constexpr size_t MAX_DISTANCE = 65535;
+/** A nibble of this value means the length continues in extra bytes. */
+constexpr size_t NIBBLE_MAX = 15;
+
+uint32_t Read32(const char *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+size_t Hash(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - HASH_BITS); }
+
+/** @return the number of extra bytes a length needs after its nibble */
+size_t ExtraBytes(size_t length) { return length < NIBBLE_MAX ? 0 : (length - NIBBLE_MAX) / 255 + 1; }
+
+void WriteExtra(size_t length, uint8_t **out) {
+  if (length < NIBBLE_MAX) {
+    return;
+  }
+  length -= NIBBLE_MAX;
+  while (length >= 255) {
+    *(*out)++ = 255;
+    length -= 255;
+  }
+  *(*out)++ = static_cast<uint8_t>(length);
+}
+
+/** Reads the extra bytes of a length whose nibble was 15. @return false if the input ends first */
+bool ReadExtra(size_t nibble, const uint8_t **in, const uint8_t *end, size_t *length) {
+  *length = nibble;
+  if (nibble < NIBBLE_MAX) {
+    return true;
+  }
+  uint8_t byte;
+  do {
+    if (*in == end) {
+      return false;
+    }
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Appends one sequence: literals, then a match unless match_length is 0.
+ * @return false if it does not fit before out_end
+ */
+bool EmitSequence(const char *literals, size_t literal_length, size_t distance, size_t match_length, uint8_t **out,
+                  const uint8_t *out_end) {
+  const size_t match_code = match_length == 0 ? 0 : match_length - PageCodec::MIN_MATCH;
+  const size_t size = 1 + ExtraBytes(literal_length) + literal_length + (match_length == 0 ? 0 : 2) +
+                      (match_length == 0 ? 0 : ExtraBytes(match_code));
+  if (size > static_cast<size_t>(out_end - *out)) {
+    return false;
+  }
+  *(*out)++ = static_cast<uint8_t>((std::min(literal_length, NIBBLE_MAX) << 4) | std::min(match_code, NIBBLE_MAX));
+  WriteExtra(literal_length, out);
+  memcpy(*out, literals, literal_length);
+  *out += literal_length;
+  if (match_length > 0) {
+    *(*out)++ = static_cast<uint8_t>(distance & 0xff);
+    *(*out)++ = static_cast<uint8_t>(distance >> 8);
+    WriteExtra(match_code, out);
+  }
+  return true;
+}
+
+}  // namespace
+
+size_t PageCodec::Compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) {
+  // Positions are 1-based so that 0 can mean an empty entry.
+  std::array<uint32_t, 1 << HASH_BITS> table{};
+  auto *out = reinterpret_cast<uint8_t *>(dst);
+  const auto *out_end = out + dst_capacity;
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (pos + MIN_MATCH <= src_size) {
+    const uint32_t sequence = Read32(src + pos);
+    uint32_t &entry = table[Hash(sequence)];
+    const size_t candidate = entry - 1;
+    const bool hit = entry != 0 && pos - candidate <= MAX_DISTANCE && Read32(src + candidate) == sequence;
+    entry = static_cast<uint32_t>(pos + 1);
+    if (!hit) {
+      pos++;
+      continue;
+    }
+    size_t match_length = MIN_MATCH;
+    while (pos + match_length < src_size && src[candidate + match_length] == src[pos + match_length]) {
+      match_length++;
+    }
+    if (!EmitSequence(src + anchor, pos - anchor, pos - candidate, match_length, &out, out_end)) {
+      return 0;
+    }
+    pos += match_length;
+    anchor = pos;
+  }
+  if (!EmitSequence(src + anchor, src_size - anchor, 0, 0, &out, out_end)) {
+    return 0;
+  }
+  return out - reinterpret_cast<uint8_t *>(dst);
+}
+
+bool PageCodec::Decompress(const char *src, size_t src_size, char *dst, size_t dst_size) {
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  const auto *end = in + src_size;
+  size_t out = 0;
+  while (in < end) {
+    const uint8_t token = *in++;
+    size_t literal_length;
+    if (!ReadExtra(token >> 4, &in, end, &literal_length) || literal_length > static_cast<size_t>(end - in) ||
+        literal_length > dst_size - out) {
+      return false;
+    }
+    memcpy(dst + out, in, literal_length);
+    in += literal_length;
+    out += literal_length;
+    if (in == end) {
+      break;
+    }
+    if (end - in < 2) {
+      return false;
+    }
+    const size_t distance = in[0] | (static_cast<size_t>(in[1]) << 8);
+    in += 2;
+    size_t match_length;
+    if (!ReadExtra(token & NIBBLE_MAX, &in, end, &match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (distance == 0 || distance > out || match_length > dst_size - out) {
+      return false;
+    }
+    // Byte by byte, since a match may overlap the bytes it produces.
+    for (size_t i = 0; i < match_length; i++) {
+      dst[out + i] = dst[out - distance + i];
+    }
+    out += match_length;
+  }
+  return out == dst_size;
+}
+
+}  // namespace bustub
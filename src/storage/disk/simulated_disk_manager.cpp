@@ -0,0 +1,141 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// simulated_disk_manager.cpp
+//
+// Identification: src/storage/disk/simulated_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/simulated_disk_manager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>  // NOLINT
+
+namespace bustub {
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+/** The last stretch of a simulated request that WaitUntil spins through instead of sleeping. */
+static constexpr microseconds SPIN_TIME(200);
+
+DiskProfile DiskProfile::Nvme() {
+  return {microseconds(80), microseconds(20), nanoseconds(0), microseconds(50), 3000000000ULL, 32};
+}
+
+DiskProfile DiskProfile::SataSsd() {
+  return {microseconds(100), microseconds(60), nanoseconds(0), microseconds(500), 550000000ULL, 8};
+}
+
+DiskProfile DiskProfile::Hdd() {
+  return {microseconds(100), microseconds(100), milliseconds(8), milliseconds(10), 160000000ULL, 1};
+}
+
+DiskProfile DiskProfile::FixedLatency(nanoseconds latency) {
+  // Enough channels that no request ever waits for another.
+  return {latency, latency, nanoseconds(0), nanoseconds(0), 0, 1024};
+}
+
+SimulatedDiskManager::SimulatedDiskManager(const std::string &db_file, const DiskProfile &profile)
+    : DiskManager(db_file), profile_(profile), channels_(std::max<size_t>(profile.parallelism_, 1)) {
+  const page_id_t num_pages = DiskManager::GetNumStoredPages();
+  pages_.resize(num_pages);
+  for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+    pages_[page_id] = std::make_unique<char[]>(PAGE_SIZE);
+    DiskManager::ReadPage(page_id, pages_[page_id].get());
+  }
+}
+
+void SimulatedDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  WaitUntil(Book(page_id, 1, profile_.write_latency_));
+  std::scoped_lock lock(pages_latch_);
+  memcpy(GetPage(page_id), page_data, PAGE_SIZE);
+  num_writes_ += 1;
+}
+
+void SimulatedDiskManager::WritePages(page_id_t first_page_id, const char *const *pages_data, size_t num_pages) {
+  WaitUntil(Book(first_page_id, num_pages, profile_.write_latency_));
+  std::scoped_lock lock(pages_latch_);
+  for (size_t i = 0; i < num_pages; i++) {
+    memcpy(GetPage(first_page_id + static_cast<page_id_t>(i)), pages_data[i], PAGE_SIZE);
+  }
+  num_writes_ += static_cast<int>(num_pages);
+}
+
+void SimulatedDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  WaitUntil(Book(page_id, 1, profile_.read_latency_));
+  num_reads_++;
+  std::scoped_lock lock(pages_latch_);
+  if (static_cast<size_t>(page_id) >= pages_.size() || pages_[page_id] == nullptr) {
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  memcpy(page_data, pages_[page_id].get(), PAGE_SIZE);
+}
+
+bool SimulatedDiskManager::Sync() {
+  steady_clock::time_point done;
+  {
+    std::scoped_lock lock(device_latch_);
+    // A sync is a barrier: it starts once every channel is idle and holds them all until it is done.
+    done = std::max(steady_clock::now(), *std::max_element(channels_.begin(), channels_.end()));
+    done = std::max(done, transfer_free_) + profile_.sync_latency_;
+    std::fill(channels_.begin(), channels_.end(), done);
+  }
+  WaitUntil(done);
+  num_syncs_ += 1;
+  return true;
+}
+
+page_id_t SimulatedDiskManager::GetNumStoredPages() {
+  std::scoped_lock lock(pages_latch_);
+  return static_cast<page_id_t>(pages_.size());
+}
+
+steady_clock::time_point SimulatedDiskManager::Book(page_id_t first_page_id, size_t num_pages, nanoseconds latency) {
+  std::scoped_lock lock(device_latch_);
+  const auto now = steady_clock::now();
+  auto channel = std::min_element(channels_.begin(), channels_.end());
+  auto start = std::max(now, *channel) + latency;
+  if (profile_.seek_time_.count() > 0 && first_page_id != next_page_) {
+    start += profile_.seek_time_;
+    num_seeks_++;
+  }
+  next_page_ = first_page_id + static_cast<page_id_t>(num_pages);
+  auto done = start;
+  if (profile_.bandwidth_ != 0) {
+    const uint64_t bytes = static_cast<uint64_t>(num_pages) * PAGE_SIZE;
+    done = std::max(start, transfer_free_) + nanoseconds(bytes * 1000000000ULL / profile_.bandwidth_);
+    transfer_free_ = done;
+  }
+  *channel = done;
+  return done;
+}
+
+void SimulatedDiskManager::WaitUntil(steady_clock::time_point deadline) {
+  if (deadline - steady_clock::now() > SPIN_TIME) {
+    std::this_thread::sleep_until(deadline - SPIN_TIME);
+  }
+  while (steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+}
+
+char *SimulatedDiskManager::GetPage(page_id_t page_id) {
+  if (static_cast<size_t>(page_id) >= pages_.size()) {
+    pages_.resize(page_id + 1);
+  }
+  if (pages_[page_id] == nullptr) {
+    pages_[page_id] = std::make_unique<char[]>(PAGE_SIZE);
+  }
+  return pages_[page_id].get();
+}
+
+}  // namespace bustub
@@ -9,7 +9,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <optional>
 #include <string>
+#include <thread>  // NOLINT
+#include <type_traits>
 
 #include "common/exception.h"
 #include "common/rid.h"
@@ -17,6 +21,10 @@
 #include "storage/page/header_page.h"
 
 namespace bustub {
+
+/** How many times a traversal starts over optimistically before it falls back to latch crabbing. */
+static constexpr int MAX_OPTIMISTIC_ATTEMPTS = 8;
+
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
                           int leaf_max_size, int internal_max_size)
@@ -27,11 +35,22 @@ BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manag
       leaf_max_size_(leaf_max_size),
       internal_max_size_(internal_max_size) {}
 
+INDEX_TEMPLATE_ARGUMENTS
+BPLUSTREE_TYPE::~BPlusTree() {
+  // A page still pinned now is left behind; nobody can reach it anymore to delete it later.
+  DeleteDeferredPages();
+}
+
 /*
  * Helper function to decide whether current b+tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::IsEmpty() const { return true; }
+bool BPLUSTREE_TYPE::IsEmpty() const {
+  root_latch_.RLock();
+  bool empty = root_page_id_ == INVALID_PAGE_ID;
+  root_latch_.RUnlock();
+  return empty;
+}
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
@@ -42,7 +61,18 @@ bool BPLUSTREE_TYPE::IsEmpty() const { return true; }
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) {
-  return false;
+  Page *page = FindLeafPage(key);
+  if (page == nullptr) {
+    return false;
+  }
+  ValueType value;
+  bool found = reinterpret_cast<LeafPage *>(page->GetData())->Lookup(key, &value, comparator_);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinFrame(page, false);
+  if (found) {
+    result->push_back(value);
+  }
+  return found;
 }
 
 /*****************************************************************************
@@ -56,7 +86,46 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
  * keys return false, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) { return false; }
+bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) {
+  if (optimistic_) {
+    Page *page = FindLeafPageOptimistic(key, false, true);
+    if (page != nullptr) {
+      auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+      ValueType existing;
+      bool duplicate = leaf->Lookup(key, &existing, comparator_);
+      bool fits = !duplicate && IsSafe(leaf, Operation::INSERT);
+      if (fits) {
+        leaf->Insert(key, value, comparator_);
+      }
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinFrame(page, fits);
+      DeleteDeferredPages();
+      if (duplicate || fits) {
+        return fits;
+      }
+      // The leaf has to split, which takes latch crabbing.
+    }
+  }
+
+  // The page set lives in a transaction; callers outside of one get a scratch transaction.
+  std::optional<Transaction> local_transaction;
+  if (transaction == nullptr) {
+    transaction = &local_transaction.emplace(INVALID_TXN_ID);
+  }
+  root_latch_.WLock();
+  transaction->AddIntoPageSet(nullptr);
+  try {
+    if (root_page_id_ == INVALID_PAGE_ID) {
+      StartNewTree(key, value);
+      ReleaseWriteLatches(transaction, true);
+      return true;
+    }
+    return InsertIntoLeaf(key, value, transaction);
+  } catch (Exception &) {
+    ReleaseWriteLatches(transaction, true);
+    throw;
+  }
+}
 /*
  * Insert constant key & value pair into an empty tree
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
@@ -64,7 +133,19 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
  * tree's root page id and insert entry directly into leaf page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {}
+void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate the root page of a B+ tree");
+  }
+  auto *root = reinterpret_cast<LeafPage *>(page->GetData());
+  root->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);
+  root->Insert(key, value, comparator_);
+  root_page_id_ = page_id;
+  UpdateRootPageId(1);
+  buffer_pool_manager_->UnpinFrame(page, true);
+}
 
 /*
  * Insert constant key & value pair into leaf page
@@ -76,7 +157,22 @@ void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {}
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction) {
-  return false;
+  Page *page = FindLeafPageWrite(key, Operation::INSERT, transaction);
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int size = leaf->GetSize();
+  if (leaf->Insert(key, value, comparator_) == size) {
+    ReleaseWriteLatches(transaction, false);
+    return false;
+  }
+  if (leaf->GetSize() >= leaf->GetMaxSize()) {
+    LeafPage *sibling = Split(leaf);
+    sibling->SetNextPageId(leaf->GetNextPageId());
+    leaf->SetNextPageId(sibling->GetPageId());
+    InsertIntoParent(leaf, sibling->KeyAt(0), sibling, transaction);
+    buffer_pool_manager_->UnpinPage(sibling->GetPageId(), true);
+  }
+  ReleaseWriteLatches(transaction, true);
+  return true;
 }
 
 /*
@@ -89,7 +185,21 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 N *BPLUSTREE_TYPE::Split(N *node) {
-  return nullptr;
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate a page to split a B+ tree page");
+  }
+  // The new page needs no latch: until the latched node and parent are released, nobody else can reach it.
+  auto *sibling = reinterpret_cast<N *>(page->GetData());
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    sibling->Init(page_id, node->GetParentPageId(), leaf_max_size_);
+    node->MoveHalfTo(sibling);
+  } else {
+    sibling->Init(page_id, node->GetParentPageId(), internal_max_size_);
+    node->MoveHalfTo(sibling, buffer_pool_manager_);
+  }
+  return sibling;
 }
 
 /*
@@ -103,7 +213,36 @@ N *BPLUSTREE_TYPE::Split(N *node) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                                      Transaction *transaction) {}
+                                      Transaction *transaction) {
+  if (old_node->IsRootPage()) {
+    // The old root was not safe, so root_latch_ is still held.
+    page_id_t root_page_id;
+    Page *page = buffer_pool_manager_->NewPage(&root_page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate a new root page of a B+ tree");
+    }
+    auto *root = reinterpret_cast<InternalPage *>(page->GetData());
+    root->Init(root_page_id, INVALID_PAGE_ID, internal_max_size_);
+    root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+    old_node->SetParentPageId(root_page_id);
+    new_node->SetParentPageId(root_page_id);
+    root_page_id_ = root_page_id;
+    UpdateRootPageId();
+    buffer_pool_manager_->UnpinFrame(page, true);
+    return;
+  }
+
+  // The parent is still latched in the page set, since old_node was not safe.
+  Page *parent_page = FetchPageOrThrow(old_node->GetParentPageId());
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  parent->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+  if (parent->GetSize() > parent->GetMaxSize()) {
+    InternalPage *sibling = Split(parent);
+    InsertIntoParent(parent, sibling->KeyAt(0), sibling, transaction);
+    buffer_pool_manager_->UnpinPage(sibling->GetPageId(), true);
+  }
+  buffer_pool_manager_->UnpinFrame(parent_page, true);
+}
 
 /*****************************************************************************
  * REMOVE
@@ -116,7 +255,53 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  * necessary.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
+void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
+  if (optimistic_) {
+    Page *page = FindLeafPageOptimistic(key, false, true);
+    if (page != nullptr) {
+      auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+      ValueType existing;
+      bool missing = !leaf->Lookup(key, &existing, comparator_);
+      bool fits = !missing && IsSafe(leaf, Operation::DELETE);
+      if (fits) {
+        leaf->RemoveAndDeleteRecord(key, comparator_);
+      }
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinFrame(page, fits);
+      DeleteDeferredPages();
+      if (missing || fits) {
+        return;
+      }
+      // The leaf has to merge or borrow, which takes latch crabbing.
+    }
+  }
+
+  // The page set lives in a transaction; callers outside of one get a scratch transaction.
+  std::optional<Transaction> local_transaction;
+  if (transaction == nullptr) {
+    transaction = &local_transaction.emplace(INVALID_TXN_ID);
+  }
+  root_latch_.WLock();
+  transaction->AddIntoPageSet(nullptr);
+  if (root_page_id_ == INVALID_PAGE_ID) {
+    ReleaseWriteLatches(transaction, false);
+    return;
+  }
+  try {
+    Page *page = FindLeafPageWrite(key, Operation::DELETE, transaction);
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    int size = leaf->GetSize();
+    if (leaf->RemoveAndDeleteRecord(key, comparator_) == size) {
+      ReleaseWriteLatches(transaction, false);
+      return;
+    }
+    CoalesceOrRedistribute(leaf, transaction);
+    ReleaseWriteLatches(transaction, true);
+  } catch (Exception &) {
+    ReleaseWriteLatches(transaction, true);
+    throw;
+  }
+}
 
 /*
  * User needs to first find the sibling of input page. If sibling's size + input
@@ -128,7 +313,39 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
-  return false;
+  if (node->IsRootPage()) {
+    if (!AdjustRoot(node)) {
+      return false;
+    }
+    transaction->AddIntoDeletedPageSet(node->GetPageId());
+    return true;
+  }
+  if (node->GetSize() >= node->GetMinSize()) {
+    return false;
+  }
+
+  // The parent is still latched in the page set, since node was not safe. The sibling is latched here; whoever else
+  // holds it has released its parent, so it does not wait for anything this thread holds.
+  Page *parent_page = FetchPageOrThrow(node->GetParentPageId());
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  int index = parent->ValueIndex(node->GetPageId());
+  Page *neighbor_page = FetchPageOrThrow(parent->ValueAt(index == 0 ? 1 : index - 1));
+  neighbor_page->WLatch();
+  auto *neighbor = reinterpret_cast<N *>(neighbor_page->GetData());
+
+  bool fits = node->IsLeafPage() ? neighbor->GetSize() + node->GetSize() < node->GetMaxSize()
+                                 : neighbor->GetSize() + node->GetSize() <= node->GetMaxSize();
+  bool node_deleted = false;
+  if (fits) {
+    node_deleted = index != 0;
+    Coalesce(&neighbor, &node, &parent, index, transaction);
+  } else {
+    Redistribute(neighbor, node, index);
+  }
+  neighbor_page->WUnlatch();
+  buffer_pool_manager_->UnpinFrame(neighbor_page, true);
+  buffer_pool_manager_->UnpinFrame(parent_page, true);
+  return node_deleted;
 }
 
 /*
@@ -148,7 +365,20 @@ template <typename N>
 bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
                               BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent, int index,
                               Transaction *transaction) {
-  return false;
+  // Always move the right page into the left one, so the leaf chain only needs the left page's next page id.
+  if (index == 0) {
+    std::swap(*neighbor_node, *node);
+    index = 1;
+  }
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    (*node)->MoveAllTo(*neighbor_node);
+  } else {
+    (*node)->MoveAllTo(*neighbor_node, (*parent)->KeyAt(index), buffer_pool_manager_);
+  }
+  (*parent)->Remove(index);
+  // The page is deleted once every latch is released.
+  transaction->AddIntoDeletedPageSet((*node)->GetPageId());
+  return CoalesceOrRedistribute(*parent, transaction);
 }
 
 /*
@@ -162,7 +392,26 @@ bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
+void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
+  Page *parent_page = FetchPageOrThrow(node->GetParentPageId());
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  if (index == 0) {
+    if constexpr (std::is_same_v<N, LeafPage>) {
+      neighbor_node->MoveFirstToEndOf(node);
+    } else {
+      neighbor_node->MoveFirstToEndOf(node, parent->KeyAt(1), buffer_pool_manager_);
+    }
+    parent->SetKeyAt(1, neighbor_node->KeyAt(0));
+  } else {
+    if constexpr (std::is_same_v<N, LeafPage>) {
+      neighbor_node->MoveLastToFrontOf(node);
+    } else {
+      neighbor_node->MoveLastToFrontOf(node, parent->KeyAt(index), buffer_pool_manager_);
+    }
+    parent->SetKeyAt(index, node->KeyAt(0));
+  }
+  buffer_pool_manager_->UnpinFrame(parent_page, true);
+}
 /*
  * Update root page if necessary
  * NOTE: size of root page can be less than min size and this method is only
@@ -174,7 +423,27 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
  * happend
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
+bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
+  // The root was not safe, so root_latch_ is still held.
+  if (old_root_node->IsLeafPage()) {
+    if (old_root_node->GetSize() > 0) {
+      return false;
+    }
+    root_page_id_ = INVALID_PAGE_ID;
+    UpdateRootPageId();
+    return true;
+  }
+  if (old_root_node->GetSize() > 1) {
+    return false;
+  }
+  page_id_t child_page_id = reinterpret_cast<InternalPage *>(old_root_node)->RemoveAndReturnOnlyChild();
+  Page *child_page = FetchPageOrThrow(child_page_id);
+  reinterpret_cast<BPlusTreePage *>(child_page->GetData())->SetParentPageId(INVALID_PAGE_ID);
+  buffer_pool_manager_->UnpinFrame(child_page, true);
+  root_page_id_ = child_page_id;
+  UpdateRootPageId();
+  return true;
+}
 
 /*****************************************************************************
  * INDEX ITERATOR
@@ -185,7 +454,9 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, FindLeafPage(KeyType(), true), 0);
+}
 
 /*
  * Input parameter is low key, find the leaf page that contains the input key
@@ -193,7 +464,11 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
+  Page *page = FindLeafPage(key);
+  int index = page == nullptr ? 0 : reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(key, comparator_);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, index);
+}
 
 /*
  * Input parameter is void, construct an index iterator representing the end
@@ -212,7 +487,208 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::End() { return INDEXITERATOR_TYPE(); }
  */
 INDEX_TEMPLATE_ARGUMENTS
 Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
-  throw Exception(ExceptionType::NOT_IMPLEMENTED, "Implement this for test");
+  if (optimistic_) {
+    Page *page = FindLeafPageOptimistic(key, leftMost, false);
+    if (page != nullptr) {
+      return page;
+    }
+  }
+  return FindLeafPageRead(key, leftMost);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageRead(const KeyType &key, bool leftMost) {
+  root_latch_.RLock();
+  if (root_page_id_ == INVALID_PAGE_ID) {
+    root_latch_.RUnlock();
+    return nullptr;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+  if (page == nullptr) {
+    root_latch_.RUnlock();
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch the root page of a B+ tree");
+  }
+  page->RLatch();
+  root_latch_.RUnlock();
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  while (!node->IsLeafPage()) {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    Page *child = buffer_pool_manager_->FetchPage(leftMost ? internal->ValueAt(0) : internal->Lookup(key, comparator_));
+    if (child == nullptr) {
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinFrame(page, false);
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch a page of a B+ tree");
+    }
+    child->RLatch();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinFrame(page, false);
+    page = child;
+    node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  }
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageOptimistic(const KeyType &key, bool leftMost, bool exclusive) {
+  Page *leaf = nullptr;
+  for (int attempt = 0; attempt < MAX_OPTIMISTIC_ATTEMPTS; attempt++) {
+    if (TryFindLeafPageOptimistic(key, leftMost, exclusive, &leaf)) {
+      return leaf;
+    }
+    // Give the writer that got in the way a chance to finish.
+    std::this_thread::yield();
+  }
+  return nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::TryFindLeafPageOptimistic(const KeyType &key, bool leftMost, bool exclusive, Page **leaf) {
+  *leaf = nullptr;
+  page_id_t root_page_id = root_page_id_.load();
+  if (root_page_id == INVALID_PAGE_ID) {
+    return true;
+  }
+  Page *page = FetchPageOrThrow(root_page_id);
+  uint64_t version = page->OptimisticRead();
+  // A new root is installed while the old one is write-latched, so a root that is still current at this version stays
+  // current until the version changes.
+  if (root_page_id_.load() != root_page_id) {
+    buffer_pool_manager_->UnpinFrame(page, false);
+    return false;
+  }
+  Page *parent = nullptr;
+  uint64_t parent_version = 0;
+  while (true) {
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (node->IsLeafPage()) {
+      if (exclusive) {
+        page->WLatch();
+      } else {
+        page->RLatch();
+      }
+      // A leaf only stops covering the key through a change to its parent, or to the root page id if it is the root.
+      bool valid = parent == nullptr ? root_page_id_.load() == root_page_id : parent->Validate(parent_version);
+      if (parent != nullptr) {
+        buffer_pool_manager_->UnpinFrame(parent, false);
+      }
+      if (!valid) {
+        if (exclusive) {
+          page->WUnlatch();
+        } else {
+          page->RUnlatch();
+        }
+        buffer_pool_manager_->UnpinFrame(page, false);
+        return false;
+      }
+      *leaf = page;
+      return true;
+    }
+
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    page_id_t child_page_id = leftMost ? internal->ValueAt(0) : internal->Lookup(key, comparator_);
+    // Only fetch a child id read from a consistent page, and only trust the child if the page still had not changed
+    // when the child's version was read.
+    bool valid = page->Validate(version);
+    Page *child = valid ? buffer_pool_manager_->FetchPage(child_page_id) : nullptr;
+    uint64_t child_version = child == nullptr ? 0 : child->OptimisticRead();
+    if (child == nullptr || !page->Validate(version)) {
+      if (child != nullptr) {
+        buffer_pool_manager_->UnpinFrame(child, false);
+      }
+      buffer_pool_manager_->UnpinFrame(page, false);
+      if (parent != nullptr) {
+        buffer_pool_manager_->UnpinFrame(parent, false);
+      }
+      if (valid && child == nullptr) {
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch a page of a B+ tree");
+      }
+      return false;
+    }
+    if (parent != nullptr) {
+      buffer_pool_manager_->UnpinFrame(parent, false);
+    }
+    parent = page;
+    parent_version = version;
+    page = child;
+    version = child_version;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageWrite(const KeyType &key, Operation op, Transaction *transaction) {
+  Page *page = FetchPageOrThrow(root_page_id_);
+  while (true) {
+    page->WLatch();
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (IsSafe(node, op)) {
+      ReleaseWriteLatches(transaction, false);
+    }
+    transaction->AddIntoPageSet(page);
+    if (node->IsLeafPage()) {
+      return page;
+    }
+    page = FetchPageOrThrow(reinterpret_cast<InternalPage *>(node)->Lookup(key, comparator_));
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op) const {
+  if (op == Operation::INSERT) {
+    return node->IsLeafPage() ? node->GetSize() + 1 < node->GetMaxSize() : node->GetSize() < node->GetMaxSize();
+  }
+  if (op == Operation::DELETE) {
+    if (node->IsRootPage()) {
+      // A root leaf goes away when it is emptied, a root internal page when it is down to one child.
+      return node->GetSize() > (node->IsLeafPage() ? 1 : 2);
+    }
+    return node->GetSize() > node->GetMinSize();
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseWriteLatches(Transaction *transaction, bool is_dirty) {
+  auto page_set = transaction->GetPageSet();
+  for (Page *page : *page_set) {
+    if (page == nullptr) {
+      root_latch_.WUnlock();
+    } else {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinFrame(page, is_dirty);
+    }
+  }
+  page_set->clear();
+  auto deleted_page_set = transaction->GetDeletedPageSet();
+  if (!deleted_page_set->empty()) {
+    std::scoped_lock lock(deferred_deletes_latch_);
+    deferred_deletes_.insert(deferred_deletes_.end(), deleted_page_set->begin(), deleted_page_set->end());
+    num_deferred_deletes_ = deferred_deletes_.size();
+    deleted_page_set->clear();
+  }
+  DeleteDeferredPages();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeleteDeferredPages() {
+  // Optimistic readers and iterators may still have a page pinned, which makes DeletePage fail. Such pages are no
+  // longer reachable, so they are simply tried again whenever a write releases its latches.
+  if (num_deferred_deletes_ == 0) {
+    return;
+  }
+  std::scoped_lock lock(deferred_deletes_latch_);
+  auto deleted = std::remove_if(deferred_deletes_.begin(), deferred_deletes_.end(),
+                                [this](page_id_t page_id) { return buffer_pool_manager_->DeletePage(page_id); });
+  deferred_deletes_.erase(deleted, deferred_deletes_.end());
+  num_deferred_deletes_ = deferred_deletes_.size();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FetchPageOrThrow(page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch a page of a B+ tree");
+  }
+  return page;
 }
 
 /*
@@ -225,14 +701,15 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
-  HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
-  if (insert_record != 0) {
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
-  } else {
+  HeaderPage *header_page = static_cast<HeaderPage *>(FetchPageOrThrow(HEADER_PAGE_ID));
+  // Other indexes share the header page.
+  header_page->WLatch();
+  // A tree that was emptied and grows again already has its record.
+  if (insert_record == 0 || !header_page->InsertRecord(index_name_, root_page_id_)) {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
+  header_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
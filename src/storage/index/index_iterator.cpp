@@ -3,28 +3,95 @@
  */
 #include <cassert>
 
+#include "common/exception.h"
 #include "storage/index/index_iterator.h"
 
 namespace bustub {
 
-/*
- * NOTE: you can change the destructor/constructor method here
- * set your own input parameters
- */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator() = default;
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() = default;
+INDEXITERATOR_TYPE::IndexIterator(BufferPoolManager *buffer_pool_manager, Page *page, int index)
+    : buffer_pool_manager_(buffer_pool_manager), page_(page), index_(index) {
+  if (page_ != nullptr) {
+    leaf_ = reinterpret_cast<LeafPage *>(page_->GetData());
+    SkipExhaustedLeaves();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::~IndexIterator() { Release(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&that) noexcept
+    : buffer_pool_manager_(that.buffer_pool_manager_), page_(that.page_), leaf_(that.leaf_), index_(that.index_) {
+  that.page_ = nullptr;
+  that.leaf_ = nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator=(IndexIterator &&that) noexcept {
+  if (this != &that) {
+    Release();
+    buffer_pool_manager_ = that.buffer_pool_manager_;
+    page_ = that.page_;
+    leaf_ = that.leaf_;
+    index_ = that.index_;
+    that.page_ = nullptr;
+    that.leaf_ = nullptr;
+  }
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::IsEnd() { return page_ == nullptr; }
+
+INDEX_TEMPLATE_ARGUMENTS
+const MappingType &INDEXITERATOR_TYPE::operator*() {
+  assert(page_ != nullptr);
+  return leaf_->GetItem(index_);
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-bool INDEXITERATOR_TYPE::IsEnd() { throw std::runtime_error("unimplemented"); }
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
+  assert(page_ != nullptr);
+  index_++;
+  SkipExhaustedLeaves();
+  return *this;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &INDEXITERATOR_TYPE::operator*() { throw std::runtime_error("unimplemented"); }
+void INDEXITERATOR_TYPE::SkipExhaustedLeaves() {
+  // A leaf emptied by a merge still links to its old successor, so it is skipped like any other exhausted leaf.
+  while (page_ != nullptr && index_ >= leaf_->GetSize()) {
+    page_id_t next_page_id = leaf_->GetNextPageId();
+    if (next_page_id == INVALID_PAGE_ID) {
+      Release();
+      return;
+    }
+    Page *next = buffer_pool_manager_->FetchPage(next_page_id);
+    // The leaf is released before throwing: an iterator that throws from its constructor is never destroyed.
+    Release();
+    if (next == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch the next leaf of a B+ tree");
+    }
+    next->RLatch();
+    page_ = next;
+    leaf_ = reinterpret_cast<LeafPage *>(next->GetData());
+    index_ = 0;
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() { throw std::runtime_error("unimplemented"); }
+void INDEXITERATOR_TYPE::Release() {
+  if (page_ != nullptr) {
+    page_->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+    page_ = nullptr;
+    leaf_ = nullptr;
+  }
+}
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
@@ -19,6 +19,23 @@
 
 namespace bustub {
 
+/** Copies size bytes with relaxed atomic loads, four at a time where the source allows it. */
+static void AtomicLoadBytes(void *dst, const void *src, size_t size) {
+  if (reinterpret_cast<uintptr_t>(src) % alignof(uint32_t) == 0 && size % sizeof(uint32_t) == 0) {
+    auto *to = static_cast<uint32_t *>(dst);
+    const auto *from = static_cast<const uint32_t *>(src);
+    for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+      to[i] = __atomic_load_n(from + i, __ATOMIC_RELAXED);
+    }
+    return;
+  }
+  auto *to = static_cast<uint8_t *>(dst);
+  const auto *from = static_cast<const uint8_t *>(src);
+  for (size_t i = 0; i < size; i++) {
+    to[i] = __atomic_load_n(from + i, __ATOMIC_RELAXED);
+  }
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) {
   bool res = false;
@@ -31,6 +48,29 @@ bool HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vecto
   return res;
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_BUCKET_TYPE::GetValueOptimistic(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) const {
+  bool res = false;
+  for (size_t byte = 0; byte < sizeof(readable_); byte++) {
+    auto bits = __atomic_load_n(reinterpret_cast<const uint8_t *>(&readable_[byte]), __ATOMIC_RELAXED);
+    for (; bits != 0; bits &= bits - 1) {
+      const size_t i = byte * 8 + __builtin_ctz(bits);
+      if (i >= BUCKET_ARRAY_SIZE) {
+        break;
+      }
+      // A slot being written may read torn; the caller's validation throws such a result away.
+      alignas(MappingType) char slot[sizeof(MappingType)];
+      AtomicLoadBytes(slot, &array_[i], sizeof(MappingType));
+      const auto *pair = reinterpret_cast<const MappingType *>(slot);
+      if (cmp(key, pair->first) == 0) {
+        result->push_back(pair->second);
+        res = true;
+      }
+    }
+  }
+  return res;
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator cmp) {
   int64_t free_slot = -1;
@@ -11,14 +11,109 @@
 //===----------------------------------------------------------------------===//
 
 #include <cassert>
+#include <mutex>  // NOLINT
 
+#include "storage/page/page_guard.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+/**
+ * ReadAhead keeps up to window pages of the table queued for prefetching ahead of the page the scan is on.
+ *
+ * A table is a linked list of pages, so the id of page n + 1 is only known once page n is in memory. The prefetch
+ * callback of each page therefore issues the next link, until the chain is window pages ahead of the scan; the link
+ * after that is parked and issued once the scan moves on. Whenever the scan catches up with the chain, because a
+ * request was dropped or the scan is simply faster than the disk, the chain restarts from the scan's page.
+ *
+ * Positions count pages from the start of the scan. Prefetched pages go through the shared replacer even when the scan
+ * uses a buffer ring.
+ */
+class TableIterator::ReadAhead : public std::enable_shared_from_this<ReadAhead> {
+ public:
+  ReadAhead(BufferPoolManager *bpm, size_t window) : bpm_(bpm), window_(window) {}
+
+  /** Tells the read-ahead which page the scan is on. Calls for the page it already reported are ignored. */
+  void OnScanPage(page_id_t page_id, page_id_t next_page_id) {
+    page_id_t issue_page_id = INVALID_PAGE_ID;
+    int64_t issue_position;
+    {
+      std::lock_guard<std::mutex> guard(latch_);
+      if (page_id == scan_page_id_) {
+        return;
+      }
+      scan_page_id_ = page_id;
+      scan_position_++;
+      if (frontier_ <= scan_position_) {
+        // Nothing is in flight ahead of the scan: start a new chain from here.
+        pending_page_id_ = INVALID_PAGE_ID;
+        frontier_ = scan_position_;
+        issue_page_id = next_page_id;
+        issue_position = scan_position_ + 1;
+      } else if (pending_page_id_ != INVALID_PAGE_ID && InWindow(pending_position_)) {
+        issue_page_id = pending_page_id_;
+        issue_position = pending_position_;
+        pending_page_id_ = INVALID_PAGE_ID;
+      }
+      if (issue_page_id != INVALID_PAGE_ID) {
+        frontier_ = issue_position;
+      }
+    }
+    if (issue_page_id != INVALID_PAGE_ID) {
+      Issue(issue_page_id, issue_position);
+    }
+  }
+
+ private:
+  bool InWindow(int64_t position) const { return position <= scan_position_ + static_cast<int64_t>(window_); }
+
+  /** Prefetch callback: the page at position is in memory, so the chain can follow its next link. */
+  void OnLoaded(int64_t position, Page *page) {
+    page_id_t next_page_id = static_cast<TablePage *>(page)->GetNextPageId();
+    {
+      std::lock_guard<std::mutex> guard(latch_);
+      // A chain that was restarted after this request went out is no longer followed.
+      if (position != frontier_ || next_page_id == INVALID_PAGE_ID) {
+        return;
+      }
+      if (!InWindow(position + 1)) {
+        pending_page_id_ = next_page_id;
+        pending_position_ = position + 1;
+        return;
+      }
+      frontier_ = position + 1;
+    }
+    Issue(next_page_id, position + 1);
+  }
+
+  void Issue(page_id_t page_id, int64_t position) {
+    auto self = shared_from_this();
+    bpm_->PrefetchPages({page_id}, [self, position](Page *page) { self->OnLoaded(position, page); });
+  }
+
+  BufferPoolManager *bpm_;
+  const size_t window_;
+  std::mutex latch_;
+  /** The page the scan is on, and its position. */
+  page_id_t scan_page_id_{INVALID_PAGE_ID};
+  int64_t scan_position_{-1};
+  /** Position of the last page the chain asked for. */
+  int64_t frontier_{-1};
+  /** The next link of the chain, waiting for the scan to make room in the window. */
+  page_id_t pending_page_id_{INVALID_PAGE_ID};
+  int64_t pending_position_{0};
+};
+
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, std::shared_ptr<BufferRing> ring,
+                             size_t read_ahead)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn), ring_(std::move(ring)) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
+    if (read_ahead > 0) {
+      BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
+      read_ahead_ = std::make_shared<ReadAhead>(buffer_pool_manager, read_ahead);
+      ReadPageGuard guard = buffer_pool_manager->FetchPageRead(rid.GetPageId(), ring_.get());
+      read_ahead_->OnScanPage(rid.GetPageId(), static_cast<TablePage *>(guard.GetPage())->GetNextPageId());
+    }
     table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
   }
 }
@@ -35,7 +130,8 @@ Tuple *TableIterator::operator->() {
 
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
+  auto cur_page =
+      static_cast<TablePage *>(buffer_pool_manager->FetchPageForScan(tuple_->rid_.GetPageId(), ring_.get()));
   cur_page->RLatch();
   assert(cur_page != nullptr);  // all pages are pinned
 
@@ -43,11 +139,15 @@ TableIterator &TableIterator::operator++() {
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  &next_tuple_rid)) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
+      auto next_page =
+          static_cast<TablePage *>(buffer_pool_manager->FetchPageForScan(cur_page->GetNextPageId(), ring_.get()));
       cur_page->RUnlatch();
       buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
       cur_page = next_page;
       cur_page->RLatch();
+      if (read_ahead_ != nullptr) {
+        read_ahead_->OnScanPage(cur_page->GetTablePageId(), cur_page->GetNextPageId());
+      }
       if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
         break;
       }
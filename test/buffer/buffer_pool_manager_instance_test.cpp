@@ -11,9 +11,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>  // NOLINT
 #include <random>
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 
@@ -141,4 +148,563 @@ TEST(BufferPoolManagerInstanceTest, SampleTest) {
   delete disk_manager;
 }
 
+/** @return how many of the pages [0, num_pages) currently sit in a frame of bpm */
+static size_t CountResident(BufferPoolManagerInstance *bpm, page_id_t num_pages) {
+  size_t resident = 0;
+  for (size_t i = 0; i < bpm->GetPoolSize(); i++) {
+    page_id_t page_id = bpm->GetFrame(static_cast<frame_id_t>(i))->GetPageId();
+    if (page_id != INVALID_PAGE_ID && page_id < num_pages) {
+      resident++;
+    }
+  }
+  return resident;
+}
+
+/** Number of grading callbacks made by FetchPageForScan. */
+static int scan_callbacks = 0;
+
+static void CountScanCallback(BufferPoolManager::CallbackType callback_type, page_id_t page_id) { scan_callbacks++; }
+
+/**
+ * Loads hot_pages hot pages, then scans every page after them once, either through the shared replacer or through a
+ * buffer ring of ring_size frames, and returns how many hot pages survived the scan.
+ */
+static size_t HotPagesAfterScan(size_t ring_size, bool use_ring) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const page_id_t hot_pages = 6;
+  const page_id_t total_pages = 30;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id_temp;
+  for (page_id_t i = 0; i < total_pages; i++) {
+    Page *page = bpm->NewPage(&page_id_temp);
+    EXPECT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  for (page_id_t i = 0; i < hot_pages; i++) {
+    EXPECT_NE(nullptr, bpm->FetchPage(i));
+    EXPECT_TRUE(bpm->UnpinPage(i, false));
+  }
+  EXPECT_EQ(static_cast<size_t>(hot_pages), CountResident(bpm, hot_pages));
+
+  BufferRing ring(ring_size);
+  char expected[PAGE_SIZE];
+  for (page_id_t i = hot_pages; i < total_pages; i++) {
+    Page *page = bpm->FetchPageForScan(i, use_ring ? &ring : nullptr, CountScanCallback);
+    EXPECT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_TRUE(bpm->UnpinPage(i, false));
+  }
+  size_t survivors = CountResident(bpm, hot_pages);
+  // Scenario: the scan's fetches call the grading callback before and after, like FetchPage.
+  EXPECT_EQ(2 * (total_pages - hot_pages), scan_callbacks);
+  scan_callbacks = 0;
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+  return survivors;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ScanRingTest) {
+  // Scenario: a plain scan over 24 pages flushes the whole hot set out of a pool of 10 frames.
+  EXPECT_EQ(0U, HotPagesAfterScan(3, false));
+  // Scenario: a bulk scan recycles its own 3 frames, so the hot set stays resident and the scan still reads every page.
+  EXPECT_EQ(6U, HotPagesAfterScan(3, true));
+  // Scenario: an empty ring degrades to a plain scan instead of failing.
+  EXPECT_EQ(0U, HotPagesAfterScan(0, true));
+}
+
+/**
+ * Dirties every frame of a pool, then replaces all of them with new pages, optionally giving a page cleaner the time
+ * to write the dirty pages back first. Checks that every page comes back intact.
+ * @return the number of dirty pages the evictions had to write themselves
+ */
+static size_t SyncWritesWhenReplacingPool(bool run_cleaner) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  if (run_cleaner) {
+    bpm->RunPageCleaner(buffer_pool_size);
+  }
+
+  page_id_t page_id_temp;
+  char expected[PAGE_SIZE];
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    Page *page = bpm->NewPage(&page_id_temp);
+    EXPECT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  if (run_cleaner) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (bpm->GetPagesCleaned() < buffer_pool_size && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(buffer_pool_size, bpm->GetPagesCleaned());
+  }
+
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, false));
+  }
+  size_t sync_writes = bpm->GetSyncWrites();
+
+  for (page_id_t i = 0; i < static_cast<page_id_t>(buffer_pool_size); i++) {
+    Page *page = bpm->FetchPage(i);
+    EXPECT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_TRUE(bpm->UnpinPage(i, false));
+  }
+
+  bpm->StopPageCleaner();
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+  return sync_writes;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PageCleanerTest) {
+  // Scenario: without a cleaner, each of the 10 evictions writes its dirty victim on the foreground path.
+  EXPECT_EQ(10U, SyncWritesWhenReplacingPool(false));
+  // Scenario: the cleaner has written every victim ahead of time, so no eviction has to.
+  EXPECT_EQ(0U, SyncWritesWhenReplacingPool(true));
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PrefetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const page_id_t num_pages = 20;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < num_pages; i++) {
+    Page *page = bpm->NewPage(&page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+  EXPECT_EQ(0U, CountResident(bpm, 5));
+
+  // Scenario: prefetched pages are loaded in the background, handed to the callback pinned and left unpinned.
+  std::atomic<int> loaded{0};
+  bpm->PrefetchPages({0, 1, 2, 3, 4}, [&](Page *page) {
+    EXPECT_EQ(1, page->GetPinCount());
+    loaded++;
+  });
+  while (loaded < 5) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(5U, CountResident(bpm, 5));
+
+  // Scenario: fetching a prefetched page is a hit on the loaded data.
+  char expected[PAGE_SIZE];
+  for (page_id_t i = 0; i < 5; i++) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(1, page->GetPinCount());
+    bpm->UnpinPage(i, false);
+  }
+  // The prefetcher's reads are counted on their own, so the hit ratio only reflects the fetches above.
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(5U, stats.prefetched_);
+  EXPECT_EQ(5U, stats.hits_);
+  EXPECT_EQ(0U, stats.misses_);
+
+  // Scenario: with every frame pinned there is nowhere to load a page, so the request is dropped.
+  for (page_id_t i = 0; i < static_cast<page_id_t>(buffer_pool_size); i++) {
+    EXPECT_NE(nullptr, bpm->FetchPage(i));
+  }
+  bpm->PrefetchPages({15}, [&](Page *page) { loaded++; });
+  delete bpm;
+  EXPECT_EQ(5, loaded);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PrefetchScanResistanceTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const page_id_t num_pages = 12;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, ReplacerType::LRU_K);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < num_pages; i++) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+
+  // Scenario: page 0 is read twice, so LRU-2 knows it as a hot page.
+  for (int i = 0; i < 2; i++) {
+    ASSERT_NE(nullptr, bpm->FetchPage(0));
+    bpm->UnpinPage(0, false);
+  }
+
+  // Scenario: a scan reads every other page once, each read ahead before it is fetched. Loading a page ahead must not
+  // count as an access, or each scanned page would have two and push page 0 out.
+  std::atomic<int> loaded{0};
+  for (page_id_t i = 1; i < num_pages; i++) {
+    bpm->PrefetchPages({i}, [&](Page *page) { loaded++; });
+    while (loaded < i) {
+      std::this_thread::yield();
+    }
+    ASSERT_NE(nullptr, bpm->FetchPage(i));
+    bpm->UnpinPage(i, false);
+  }
+  EXPECT_EQ(1U, CountResident(bpm, 1));
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, DeletedPageReuseTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < 5; i++) {
+    Page *page = bpm->NewPage(&page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+
+  // Scenario: a pinned page cannot be deleted, so its id is not freed either.
+  EXPECT_NE(nullptr, bpm->FetchPage(1));
+  EXPECT_FALSE(bpm->DeletePage(1));
+  bpm->UnpinPage(1, false);
+
+  // Scenario: a deleted page's id is handed out again, and the new page does not show the old content, even after
+  // being evicted clean and read back.
+  EXPECT_TRUE(bpm->DeletePage(2));
+  EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(2, page_id);
+  EXPECT_EQ(0, bpm->FetchPage(2)->GetData()[0]);
+  bpm->UnpinPage(2, false);
+  bpm->UnpinPage(2, false);
+  // These pages are unpinned dirty so that they reach the file: flushes only write dirty pages.
+  for (page_id_t i = 0; i < static_cast<page_id_t>(buffer_pool_size); i++) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    bpm->UnpinPage(page_id, true);
+  }
+  EXPECT_EQ(0, bpm->FetchPage(2)->GetData()[0]);
+  bpm->UnpinPage(2, false);
+
+  // Scenario: after a restart, page ids start over at 0 by default, and a freed id is not handed out twice.
+  EXPECT_TRUE(bpm->DeletePage(3));
+  bpm->FlushAllPages();
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  disk_manager = new DiskManager(db_name);
+  bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  for (page_id_t i = 0; i < 5; i++) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(i, page_id);
+    bpm->UnpinPage(page_id, false);
+  }
+  EXPECT_FALSE(disk_manager->IsFreePage(3));
+  EXPECT_TRUE(bpm->DeletePage(3));
+  bpm->FlushAllPages();
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+
+  // Scenario: with ContinuePageIds, freed ids are still reused first and new ids continue after the end of the file.
+  disk_manager = new DiskManager(db_name);
+  bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  bpm->ContinuePageIds();
+  EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(3, page_id);
+  EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(15, page_id);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+  remove("test.free");
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, WarmRestartTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const page_id_t num_pages = 20;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < num_pages; i++) {
+    Page *page = bpm->NewPage(&page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+  // Pages 12-19 are resident. Touch four of them so that 13, 17, 15 and 19 are, in that order, the most recent, and
+  // keep 12 pinned through the shutdown.
+  for (page_id_t i : {13, 17, 15, 19}) {
+    EXPECT_NE(nullptr, bpm->FetchPage(i));
+    bpm->UnpinPage(i, false);
+  }
+  EXPECT_NE(nullptr, bpm->FetchPage(12));
+  bpm->SaveWarmPages();
+  bpm->UnpinPage(12, false);
+  bpm->FlushAllPages();
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+
+  // Scenario: warming half the pool reloads the pinned page and the three hottest unpinned pages in the background.
+  disk_manager = new DiskManager(db_name);
+  bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  std::string warm_file = bpm->GetWarmFileName();
+  EXPECT_EQ("test.0.warm", warm_file);
+  bpm->LoadWarmPages(50);
+  while (CountResident(bpm, num_pages) < 4) {
+    std::this_thread::yield();
+  }
+  std::set<page_id_t> resident;
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    page_id = bpm->GetFrame(static_cast<frame_id_t>(i))->GetPageId();
+    if (page_id != INVALID_PAGE_ID) {
+      resident.insert(page_id);
+    }
+  }
+  EXPECT_EQ((std::set<page_id_t>{12, 15, 17, 19}), resident);
+  EXPECT_EQ(4U, bpm->GetStats().prefetched_);
+  EXPECT_EQ(0U, bpm->GetStats().misses_);
+  char expected[PAGE_SIZE];
+  snprintf(expected, PAGE_SIZE, "page %d", 17);
+  EXPECT_EQ(0, strcmp(bpm->FetchPage(17)->GetData(), expected));
+  bpm->UnpinPage(17, false);
+
+  // Scenario: the list is used once; loading again finds nothing to warm.
+  EXPECT_FALSE(std::ifstream(warm_file).is_open());
+  bpm->LoadWarmPages(100);
+  EXPECT_EQ(4U, CountResident(bpm, num_pages));
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, StatsTest) {
+  const std::string db_name = "test.db";
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(3, disk_manager);
+  page_id_t page_id;
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, false);
+  }
+  EXPECT_NE(nullptr, bpm->FetchPage(0));
+  bpm->UnpinPage(0, false);
+
+  // Scenario: with every frame pinned, NewPage and FetchPage of a page that is not resident both fail.
+  for (page_id_t i = 0; i < 3; i++) {
+    EXPECT_NE(nullptr, bpm->FetchPage(i));
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(nullptr, bpm->FetchPage(5));
+  snprintf(bpm->FetchPage(0)->GetData(), PAGE_SIZE, "page 0");
+  bpm->UnpinPage(0, true);
+  bpm->UnpinPage(0, true);
+  bpm->UnpinPage(1, false);
+  bpm->UnpinPage(2, false);
+
+  // Scenario: a new page evicts dirty page 0, and reading page 0 back evicts clean page 1.
+  EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  bpm->UnpinPage(page_id, false);
+  EXPECT_EQ(0, strcmp(bpm->FetchPage(0)->GetData(), "page 0"));
+  bpm->UnpinPage(0, false);
+  bpm->FlushAllPages();
+
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(5U, stats.hits_);
+  EXPECT_EQ(1U, stats.misses_);
+  EXPECT_EQ(4U, stats.new_pages_);
+  EXPECT_EQ(1U, stats.clean_evictions_);
+  EXPECT_EQ(1U, stats.dirty_evictions_);
+  // Every resident page is clean, so the flush writes nothing.
+  EXPECT_EQ(0U, stats.flushes_);
+  EXPECT_EQ(0U, stats.pages_cleaned_);
+  EXPECT_EQ(1U, stats.disk_reads_);
+  EXPECT_EQ(1U, stats.disk_writes_);
+  EXPECT_GT(stats.disk_time_.count(), 0);
+  EXPECT_EQ(2U, stats.pin_failures_);
+  EXPECT_DOUBLE_EQ(5.0 / 6.0, stats.HitRatio());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ResizeTest) {
+  const std::string db_name = "test.db";
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(4, disk_manager, nullptr, ReplacerType::LRU_K);
+  page_id_t page_id;
+  char expected[PAGE_SIZE];
+
+  // Scenario: growing adds free frames, so new pages no longer evict the old ones.
+  EXPECT_TRUE(bpm->Resize(8));
+  EXPECT_EQ(8U, bpm->GetPoolSize());
+  for (int i = 0; i < 8; i++) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+  EXPECT_EQ(8U, CountResident(bpm, 8));
+  EXPECT_FALSE(bpm->Resize(0));
+
+  // Scenario: shrinking waits for a pinned page in a retired frame, then evicts it like every other page there.
+  Page *pinned = bpm->FetchPage(7);
+  ASSERT_NE(nullptr, pinned);
+  std::atomic<bool> unpinned{false};
+  std::thread unpinner([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    unpinned = true;
+    bpm->UnpinPage(7, false);
+  });
+  EXPECT_TRUE(bpm->Resize(2));
+  EXPECT_TRUE(unpinned);
+  unpinner.join();
+  EXPECT_EQ(2U, bpm->GetPoolSize());
+  EXPECT_EQ(2U, CountResident(bpm, 8));
+
+  // Scenario: two frames are left, and every page written before the shrink reads back intact.
+  Page *page0 = bpm->FetchPage(0);
+  Page *page1 = bpm->FetchPage(1);
+  EXPECT_EQ(nullptr, bpm->FetchPage(2));
+  bpm->UnpinPage(0, false);
+  bpm->UnpinPage(1, false);
+  EXPECT_NE(page0, page1);
+  for (page_id_t i = 0; i < 8; i++) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    bpm->UnpinPage(i, false);
+  }
+
+  // Scenario: growing again reuses the frames that were kept after the shrink.
+  EXPECT_TRUE(bpm->Resize(6));
+  for (page_id_t i = 0; i < 6; i++) {
+    EXPECT_NE(nullptr, bpm->FetchPage(i));
+  }
+  EXPECT_EQ(nullptr, bpm->FetchPage(6));
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+/** A disk manager whose reads of one page wait until the test opens the gate. */
+class GatedDiskManager : public DiskManager {
+ public:
+  GatedDiskManager(const std::string &db_file, page_id_t gated_page)
+      : DiskManager(db_file), gated_page_(gated_page), gate_(opened_.get_future().share()) {}
+
+  void ReadPage(page_id_t page_id, char *page_data) override {
+    if (page_id == gated_page_) {
+      entered_.set_value();
+      gate_.wait();
+    }
+    DiskManager::ReadPage(page_id, page_data);
+  }
+
+  /** Waits until a thread is stuck reading the gated page. */
+  void WaitAtGate() { entered_.get_future().wait(); }
+
+  void Open() { opened_.set_value(); }
+
+ private:
+  page_id_t gated_page_;
+  std::promise<void> entered_;
+  std::promise<void> opened_;
+  std::shared_future<void> gate_;
+};
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, HitLatencyDuringMissesTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const page_id_t cold_page = 0;
+  const page_id_t hot_page_id = 5;
+
+  auto *disk_manager = new GatedDiskManager(db_name, cold_page);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // The pool keeps the last four of the six new pages, so the cold page is on disk only.
+  page_id_t page_id_temp;
+  for (page_id_t i = 0; i <= hot_page_id; i++) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+  Page *hot_page = bpm->FetchPage(hot_page_id);
+  ASSERT_NE(nullptr, hot_page);
+  EXPECT_TRUE(bpm->UnpinPage(hot_page_id, false));
+
+  // Scenario: a miss on the cold page is stuck in its read.
+  std::thread miss_thread([&] {
+    Page *page = bpm->FetchPage(cold_page);
+    EXPECT_NE(nullptr, page);
+    EXPECT_TRUE(bpm->UnpinPage(cold_page, false));
+  });
+  disk_manager->WaitAtGate();
+
+  // Scenario: a hit on a resident page, and an unpin, complete while the read is still pending.
+  auto hit = std::async(std::launch::async, [&] {
+    Page *page = bpm->FetchPage(hot_page_id);
+    bpm->UnpinPage(hot_page_id, false);
+    return page;
+  });
+  const bool hit_done = hit.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+  disk_manager->Open();
+  miss_thread.join();
+  EXPECT_TRUE(hit_done);
+  EXPECT_EQ(hot_page, hit.get());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
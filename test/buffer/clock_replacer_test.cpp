@@ -10,16 +10,19 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <thread>  // NOLINT
 #include <vector>
 
 #include "buffer/clock_replacer.h"
+#include "buffer/lru_replacer.h"
 #include "gtest/gtest.h"
 
 namespace bustub {
 
-TEST(ClockReplacerTest, DISABLED_SampleTest) {
+TEST(ClockReplacerTest, SampleTest) {
   ClockReplacer clock_replacer(7);
 
   // Scenario: unpin six elements, i.e. add them to the replacer.
@@ -59,4 +62,99 @@ TEST(ClockReplacerTest, DISABLED_SampleTest) {
   EXPECT_EQ(4, value);
 }
 
+TEST(ClockReplacerTest, EvictionCandidatesTest) {
+  ClockReplacer clock_replacer(7);
+  for (frame_id_t i = 1; i <= 6; i++) {
+    clock_replacer.Unpin(i);
+  }
+  int value;
+  clock_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  clock_replacer.Unpin(1);
+  clock_replacer.Pin(4);
+
+  // Scenario: the hand has cleared the reference bits of 2-6, so those come before 1, which was just unpinned.
+  std::vector<frame_id_t> candidates = clock_replacer.EvictionCandidates(4);
+  EXPECT_EQ((std::vector<frame_id_t>{2, 3, 5, 6}), candidates);
+  EXPECT_EQ((std::vector<frame_id_t>{2, 3, 5, 6, 1}), clock_replacer.EvictionCandidates(10));
+  EXPECT_EQ(5, clock_replacer.Size());
+
+  // Scenario: peeking does not move the hand, so the victims come out in the order that was predicted.
+  for (frame_id_t expected : candidates) {
+    clock_replacer.Victim(&value);
+    EXPECT_EQ(expected, value);
+  }
+}
+
+/**
+ * Hammers a replacer with the Pin/Unpin pairs every FetchPage/UnpinPage hit produces, while one extra thread keeps
+ * asking for victims and handing them back. Each worker owns a disjoint range of frames.
+ * @return the number of Pin/Unpin pairs per second
+ */
+static double MeasurePinUnpinThroughput(Replacer *replacer, size_t num_threads, size_t frames_per_thread,
+                                        size_t rounds) {
+  std::atomic<bool> done{false};
+  std::thread victim_thread([&] {
+    while (!done.load()) {
+      frame_id_t frame_id;
+      if (replacer->Victim(&frame_id)) {
+        replacer->Unpin(frame_id);
+      }
+    }
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([=] {
+      auto first_frame = static_cast<frame_id_t>(tid * frames_per_thread);
+      for (size_t round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < frames_per_thread; i++) {
+          replacer->Pin(first_frame + static_cast<frame_id_t>(i));
+          replacer->Unpin(first_frame + static_cast<frame_id_t>(i));
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  done = true;
+  victim_thread.join();
+  return static_cast<double>(num_threads * frames_per_thread * rounds) / elapsed.count();
+}
+
+// NOLINTNEXTLINE
+TEST(ClockReplacerTest, ConcurrentPinUnpinTest) {
+  const size_t num_threads = 4;
+  const size_t frames_per_thread = 16;
+  const size_t num_frames = num_threads * frames_per_thread;
+
+  // Scenario: pins and unpins race with a thread taking and handing back victims, and every frame ends up unpinned.
+  ClockReplacer clock_replacer(num_frames);
+  MeasurePinUnpinThroughput(&clock_replacer, num_threads, frames_per_thread, 100);
+  EXPECT_EQ(num_frames, clock_replacer.Size());
+}
+
+// A benchmark: run it explicitly with --gtest_also_run_disabled_tests.
+// NOLINTNEXTLINE
+TEST(ClockReplacerTest, DISABLED_ConcurrentThroughputTest) {
+  const size_t num_threads = 4;
+  const size_t frames_per_thread = 64;
+  const size_t rounds = 2000;
+  const size_t num_frames = num_threads * frames_per_thread;
+
+  LRUReplacer lru_replacer(num_frames);
+  ClockReplacer clock_replacer(num_frames);
+  double lru_ops = MeasurePinUnpinThroughput(&lru_replacer, num_threads, frames_per_thread, rounds);
+  double clock_ops = MeasurePinUnpinThroughput(&clock_replacer, num_threads, frames_per_thread, rounds);
+  printf("%zu threads: LRUReplacer %.0f pin/unpin per second, ClockReplacer %.0f pin/unpin per second\n", num_threads,
+         lru_ops, clock_ops);
+
+  // Every frame ends up unpinned, and every victim taken by the sweeping thread was handed back.
+  EXPECT_EQ(num_frames, lru_replacer.Size());
+  EXPECT_EQ(num_frames, clock_replacer.Size());
+}
+
 }  // namespace bustub
@@ -0,0 +1,126 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena_test.cpp
+//
+// Identification: test/buffer/frame_arena_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_arena.h"
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+static bool IsAligned(const void *pointer, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+}
+
+// NOLINTNEXTLINE
+TEST(FrameArenaTest, LayoutTest) {
+  // Scenario: frames are zeroed, page aligned and back to back.
+  FrameArena arena(4, false);
+  EXPECT_EQ(4U, arena.GetNumFrames());
+  EXPECT_FALSE(arena.IsHugePageAdvised());
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_TRUE(IsAligned(arena.GetFrameData(i), PAGE_SIZE));
+    EXPECT_EQ(arena.GetFrameData(0) + i * PAGE_SIZE, arena.GetFrameData(i));
+    for (int j = 0; j < PAGE_SIZE; j++) {
+      ASSERT_EQ(0, arena.GetFrameData(i)[j]);
+    }
+  }
+  arena.GetFrameData(3)[PAGE_SIZE - 1] = 'x';
+
+  // Scenario: an arena of several huge pages starts on a huge page boundary if the kernel takes the advice.
+  const size_t num_frames = 3 * FrameArena::HUGE_PAGE_SIZE / PAGE_SIZE + 1;
+  FrameArena huge_arena(num_frames, true);
+  if (huge_arena.IsHugePageAdvised()) {
+    EXPECT_TRUE(IsAligned(huge_arena.GetFrameData(0), FrameArena::HUGE_PAGE_SIZE));
+  }
+  huge_arena.GetFrameData(num_frames - 1)[PAGE_SIZE - 1] = 'x';
+}
+
+// NOLINTNEXTLINE
+TEST(FrameArenaTest, BufferPoolFramesTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
+
+  // Scenario: every frame's data is page aligned and every Page starts its own cache line, also after a resize.
+  EXPECT_TRUE(bpm->Resize(9));
+  for (frame_id_t i = 0; i < 9; i++) {
+    Page *page = bpm->GetFrame(i);
+    EXPECT_TRUE(IsAligned(page->GetData(), PAGE_SIZE));
+    EXPECT_TRUE(IsAligned(page, CACHE_LINE_SIZE));
+  }
+  page_id_t page_id;
+  Page *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, page->GetData()[0]);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+// A benchmark: run it explicitly with --gtest_also_run_disabled_tests.
+// NOLINTNEXTLINE
+TEST(FrameArenaTest, DISABLED_RandomFetchBenchmarkTest) {
+  const size_t pool_size = 16384;
+  const size_t num_threads = 4;
+  const size_t fetches_per_thread = 200000;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(pool_size, disk_manager);
+  page_id_t page_id;
+  for (size_t i = 0; i < pool_size; i++) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    page->GetData()[PAGE_SIZE - 1] = 1;
+    bpm->UnpinPage(page_id, true);
+  }
+
+  // Every page of the pool is resident; each thread fetches random pages and reads the last byte of each.
+  std::vector<std::thread> threads;
+  std::vector<size_t> bytes_read(num_threads, 0);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      std::mt19937 rng(t);
+      std::uniform_int_distribution<page_id_t> dist(0, static_cast<page_id_t>(pool_size) - 1);
+      for (size_t i = 0; i < fetches_per_thread; i++) {
+        page_id_t fetched = dist(rng);
+        Page *page = bpm->FetchPage(fetched);
+        bytes_read[t] += page->GetData()[PAGE_SIZE - 1];
+        bpm->UnpinPage(fetched, false);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("%zu threads, %zu frames: %.0f random fetches/s\n", num_threads, pool_size,
+         num_threads * fetches_per_thread / seconds);
+  for (size_t count : bytes_read) {
+    EXPECT_EQ(fetches_per_thread, count);
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+}  // namespace bustub
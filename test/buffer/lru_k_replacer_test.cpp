@@ -0,0 +1,221 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+
+  // Scenario: pin and unpin frames 1-6 once, then touch frame 1 a second time.
+  for (int i = 1; i <= 6; i++) {
+    lru_k_replacer.Pin(i);
+    lru_k_replacer.Unpin(i);
+  }
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Unpin(1);
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // Scenario: frames 2-6 have an infinite backward k-distance and go first, in LRU order. Frame 1 has two accesses.
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  EXPECT_EQ(3, lru_k_replacer.Size());
+
+  // Scenario: pinning removes a frame from the candidates; pinning an evicted frame starts a fresh history.
+  lru_k_replacer.Pin(5);
+  EXPECT_EQ(2, lru_k_replacer.Size());
+  lru_k_replacer.Pin(3);
+  lru_k_replacer.Unpin(3);
+  lru_k_replacer.Unpin(5);
+  EXPECT_EQ(4, lru_k_replacer.Size());
+
+  // Scenario: 6 and 3 still have a single access. 5 and 1 have two; 1's second-to-last access is the oldest.
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(0, lru_k_replacer.Size());
+
+  // Scenario: a removed frame forgets its history, so 0 comes back with a single access and goes before 2.
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Unpin(2);
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Unpin(2);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Unpin(0);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Remove(0);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Unpin(0);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(0, value);
+}
+
+TEST(LRUKReplacerTest, EvictionCandidatesTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+  for (frame_id_t i = 1; i <= 4; i++) {
+    lru_k_replacer.Pin(i);
+    lru_k_replacer.Unpin(i);
+  }
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Unpin(2);
+
+  // Scenario: frames with a single access come first, in LRU order; frame 2 has two accesses and comes last.
+  std::vector<frame_id_t> candidates = lru_k_replacer.EvictionCandidates(10);
+  EXPECT_EQ((std::vector<frame_id_t>{1, 3, 4, 2}), candidates);
+  EXPECT_EQ((std::vector<frame_id_t>{1, 3}), lru_k_replacer.EvictionCandidates(2));
+  EXPECT_EQ(4, lru_k_replacer.Size());
+
+  int value;
+  for (frame_id_t expected : candidates) {
+    lru_k_replacer.Victim(&value);
+    EXPECT_EQ(expected, value);
+  }
+  EXPECT_TRUE(lru_k_replacer.EvictionCandidates(10).empty());
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, ReadAheadTest) {
+  LRUKReplacer lru_k_replacer(3, 2);
+
+  // Frame 0 is accessed twice. Frames 1 and 2 are read ahead and then accessed once.
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Unpin(0);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Unpin(0);
+  for (frame_id_t frame_id : {1, 2}) {
+    lru_k_replacer.PinWithoutAccess(frame_id);
+    lru_k_replacer.Unpin(frame_id);
+    lru_k_replacer.Pin(frame_id);
+    lru_k_replacer.Unpin(frame_id);
+  }
+
+  // Scenario: the read-ahead does not count as an access, so frames 1 and 2 still have an infinite k-distance.
+  EXPECT_EQ((std::vector<frame_id_t>{1, 2, 0}), lru_k_replacer.EvictionCandidates(3));
+
+  // Scenario: pinning a resident frame without an access leaves its place in the eviction order alone.
+  lru_k_replacer.PinWithoutAccess(1);
+  lru_k_replacer.Unpin(1);
+  EXPECT_EQ((std::vector<frame_id_t>{1, 2, 0}), lru_k_replacer.EvictionCandidates(3));
+}
+
+/**
+ * Replays a page access trace against a replacer the way a buffer pool of num_frames frames would, and returns the
+ * number of hits.
+ */
+static size_t ReplayTrace(Replacer *replacer, size_t num_frames, const std::vector<page_id_t> &trace) {
+  std::unordered_map<page_id_t, frame_id_t> page_table;
+  std::vector<page_id_t> frame_to_page(num_frames, INVALID_PAGE_ID);
+  size_t next_free = 0;
+  size_t hits = 0;
+  for (page_id_t page_id : trace) {
+    frame_id_t frame_id;
+    auto iter = page_table.find(page_id);
+    if (iter != page_table.end()) {
+      hits++;
+      frame_id = iter->second;
+    } else {
+      if (next_free < num_frames) {
+        frame_id = static_cast<frame_id_t>(next_free++);
+      } else {
+        EXPECT_TRUE(replacer->Victim(&frame_id));
+        page_table.erase(frame_to_page[frame_id]);
+      }
+      page_table[page_id] = frame_id;
+      frame_to_page[frame_id] = page_id;
+    }
+    replacer->Pin(frame_id);
+    replacer->Unpin(frame_id);
+  }
+  return hits;
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  const size_t num_frames = 16;
+  const page_id_t hot_pages = 8;
+  const page_id_t scan_pages = 32;
+  const int rounds = 50;
+
+  // Every round touches each hot index page twice, then runs a full scan over pages nobody reads again.
+  std::vector<page_id_t> trace;
+  page_id_t next_scan_page = hot_pages;
+  for (int round = 0; round < rounds; round++) {
+    for (page_id_t page_id = 0; page_id < hot_pages; page_id++) {
+      trace.push_back(page_id);
+      trace.push_back(page_id);
+    }
+    for (page_id_t i = 0; i < scan_pages; i++) {
+      trace.push_back(next_scan_page++);
+    }
+  }
+
+  LRUReplacer lru_replacer(num_frames);
+  LRUKReplacer lru_k_replacer(num_frames, 2);
+  size_t lru_hits = ReplayTrace(&lru_replacer, num_frames, trace);
+  size_t lru_k_hits = ReplayTrace(&lru_k_replacer, num_frames, trace);
+  double lru_ratio = static_cast<double>(lru_hits) / trace.size();
+  double lru_k_ratio = static_cast<double>(lru_k_hits) / trace.size();
+
+  // The scan flushes the hot set out of LRU every round, so LRU only gets the second touch of each hot page.
+  EXPECT_EQ(static_cast<size_t>(rounds * hot_pages), lru_hits);
+  // LRU-2 keeps the hot set resident after the first round.
+  EXPECT_EQ(static_cast<size_t>((2 * rounds - 1) * hot_pages), lru_k_hits);
+  EXPECT_GT(lru_k_ratio, lru_ratio);
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, ResizeTest) {
+  LRUKReplacer lru_k_replacer(4, 2);
+
+  // Frames 0 and 1 are accessed twice, frame 2 once, so frame 2 goes first and then the older of 0 and 1.
+  for (frame_id_t frame_id : {0, 1, 0, 1, 2, 3}) {
+    lru_k_replacer.Pin(frame_id);
+  }
+  for (frame_id_t frame_id : {0, 1, 2, 3}) {
+    lru_k_replacer.Unpin(frame_id);
+  }
+
+  // Scenario: growing keeps every frame's history, so a new frame accessed once goes before frames 0 and 1. Had the
+  // history been lost, frames 0 and 1 would be down to one older access each and go first.
+  lru_k_replacer.Resize(6);
+  lru_k_replacer.Pin(5);
+  lru_k_replacer.Unpin(5);
+  EXPECT_EQ((std::vector<frame_id_t>{2, 3, 5, 0, 1}), lru_k_replacer.EvictionCandidates(6));
+
+  // Scenario: shrinking forgets the frames that go away and keeps the history of the others.
+  lru_k_replacer.Resize(3);
+  EXPECT_EQ((std::vector<frame_id_t>{2, 0, 1}), lru_k_replacer.EvictionCandidates(6));
+  frame_id_t frame_id;
+  ASSERT_TRUE(lru_k_replacer.Victim(&frame_id));
+  EXPECT_EQ(2, frame_id);
+  ASSERT_TRUE(lru_k_replacer.Victim(&frame_id));
+  EXPECT_EQ(0, frame_id);
+}
+
+}  // namespace bustub
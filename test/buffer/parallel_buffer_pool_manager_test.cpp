@@ -11,9 +11,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/parallel_buffer_pool_manager.h"
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <random>
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 
@@ -151,4 +155,308 @@ TEST(ParallelBufferPoolManagerTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, DeletedPageReuseTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 3;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, 5, disk_manager);
+  page_id_t page_id;
+  for (int i = 0; i < 9; i++) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, false);
+  }
+
+  // Scenario: a freed id goes back to the instance it belongs to, which hands it out before growing the file.
+  EXPECT_TRUE(bpm->DeletePage(4));
+  std::vector<page_id_t> new_page_ids;
+  for (size_t i = 0; i < num_instances; i++) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, false);
+    new_page_ids.push_back(page_id);
+  }
+  EXPECT_EQ((std::vector<page_id_t>{9, 4, 11}), new_page_ids);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+  remove("test.free");
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, StatsTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(2, 2, disk_manager);
+  page_id_t page_id;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, false);
+  }
+  for (int round = 0; round < 2; round++) {
+    for (page_id_t i = 0; i < 4; i++) {
+      EXPECT_NE(nullptr, bpm->FetchPage(i));
+      bpm->UnpinPage(i, false);
+    }
+  }
+
+  // Scenario: the snapshot is the sum of the instances, and each instance saw its own half of the pages.
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(4U, stats.new_pages_);
+  EXPECT_EQ(8U, stats.hits_);
+  EXPECT_EQ(0U, stats.misses_);
+  for (size_t i = 0; i < 2; i++) {
+    BufferPoolStats instance_stats = bpm->GetInstanceStats(i);
+    EXPECT_EQ(2U, instance_stats.new_pages_);
+    EXPECT_EQ(4U, instance_stats.hits_);
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, FlushAllPagesTest) {
+  const size_t num_instances = 4;
+  const page_id_t num_pages = 64;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(num_instances, 16, disk_manager);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < num_pages; i++) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+
+  // Scenario: every dirty page goes out once, with a single sync for the whole pool.
+  const int syncs = disk_manager->GetNumSyncs();
+  bpm->FlushAllPages();
+  EXPECT_EQ(num_pages, disk_manager->GetNumWrites());
+  EXPECT_EQ(syncs + 1, disk_manager->GetNumSyncs());
+  char data[PAGE_SIZE];
+  char expected[PAGE_SIZE];
+  for (page_id_t i = 0; i < num_pages; i++) {
+    disk_manager->ReadPage(i, data);
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_STREQ(expected, data);
+  }
+
+  // Scenario: a second flush only writes the pages dirtied since the first.
+  for (page_id_t i : {7, 8, 40}) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "new page %d", i);
+    bpm->UnpinPage(i, true);
+  }
+  bpm->FlushAllPages();
+  EXPECT_EQ(num_pages + 3, disk_manager->GetNumWrites());
+  disk_manager->ReadPage(8, data);
+  EXPECT_STREQ("new page 8", data);
+  EXPECT_EQ(num_pages + 3, static_cast<page_id_t>(bpm->GetStats().flushes_));
+
+  // Scenario: a page a writer holds latched is not written halfway through its change. It stays dirty and goes out
+  // with the next flush once the writer is done.
+  Page *page = bpm->FetchPage(9);
+  ASSERT_NE(nullptr, page);
+  bpm->UnpinPage(9, true);
+  page = bpm->FetchPage(9);
+  ASSERT_NE(nullptr, page);
+  page->WLatch();
+  snprintf(page->GetData(), PAGE_SIZE, "torn");
+  bpm->FlushAllPages();
+  EXPECT_EQ(num_pages + 3, disk_manager->GetNumWrites());
+  disk_manager->ReadPage(9, data);
+  EXPECT_STREQ("page 9", data);
+  snprintf(page->GetData(), PAGE_SIZE, "new page 9");
+  page->WUnlatch();
+  bpm->UnpinPage(9, true);
+  bpm->FlushAllPages();
+  EXPECT_EQ(num_pages + 4, disk_manager->GetNumWrites());
+  disk_manager->ReadPage(9, data);
+  EXPECT_STREQ("new page 9", data);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+// A benchmark: run it explicitly with --gtest_also_run_disabled_tests.
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, DISABLED_FlushAllPagesBenchmarkTest) {
+  const size_t num_instances = 4;
+  const size_t pool_size = 1024;
+  const int rounds = 5;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(num_instances, pool_size, disk_manager);
+  const auto num_pages = static_cast<page_id_t>(num_instances * pool_size);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < num_pages; i++) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    bpm->UnpinPage(page_id, true);
+  }
+
+  // Every round dirties the whole pool and times the flush, as a checkpoint of a busy pool would see it.
+  std::chrono::duration<double> elapsed{0};
+  for (int round = 0; round < rounds; round++) {
+    for (page_id_t i = 0; i < num_pages; i++) {
+      Page *page = bpm->FetchPage(i);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d round %d", i, round);
+      bpm->UnpinPage(i, true);
+    }
+    auto start = std::chrono::steady_clock::now();
+    bpm->FlushAllPages();
+    elapsed += std::chrono::steady_clock::now() - start;
+  }
+  printf("FlushAllPages of %d dirty pages: %.2f ms\n", num_pages, elapsed.count() * 1000 / rounds);
+
+  char data[PAGE_SIZE];
+  char expected[PAGE_SIZE];
+  for (page_id_t i = 0; i < num_pages; i += 97) {
+    disk_manager->ReadPage(i, data);
+    snprintf(expected, PAGE_SIZE, "page %d round %d", i, rounds - 1);
+    EXPECT_STREQ(expected, data);
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, ConcurrentNewPageTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 4;
+  const size_t num_threads = 8;
+  const size_t pages_per_thread = 500;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, 2, disk_manager);
+
+  // Scenario: with every frame pinned no instance is tried; once a page is unpinned, its instance is found again.
+  page_id_t page_ids[8];
+  for (auto &page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  bpm->UnpinPage(page_ids[6], false);
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(page_ids[6] % num_instances, page_id % num_instances);
+  bpm->UnpinPage(page_id, false);
+  for (auto id : page_ids) {
+    bpm->UnpinPage(id, false);
+  }
+
+  // Scenario: concurrent allocations never hand out the same page id twice.
+  std::vector<std::vector<page_id_t>> allocated(num_threads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      page_id_t new_page_id;
+      while (allocated[t].size() < pages_per_thread) {
+        if (bpm->NewPage(&new_page_id) != nullptr) {
+          allocated[t].push_back(new_page_id);
+          bpm->UnpinPage(new_page_id, false);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::set<page_id_t> unique;
+  for (const auto &ids : allocated) {
+    unique.insert(ids.begin(), ids.end());
+  }
+  EXPECT_EQ(num_threads * pages_per_thread, unique.size());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, ResizeDuringFetchesTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 4;
+  const page_id_t num_pages = 64;
+  const size_t num_threads = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, 8, disk_manager);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < num_pages; i++) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+
+  // Scenario: readers keep fetching, checking and dirtying pages while the pool is grown and shrunk under them.
+  std::atomic<bool> done{false};
+  std::atomic<size_t> fetches{0};
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      std::mt19937 gen(t);
+      std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+      char expected[PAGE_SIZE];
+      while (!done) {
+        page_id_t fetch_id = dist(gen);
+        Page *page = bpm->FetchPage(fetch_id);
+        if (page == nullptr) {
+          // All frames of the instance are pinned by the other readers.
+          continue;
+        }
+        EXPECT_EQ(fetch_id, page->GetPageId());
+        snprintf(expected, PAGE_SIZE, "page %d", fetch_id);
+        page->WLatch();
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        snprintf(page->GetData(), PAGE_SIZE, "page %d", fetch_id);
+        page->WUnlatch();
+        bpm->UnpinPage(fetch_id, true);
+        fetches++;
+      }
+    });
+  }
+  for (int round = 0; round < 5; round++) {
+    for (size_t pool_size : {2, 16, 4, 32, 8}) {
+      EXPECT_TRUE(bpm->Resize(pool_size));
+      EXPECT_EQ(num_instances * pool_size, bpm->GetPoolSize());
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  }
+  done = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_GT(fetches, 0U);
+
+  // Scenario: after the last shrink every page is still in the instance that owns it, with its content.
+  EXPECT_TRUE(bpm->Resize(2));
+  char expected[PAGE_SIZE];
+  for (page_id_t i = 0; i < num_pages; i++) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    bpm->UnpinPage(i, false);
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
 }  // namespace bustub
@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -117,4 +118,48 @@ TEST(HashTableTest,SampleTest) {
   delete bpm;
 }
 
+// NOLINTNEXTLINE
+TEST(HashTableTest, ConcurrentLookupTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(ht.Insert(nullptr, i, i));
+  }
+
+  // Scenario: lookups that run while a writer keeps changing the same bucket only ever see what is stored for their
+  // key, whether they validated an optimistic read or fell back to the read latch.
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int round = 0; round < 10000; round++) {
+      int key = 10 + round % 10;
+      EXPECT_TRUE(ht.Insert(nullptr, key, round));
+      EXPECT_TRUE(ht.Remove(nullptr, key, round));
+    }
+    done = true;
+  });
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 2; t++) {
+    readers.emplace_back([&] {
+      while (!done) {
+        for (int i = 0; i < 10; i++) {
+          std::vector<int> res;
+          ASSERT_TRUE(ht.GetValue(nullptr, i, &res));
+          ASSERT_EQ(std::vector<int>{i}, res);
+        }
+      }
+    });
+  }
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
 }  // namespace bustub
@@ -0,0 +1,243 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager_test.cpp
+//
+// Identification: test/storage/async_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <future>  // NOLINT
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/disk/async_disk_manager.h"
+
+namespace bustub {
+
+class AsyncDiskManagerTest : public ::testing::TestWithParam<AsyncIoBackend> {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.free");
+  }
+
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.free");
+  }
+};
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, ReadWritePageTest) {
+  AsyncDiskManager dm("test.db", GetParam());
+  if (GetParam() == AsyncIoBackend::THREAD_POOL) {
+    EXPECT_EQ(AsyncIoBackend::THREAD_POOL, dm.GetBackend());
+  }
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE];
+  std::strncpy(data, "A test string.", sizeof(data));
+
+  // Scenario: reading past the end of the file gives a page of zeroes.
+  memset(buf, 'x', PAGE_SIZE);
+  EXPECT_TRUE(dm.ReadPageAsync(3, buf).get());
+  for (char byte : buf) {
+    ASSERT_EQ(0, byte);
+  }
+
+  // Scenario: the blocking and future versions see each other's writes.
+  dm.WritePage(0, data);
+  EXPECT_TRUE(dm.ReadPageAsync(0, buf).get());
+  EXPECT_EQ(0, memcmp(buf, data, PAGE_SIZE));
+  data[0] = 'B';
+  EXPECT_TRUE(dm.WritePageAsync(5, data).get());
+  dm.ReadPage(5, buf);
+  EXPECT_EQ(0, memcmp(buf, data, PAGE_SIZE));
+  EXPECT_EQ(6, dm.GetNumPages());
+  EXPECT_EQ(2, dm.GetNumWrites());
+
+  // Scenario: a page the file holds only part of reads as that part followed by zeroes, after the read went on past
+  // the short transfer.
+  ASSERT_EQ(0, truncate("test.db", PAGE_SIZE * 5 + 100));
+  memset(buf, 'x', PAGE_SIZE);
+  EXPECT_TRUE(dm.ReadPageAsync(5, buf).get());
+  EXPECT_EQ(0, memcmp(buf, data, 100));
+  for (int i = 100; i < PAGE_SIZE; i++) {
+    ASSERT_EQ(0, buf[i]);
+  }
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, BatchTest) {
+  const int num_pages = 200;
+  // A queue shallower than the batch makes Submit wait for room in the middle of it.
+  AsyncDiskManager dm("test.db", GetParam(), 8);
+  std::vector<std::unique_ptr<char[]>> pages;
+  for (int i = 0; i < num_pages; i++) {
+    pages.emplace_back(new char[PAGE_SIZE]);
+    snprintf(pages.back().get(), PAGE_SIZE, "page %d", i);
+  }
+
+  // Scenario: a batch of writes completes every callback exactly once.
+  std::atomic<int> written{0};
+  std::vector<DiskRequest> writes;
+  for (int i = 0; i < num_pages; i++) {
+    writes.push_back({true, i, pages[i].get(), [&](bool ok) {
+                        EXPECT_TRUE(ok);
+                        written++;
+                      }});
+  }
+  dm.Submit(std::move(writes));
+  while (written < num_pages) {
+    std::this_thread::yield();
+  }
+
+  // Scenario: a batch of reads in reverse order brings every page back.
+  for (auto &page : pages) {
+    memset(page.get(), 0, PAGE_SIZE);
+  }
+  std::promise<void> all_read;
+  std::atomic<int> read{0};
+  std::vector<DiskRequest> reads;
+  for (int i = num_pages - 1; i >= 0; i--) {
+    reads.push_back({false, i, pages[i].get(), [&](bool ok) {
+                       EXPECT_TRUE(ok);
+                       if (++read == num_pages) {
+                         all_read.set_value();
+                       }
+                     }});
+  }
+  dm.Submit(std::move(reads));
+  all_read.get_future().wait();
+  char expected[PAGE_SIZE];
+  for (int i = 0; i < num_pages; i++) {
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(pages[i].get(), expected));
+  }
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, BufferPoolTest) {
+  const int num_threads = 4;
+  const int pages_per_thread = 50;
+  auto *dm = new AsyncDiskManager("test.db", GetParam());
+  auto *bpm = new BufferPoolManagerInstance(8, dm);
+
+  // Scenario: threads missing at the same time all go to the disk manager at once, and every page survives.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&] {
+      std::vector<page_id_t> page_ids;
+      page_id_t page_id;
+      for (int i = 0; i < pages_per_thread; i++) {
+        Page *page = bpm->NewPage(&page_id);
+        while (page == nullptr) {
+          std::this_thread::yield();
+          page = bpm->NewPage(&page_id);
+        }
+        snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+        bpm->UnpinPage(page_id, true);
+        page_ids.push_back(page_id);
+      }
+      char expected[PAGE_SIZE];
+      for (page_id_t id : page_ids) {
+        Page *page = bpm->FetchPage(id);
+        while (page == nullptr) {
+          std::this_thread::yield();
+          page = bpm->FetchPage(id);
+        }
+        snprintf(expected, PAGE_SIZE, "page %d", id);
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        bpm->UnpinPage(id, false);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  delete bpm;
+  dm->ShutDown();
+  delete dm;
+}
+
+/** Remembers the largest batch of reads handed to Submit. */
+class BatchRecordingDiskManager : public AsyncDiskManager {
+ public:
+  using AsyncDiskManager::AsyncDiskManager;
+
+  void Submit(std::vector<DiskRequest> requests) override {
+    if (std::none_of(requests.begin(), requests.end(), [](const DiskRequest &request) { return request.is_write_; })) {
+      largest_read_batch_ = std::max(largest_read_batch_.load(), requests.size());
+    }
+    AsyncDiskManager::Submit(std::move(requests));
+  }
+
+  std::atomic<size_t> largest_read_batch_{0};
+};
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, PrefetchTest) {
+  const size_t pool_size = 32;
+  const page_id_t num_pages = 48;
+  const page_id_t num_prefetched = 16;
+  auto *dm = new BatchRecordingDiskManager("test.db", GetParam());
+  auto *bpm = new BufferPoolManagerInstance(pool_size, dm);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < num_pages; i++) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+  dm->largest_read_batch_ = 0;
+
+  // Scenario: the prefetch thread hands the reads of a whole batch to the disk manager at once, so that one thread
+  // has all of those misses in flight, and every page arrives intact.
+  std::vector<page_id_t> page_ids;
+  for (page_id_t i = 0; i < num_prefetched; i++) {
+    page_ids.push_back(i);
+  }
+  std::atomic<int> loaded{0};
+  bpm->PrefetchPages(page_ids, [&](Page *page) {
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", page->GetPageId());
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    loaded++;
+  });
+  while (loaded < num_prefetched) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(static_cast<size_t>(num_prefetched), dm->largest_read_batch_.load());
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(static_cast<size_t>(num_prefetched), stats.prefetched_);
+
+  delete bpm;
+  dm->ShutDown();
+  delete dm;
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, AsyncDiskManagerTest,
+                         ::testing::Values(AsyncIoBackend::IO_URING, AsyncIoBackend::THREAD_POOL));
+
+}  // namespace bustub
@@ -12,7 +12,10 @@
 
 #include <chrono>  // NOLINT
 #include <cstdio>
+#include <algorithm>
+#include <atomic>
 #include <functional>
+#include <random>
 #include <thread>  // NOLINT
 
 #include "buffer/buffer_pool_manager_instance.h"
@@ -100,7 +103,7 @@ void DeleteHelperSplit(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree
   delete transaction;
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest1) {
+TEST(BPlusTreeConcurrentTest, InsertTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -152,7 +155,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest2) {
+TEST(BPlusTreeConcurrentTest, InsertTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -203,7 +206,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest1) {
+TEST(BPlusTreeConcurrentTest, DeleteTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -245,7 +248,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest2) {
+TEST(BPlusTreeConcurrentTest, DeleteTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -288,7 +291,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
+TEST(BPlusTreeConcurrentTest, MixTest) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -333,4 +336,166 @@ TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
   remove("test.log");
 }
 
+// helper function to look up keys until stop is set; every key in must_find has to be found with its own value
+void LookupHelper(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree, const std::vector<int64_t> &keys,
+                  const std::vector<int64_t> &must_find, const std::atomic<bool> *stop, uint64_t thread_itr) {
+  GenericKey<8> index_key;
+  std::vector<RID> rids;
+  std::mt19937 rng(thread_itr);
+  while (!stop->load()) {
+    for (int i = 0; i < 100; i++) {
+      bool required = !must_find.empty() && rng() % 2 == 0;
+      int64_t key = required ? must_find[rng() % must_find.size()] : keys[rng() % keys.size()];
+      rids.clear();
+      index_key.SetFromInteger(key);
+      bool found = tree->GetValue(index_key, &rids);
+      if (required) {
+        ASSERT_TRUE(found) << key;
+      }
+      if (found) {
+        ASSERT_EQ(1, rids.size());
+        ASSERT_EQ(key, rids[0].GetSlotNum());
+      }
+    }
+  }
+}
+
+// helper function to race splits, merges and lookups on a deep tree
+void StressHelper(bool optimistic) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  // Tiny pages, so that the tree is deep and splits and merges race all the time.
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 3);
+  tree.SetOptimistic(optimistic);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+
+  const int num_threads = 4;
+  std::vector<int64_t> keys;
+  std::vector<int64_t> even_keys;
+  std::vector<int64_t> odd_keys;
+  for (int64_t key = 0; key < 4000; key++) {
+    keys.push_back(key);
+    (key % 2 == 0 ? even_keys : odd_keys).push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  std::shuffle(odd_keys.begin(), odd_keys.end(), std::mt19937(1));
+
+  auto check_scan = [&](int64_t first, int64_t step, int64_t count) {
+    int64_t current_key = first;
+    int64_t size = 0;
+    for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+      ASSERT_EQ(current_key, (*iterator).first.ToString());
+      current_key += step;
+      size++;
+    }
+    EXPECT_EQ(count, size);
+  };
+
+  // Scenario: splits race with each other and with readers.
+  {
+    std::atomic<bool> stop{false};
+    std::thread reader1(LookupHelper, &tree, keys, std::vector<int64_t>{}, &stop, 1);
+    std::thread reader2(LookupHelper, &tree, keys, std::vector<int64_t>{}, &stop, 2);
+    LaunchParallelTest(num_threads, InsertHelperSplit, &tree, keys, num_threads);
+    stop = true;
+    reader1.join();
+    reader2.join();
+  }
+  check_scan(0, 1, 4000);
+
+  // Scenario: merges and redistributions race with each other, and readers never miss a key that stays.
+  {
+    std::atomic<bool> stop{false};
+    std::thread reader1(LookupHelper, &tree, keys, even_keys, &stop, 1);
+    std::thread reader2(LookupHelper, &tree, keys, even_keys, &stop, 2);
+    LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, odd_keys, num_threads);
+    stop = true;
+    reader1.join();
+    reader2.join();
+  }
+  check_scan(0, 2, 2000);
+
+  // Scenario: removing every key shrinks the tree away, and it can grow again.
+  LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, even_keys, num_threads);
+  EXPECT_TRUE(tree.IsEmpty());
+  EXPECT_TRUE(tree.Begin() == tree.End());
+  InsertHelper(&tree, {7});
+  check_scan(7, 1, 1);
+
+  // Scenario: no operation left a page pinned, so every frame but the header page's can take a new page.
+  std::vector<page_id_t> new_page_ids(255);
+  for (page_id_t &new_page_id : new_page_ids) {
+    ASSERT_NE(nullptr, bpm->NewPage(&new_page_id));
+  }
+  for (page_id_t new_page_id : new_page_ids) {
+    bpm->UnpinPage(new_page_id, false);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, StressTest) { StressHelper(false); }
+
+TEST(BPlusTreeConcurrentTest, OptimisticStressTest) { StressHelper(true); }
+
+// A benchmark: run it explicitly with --gtest_also_run_disabled_tests.
+TEST(BPlusTreeConcurrentTest, DISABLED_ScalingBenchmarkTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  const int64_t num_keys = 20000;
+  const int64_t num_lookups = 40000;
+
+  for (bool optimistic : {false, true}) {
+    for (uint64_t num_threads : {1, 2, 4, 8}) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      BufferPoolManager *bpm = new BufferPoolManagerInstance(1024, disk_manager);
+      BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+      tree.SetOptimistic(optimistic);
+      page_id_t page_id;
+      bpm->NewPage(&page_id);
+
+      std::vector<int64_t> keys;
+      for (int64_t key = 0; key < num_keys; key++) {
+        keys.push_back(key);
+      }
+      std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+      auto start = std::chrono::steady_clock::now();
+      LaunchParallelTest(num_threads, InsertHelperSplit, &tree, keys, num_threads);
+      auto insert_time = std::chrono::steady_clock::now() - start;
+
+      start = std::chrono::steady_clock::now();
+      LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+        GenericKey<8> index_key;
+        std::vector<RID> rids;
+        std::mt19937 rng(thread_itr);
+        for (int64_t i = 0; i < num_lookups / static_cast<int64_t>(num_threads); i++) {
+          rids.clear();
+          index_key.SetFromInteger(rng() % num_keys);
+          EXPECT_TRUE(tree.GetValue(index_key, &rids));
+        }
+      });
+      auto lookup_time = std::chrono::steady_clock::now() - start;
+
+      printf("B+ tree, %-10s on %lu threads: %9.0f inserts/s, %9.0f lookups/s\n",
+             optimistic ? "optimistic" : "crabbing", num_threads,
+             num_keys / std::chrono::duration<double>(insert_time).count(),
+             num_lookups / std::chrono::duration<double>(lookup_time).count());
+
+      bpm->UnpinPage(HEADER_PAGE_ID, true);
+      delete bpm;
+      delete disk_manager;
+      remove("test.db");
+      remove("test.log");
+    }
+  }
+}
+
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "gtest/gtest.h"
@@ -20,7 +21,7 @@
 
 namespace bustub {
 
-TEST(BPlusTreeTests, DISABLED_InsertTest1) {
+TEST(BPlusTreeTests, InsertTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -78,7 +79,7 @@ TEST(BPlusTreeTests, DISABLED_InsertTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeTests, DISABLED_InsertTest2) {
+TEST(BPlusTreeTests, InsertTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -145,4 +146,68 @@ TEST(BPlusTreeTests, DISABLED_InsertTest2) {
   remove("test.db");
   remove("test.log");
 }
+// Scenario: every other frame is pinned while an iterator walks the leaf chain. Moving past the first leaf cannot
+// fetch the next one, which must throw instead of silently ending the scan.
+TEST(BPlusTreeTests, IteratorOutOfMemoryTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  const size_t pool_size = 10;
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(pool_size, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 3);
+  GenericKey<8> index_key;
+  RID rid;
+  Transaction *transaction = new Transaction(0);
+
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  for (int64_t key = 1; key <= 20; key++) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid, transaction);
+  }
+
+  {
+    index_key.SetFromInteger(1);
+    auto iterator = tree.Begin(index_key);
+    ASSERT_FALSE(iterator.IsEnd());
+
+    std::vector<page_id_t> pinned;
+    while (bpm->NewPage(&page_id) != nullptr) {
+      pinned.push_back(page_id);
+    }
+    ASSERT_FALSE(pinned.empty());
+
+    EXPECT_THROW(
+        {
+          while (!iterator.IsEnd()) {
+            ++iterator;
+          }
+        },
+        Exception);
+    EXPECT_TRUE(iterator.IsEnd());
+
+    for (auto pinned_page_id : pinned) {
+      EXPECT_TRUE(bpm->UnpinPage(pinned_page_id, false));
+    }
+  }
+
+  // The leaf the iterator held was released, so a full scan can run again.
+  int64_t count = 0;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    count++;
+  }
+  EXPECT_EQ(count, 20);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
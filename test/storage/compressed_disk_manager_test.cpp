@@ -0,0 +1,266 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_disk_manager_test.cpp
+//
+// Identification: test/storage/compressed_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "catalog/schema.h"
+#include "gtest/gtest.h"
+#include "storage/disk/compressed_disk_manager.h"
+#include "storage/disk/page_codec.h"
+#include "storage/page/table_page.h"
+#include "storage/table/tuple.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+class CompressedDiskManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { TearDown(); }
+
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.free");
+    remove("test.map");
+  }
+};
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, CodecTest) {
+  char page[PAGE_SIZE];
+  char compressed[PAGE_SIZE + PAGE_SIZE / 255 + 16];
+  char output[PAGE_SIZE];
+  std::mt19937 rng(0);
+
+  // Scenario: a page of zeroes shrinks to a few bytes, and a page of random bytes does not fit in less than a page.
+  memset(page, 0, PAGE_SIZE);
+  size_t length = PageCodec::Compress(page, PAGE_SIZE, compressed, sizeof(compressed));
+  // A long match spends a length byte per 255 bytes it covers.
+  EXPECT_LT(length, PAGE_SIZE / 255 + 32);
+  ASSERT_TRUE(PageCodec::Decompress(compressed, length, output, PAGE_SIZE));
+  EXPECT_EQ(0, memcmp(page, output, PAGE_SIZE));
+  for (char &byte : page) {
+    byte = static_cast<char>(rng());
+  }
+  EXPECT_EQ(0U, PageCodec::Compress(page, PAGE_SIZE, compressed, PAGE_SIZE - 1));
+  length = PageCodec::Compress(page, PAGE_SIZE, compressed, sizeof(compressed));
+  ASSERT_NE(0U, length);
+  ASSERT_TRUE(PageCodec::Decompress(compressed, length, output, PAGE_SIZE));
+  EXPECT_EQ(0, memcmp(page, output, PAGE_SIZE));
+
+  // Scenario: pages mixing runs, repeated text and noise survive the round trip.
+  for (int round = 0; round < 50; round++) {
+    memset(page, 0, PAGE_SIZE);
+    for (int i = 0; i < 40; i++) {
+      char *at = page + rng() % (PAGE_SIZE - 64);
+      if (i % 2 == 0) {
+        std::string text = "tuple " + std::to_string(i) + " of round " + std::to_string(round);
+        memcpy(at, text.c_str(), text.size());
+      } else {
+        for (size_t j = 0; j < rng() % 64; j++) {
+          at[j] = static_cast<char>(rng());
+        }
+      }
+    }
+    length = PageCodec::Compress(page, PAGE_SIZE, compressed, sizeof(compressed));
+    ASSERT_NE(0U, length);
+    ASSERT_TRUE(PageCodec::Decompress(compressed, length, output, PAGE_SIZE));
+    ASSERT_EQ(0, memcmp(page, output, PAGE_SIZE));
+
+    // Scenario: corrupt or truncated input is rejected rather than read or written out of bounds.
+    compressed[rng() % length] ^= static_cast<char>(1 + rng() % 255);
+    PageCodec::Decompress(compressed, length, output, PAGE_SIZE);
+    EXPECT_FALSE(PageCodec::Decompress(compressed, length / 2, output, PAGE_SIZE));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, ReadWritePageTest) {
+  auto dm = new CompressedDiskManager("test.db");
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE];
+  std::mt19937 rng(0);
+
+  // Scenario: pages of different compressibility land in slots of different sizes.
+  snprintf(data, PAGE_SIZE, "sparse page");
+  dm->WritePage(0, data);
+  char noise[PAGE_SIZE];
+  for (char &byte : noise) {
+    byte = static_cast<char>(rng());
+  }
+  dm->WritePage(1, noise);
+  dm->ReadPage(2, buf);
+  EXPECT_EQ(0, buf[0]);
+  dm->ReadPage(0, buf);
+  EXPECT_STREQ("sparse page", buf);
+  dm->ReadPage(1, buf);
+  EXPECT_EQ(0, memcmp(noise, buf, PAGE_SIZE));
+  // The sparse page takes the smallest slot at 0; the full page is aligned to PAGE_SIZE, which leaves a gap for
+  // smaller slots in between.
+  EXPECT_EQ(static_cast<uint64_t>(2 * PAGE_SIZE), dm->GetFileEnd());
+  EXPECT_LT(dm->GetBytesWritten(), static_cast<uint64_t>(PAGE_SIZE + PAGE_SIZE / 255 + 64));
+
+  // Scenario: a page that no longer compresses moves to a full slot, and a page that becomes sparse moves to a small
+  // slot in the gap.
+  dm->WritePage(0, noise);
+  dm->WritePage(1, data);
+  EXPECT_EQ(static_cast<uint64_t>(3 * PAGE_SIZE), dm->GetFileEnd());
+  dm->ReadPage(0, buf);
+  EXPECT_EQ(0, memcmp(noise, buf, PAGE_SIZE));
+  dm->ReadPage(1, buf);
+  EXPECT_STREQ("sparse page", buf);
+  EXPECT_EQ(2, dm->GetNumPages());
+
+  // Scenario: the full slot page 1 moved out of is not reused before Sync, since the map on disk may still point to
+  // it; after Sync it is.
+  dm->WritePage(2, noise);
+  EXPECT_EQ(static_cast<uint64_t>(4 * PAGE_SIZE), dm->GetFileEnd());
+  EXPECT_TRUE(dm->Sync());
+  dm->WritePage(3, noise);
+  EXPECT_EQ(static_cast<uint64_t>(4 * PAGE_SIZE), dm->GetFileEnd());
+  dm->ReadPage(3, buf);
+  EXPECT_EQ(0, memcmp(noise, buf, PAGE_SIZE));
+  dm->ReadPage(1, buf);
+  EXPECT_STREQ("sparse page", buf);
+  dm->ShutDown();
+  delete dm;
+
+  // Scenario: reopening the database brings back the map, and the free space in the file is reused.
+  dm = new CompressedDiskManager("test.db");
+  EXPECT_EQ(4, dm->GetNumPages());
+  dm->ReadPage(0, buf);
+  EXPECT_EQ(0, memcmp(noise, buf, PAGE_SIZE));
+  dm->ReadPage(1, buf);
+  EXPECT_STREQ("sparse page", buf);
+  dm->WritePage(5, data);
+  EXPECT_EQ(static_cast<uint64_t>(4 * PAGE_SIZE), dm->GetFileEnd());
+  dm->ReadPage(5, buf);
+  EXPECT_STREQ("sparse page", buf);
+  EXPECT_EQ(6, dm->GetNumPages());
+  EXPECT_EQ(0U, dm->GetNumFailedReads());
+
+  // Scenario: a rewrite that fits its old slot still moves to a new one, and the old slot is only reused after Sync.
+  dm->WritePage(3, noise);
+  EXPECT_EQ(static_cast<uint64_t>(5 * PAGE_SIZE), dm->GetFileEnd());
+  EXPECT_TRUE(dm->Sync());
+  dm->WritePage(4, noise);
+  EXPECT_EQ(static_cast<uint64_t>(5 * PAGE_SIZE), dm->GetFileEnd());
+  dm->ReadPage(3, buf);
+  EXPECT_EQ(0, memcmp(noise, buf, PAGE_SIZE));
+  dm->ReadPage(4, buf);
+  EXPECT_EQ(0, memcmp(noise, buf, PAGE_SIZE));
+  dm->ShutDown();
+  delete dm;
+
+  // Scenario: a new database ignores the map of the one it replaces.
+  remove("test.db");
+  dm = new CompressedDiskManager("test.db");
+  EXPECT_EQ(0, dm->GetNumPages());
+  dm->ShutDown();
+  delete dm;
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, FailedReadTest) {
+  auto dm = new CompressedDiskManager("test.db");
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE];
+  snprintf(data, PAGE_SIZE, "sparse page");
+  dm->WritePage(0, data);
+  dm->ShutDown();
+  delete dm;
+
+  // Cut the compressed length of page 0 in half in the map file. An entry is an 8-byte offset, then the length.
+  FILE *map = fopen("test.map", "r+b");
+  ASSERT_NE(nullptr, map);
+  uint32_t length;
+  ASSERT_EQ(0, fseek(map, 8, SEEK_SET));
+  ASSERT_EQ(1U, fread(&length, sizeof(length), 1, map));
+  length /= 2;
+  ASSERT_EQ(0, fseek(map, 8, SEEK_SET));
+  ASSERT_EQ(1U, fwrite(&length, sizeof(length), 1, map));
+  fclose(map);
+
+  // Scenario: a page that does not decompress is counted as a failed read rather than passed off as a page of
+  // zeroes without a trace.
+  dm = new CompressedDiskManager("test.db");
+  memset(buf, 'x', PAGE_SIZE);
+  dm->ReadPage(0, buf);
+  EXPECT_EQ(1U, dm->GetNumFailedReads());
+  EXPECT_EQ(0, buf[0]);
+  dm->ReadPage(1, buf);
+  EXPECT_EQ(1U, dm->GetNumFailedReads());
+  dm->ShutDown();
+  delete dm;
+}
+
+// A benchmark: run it explicitly with --gtest_also_run_disabled_tests.
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, DISABLED_TablePageBenchmarkTest) {
+  const size_t pool_size = 64;
+  const page_id_t num_pages = 1024;
+  const int fetches = 4000;
+  // About 33 bytes per row with its slot, so 60 rows fill half a page.
+  const int rows_per_page = 60;
+  Schema schema({Column("id", TypeId::INTEGER), Column("name", TypeId::VARCHAR, 32)});
+  uint64_t uncompressed_bytes = static_cast<uint64_t>(num_pages) * PAGE_SIZE;
+
+  // Table pages filled to about half, the way a table looks after deletes or with a low fill factor, written through
+  // a buffer pool smaller than the table and read back at random.
+  auto *dm = new CompressedDiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(pool_size, dm);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < num_pages; i++) {
+    auto *page = reinterpret_cast<TablePage *>(bpm->NewPage(&page_id));
+    ASSERT_NE(nullptr, page);
+    page->Init(page_id, PAGE_SIZE, INVALID_PAGE_ID, nullptr, nullptr);
+    RID rid;
+    for (int row = 0; row < rows_per_page; row++) {
+      std::string name = "customer " + std::to_string(page_id * 1000 + row);
+      Tuple tuple({ValueFactory::GetIntegerValue(page_id * 1000 + row), ValueFactory::GetVarcharValue(name)}, &schema);
+      ASSERT_TRUE(page->InsertTuple(tuple, &rid, nullptr, nullptr, nullptr));
+    }
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+  const uint64_t written = dm->GetBytesWritten();
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < fetches; i++) {
+    page_id_t fetch_id = dist(rng);
+    auto *page = reinterpret_cast<TablePage *>(bpm->FetchPage(fetch_id));
+    ASSERT_NE(nullptr, page);
+    ASSERT_EQ(fetch_id, page->GetTablePageId());
+    bpm->UnpinPage(fetch_id, false);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const uint64_t reads = bpm->GetStats().disk_reads_;
+  printf("wrote %.1f KiB instead of %.1f KiB (%.0f%%), file %.1f KiB\n", written / 1024.0,
+         uncompressed_bytes / 1024.0, 100.0 * written / uncompressed_bytes, dm->GetFileEnd() / 1024.0);
+  printf("read %.1f KiB for %zu page misses instead of %.1f KiB, %.0f fetches/s\n", dm->GetBytesRead() / 1024.0,
+         static_cast<size_t>(reads), reads * PAGE_SIZE / 1024.0, fetches / seconds);
+  EXPECT_LT(written, uncompressed_bytes * 3 / 4);
+
+  delete bpm;
+  dm->ShutDown();
+  delete dm;
+}
+
+}  // namespace bustub
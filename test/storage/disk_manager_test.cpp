@@ -10,8 +10,23 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
+#include "buffer/buffer_pool_manager_instance.h"
 #include "common/exception.h"
 #include "gtest/gtest.h"
 #include "storage/disk/disk_manager.h"
@@ -24,12 +39,17 @@ class DiskManagerTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.free");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
     remove("test.log");
+    remove("test.free");
+    for (int segment = 1; segment < 8; segment++) {
+      remove(("test.db." + std::to_string(segment)).c_str());
+    }
   };
 };
 
@@ -72,6 +92,305 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, FreePageTest) {
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = new DiskManager(db_file);
+  for (page_id_t page_id = 0; page_id < 8; page_id++) {
+    dm->WritePage(page_id, data);
+  }
+  EXPECT_EQ(INVALID_PAGE_ID, dm->ReuseFreePage(1, 0));
+
+  // Scenario: freed pages come back once each, and only to the stripe that owns them.
+  dm->DeallocatePage(2);
+  dm->DeallocatePage(5);
+  dm->DeallocatePage(5);
+  dm->DeallocatePage(6);
+  EXPECT_EQ(3U, dm->GetNumFreePages());
+  EXPECT_EQ(INVALID_PAGE_ID, dm->ReuseFreePage(3, 1));
+  EXPECT_EQ(2, dm->ReuseFreePage(3, 2));
+  EXPECT_EQ(5, dm->ReuseFreePage(3, 2));
+  EXPECT_EQ(INVALID_PAGE_ID, dm->ReuseFreePage(3, 2));
+  dm->DeallocatePage(11);
+  EXPECT_EQ(12, dm->GetNumPages());
+  dm->ShutDown();
+  delete dm;
+
+  // Scenario: reopening the database brings back the pages that were still free.
+  dm = new DiskManager(db_file);
+  EXPECT_EQ(2U, dm->GetNumFreePages());
+  EXPECT_EQ(12, dm->GetNumPages());
+  EXPECT_EQ(INVALID_PAGE_ID, dm->ReuseFreePage(1, 0, 6));
+  EXPECT_EQ(6, dm->ReuseFreePage(1, 0, 7));
+
+  // Scenario: claiming a page takes it out of the bitmap, and claiming a page in use does nothing.
+  EXPECT_TRUE(dm->ClaimPage(11));
+  EXPECT_FALSE(dm->ClaimPage(11));
+  EXPECT_FALSE(dm->ClaimPage(1));
+  EXPECT_EQ(0U, dm->GetNumFreePages());
+  EXPECT_EQ(8, dm->GetNumPages());
+  dm->DeallocatePage(3);
+  EXPECT_TRUE(dm->Sync());
+  dm->ShutDown();
+  delete dm;
+
+  // Scenario: a new database file ignores the bitmap of the one it replaces.
+  remove("test.db");
+  dm = new DiskManager(db_file);
+  EXPECT_EQ(0U, dm->GetNumFreePages());
+  EXPECT_EQ(INVALID_PAGE_ID, dm->ReuseFreePage(1, 0));
+  dm->ShutDown();
+  delete dm;
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LargeOffsetTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  std::strncpy(data, "A test string.", sizeof(data));
+  DiskManager dm("test.db");
+
+  // Scenario: a page past 2 GiB lands at its 64-bit offset; the file is sparse, so this costs one page of disk.
+  const page_id_t far_page = 600000;
+  dm.WritePage(far_page, data);
+  dm.ReadPage(far_page, buf);
+  EXPECT_EQ(0, std::memcmp(buf, data, sizeof(buf)));
+  EXPECT_EQ(far_page + 1, dm.GetNumPages());
+  dm.ReadPage(far_page - 1, buf);
+  EXPECT_EQ(0, buf[0]);
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, SegmentedFileTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  DiskManagerOptions options;
+  options.segment_pages_ = 4;
+  auto dm = new DiskManager("test.db", options);
+  EXPECT_EQ(1U, dm->GetNumSegments());
+
+  // Scenario: writing a page creates its segment and every segment before it; reads of other segments see zeroes.
+  for (page_id_t page_id : {0, 5, 13}) {
+    snprintf(data, PAGE_SIZE, "page %d", page_id);
+    dm->WritePage(page_id, data);
+  }
+  EXPECT_EQ(4U, dm->GetNumSegments());
+  EXPECT_EQ(14, dm->GetNumPages());
+  dm->ReadPage(9, buf);
+  EXPECT_EQ(0, buf[0]);
+  dm->ReadPage(100, buf);
+  EXPECT_EQ(0, buf[0]);
+  EXPECT_EQ(4U, dm->GetNumSegments());
+  struct stat stat_buf;
+  ASSERT_EQ(0, stat("test.db.1", &stat_buf));
+  EXPECT_EQ(2 * PAGE_SIZE, stat_buf.st_size);
+  ASSERT_EQ(0, stat("test.db.3", &stat_buf));
+  EXPECT_EQ(2 * PAGE_SIZE, stat_buf.st_size);
+  dm->ShutDown();
+  delete dm;
+
+  // Scenario: reopening the database finds all its segments.
+  dm = new DiskManager("test.db", options);
+  EXPECT_EQ(4U, dm->GetNumSegments());
+  EXPECT_EQ(14, dm->GetNumPages());
+  for (page_id_t page_id : {0, 5, 13}) {
+    snprintf(data, PAGE_SIZE, "page %d", page_id);
+    dm->ReadPage(page_id, buf);
+    EXPECT_STREQ(data, buf);
+  }
+  dm->ShutDown();
+  delete dm;
+
+  // Scenario: a new database removes the segments of the one it replaces.
+  remove("test.db");
+  dm = new DiskManager("test.db", options);
+  EXPECT_EQ(1U, dm->GetNumSegments());
+  EXPECT_NE(0, stat("test.db.1", &stat_buf));
+  EXPECT_EQ(0, dm->GetNumPages());
+  dm->ShutDown();
+  delete dm;
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, DirectIoTest) {
+  DiskManagerOptions options;
+  options.direct_io_ = true;
+  auto dm = new DiskManager("test.db", options);
+  std::unique_ptr<char, decltype(&free)> aligned(static_cast<char *>(aligned_alloc(PAGE_SIZE, 2 * PAGE_SIZE)), &free);
+  char unaligned_storage[PAGE_SIZE + 1];
+  char *unaligned = unaligned_storage + 1;
+  char buf[PAGE_SIZE];
+
+  // Scenario: aligned and unaligned buffers both work, the unaligned ones through the bounce buffer.
+  snprintf(aligned.get(), PAGE_SIZE, "aligned page");
+  snprintf(unaligned, PAGE_SIZE, "unaligned page");
+  dm->WritePage(0, aligned.get());
+  dm->WritePage(1, unaligned);
+  dm->ReadPage(0, unaligned);
+  EXPECT_STREQ("aligned page", unaligned);
+  dm->ReadPage(1, aligned.get());
+  EXPECT_STREQ("unaligned page", aligned.get());
+  dm->ReadPage(7, buf);
+  EXPECT_EQ(0, buf[0]);
+
+  // Scenario: a run of pages is written in one go if every buffer is aligned and page by page if not.
+  snprintf(aligned.get(), PAGE_SIZE, "page 2");
+  snprintf(aligned.get() + PAGE_SIZE, PAGE_SIZE, "page 3");
+  const char *aligned_run[] = {aligned.get(), aligned.get() + PAGE_SIZE};
+  dm->WritePages(2, aligned_run, 2);
+  snprintf(unaligned, PAGE_SIZE, "page 5");
+  const char *mixed_run[] = {aligned.get(), unaligned};
+  dm->WritePages(4, mixed_run, 2);
+  EXPECT_EQ(6, dm->GetNumWrites());
+  dm->ShutDown();
+  delete dm;
+
+  dm = new DiskManager("test.db", options);
+  for (page_id_t page_id : {2, 3, 5}) {
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    dm->ReadPage(page_id, buf);
+    EXPECT_STREQ(expected, buf);
+  }
+  dm->ShutDown();
+  delete dm;
+}
+
+/** @return how many KiB of the file are in the page cache */
+static size_t CachedKiB(const std::string &file_name) {
+  struct stat stat_buf;
+  if (stat(file_name.c_str(), &stat_buf) != 0 || stat_buf.st_size == 0) {
+    return 0;
+  }
+  int fd = open(file_name.c_str(), O_RDONLY);
+  void *map = mmap(nullptr, stat_buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  const size_t os_page_size = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> resident((stat_buf.st_size + os_page_size - 1) / os_page_size);
+  size_t cached = 0;
+  if (map != MAP_FAILED && mincore(map, stat_buf.st_size, resident.data()) == 0) {
+    for (unsigned char page : resident) {
+      cached += page & 1;
+    }
+  }
+  if (map != MAP_FAILED) {
+    munmap(map, stat_buf.st_size);
+  }
+  close(fd);
+  return cached * os_page_size / 1024;
+}
+
+/** @return the resident set size of this process in KiB */
+static size_t RssKiB() {
+  size_t total = 0;
+  size_t resident = 0;
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (statm != nullptr) {
+    if (fscanf(statm, "%zu %zu", &total, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(statm);
+  }
+  return resident * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+// A benchmark: run it explicitly with --gtest_also_run_disabled_tests.
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, DISABLED_DirectIoBenchmarkTest) {
+  const size_t pool_size = 256;
+  const page_id_t num_pages = 8192;
+  const int fetches = 20000;
+  size_t buffered_cached = 0;
+
+  // A dataset 32 times the pool, read at random through the buffer pool. With buffered I/O the whole file ends up in
+  // the page cache on top of the pool; with O_DIRECT only the pool holds pages.
+  for (bool direct_io : {false, true}) {
+    remove("test.db");
+    DiskManagerOptions options;
+    options.direct_io_ = direct_io;
+    auto *dm = new DiskManager("test.db", options);
+    auto *bpm = new BufferPoolManagerInstance(pool_size, dm);
+    page_id_t page_id;
+    for (page_id_t i = 0; i < num_pages; i++) {
+      Page *page = bpm->NewPage(&page_id);
+      ASSERT_NE(nullptr, page);
+      memcpy(page->GetData(), &page_id, sizeof(page_id));
+      bpm->UnpinPage(page_id, true);
+    }
+    bpm->FlushAllPages();
+
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+    int wrong = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < fetches; i++) {
+      page_id_t fetch_id = dist(rng);
+      Page *page = bpm->FetchPage(fetch_id);
+      ASSERT_NE(nullptr, page);
+      wrong += memcmp(page->GetData(), &fetch_id, sizeof(fetch_id)) != 0 ? 1 : 0;
+      bpm->UnpinPage(fetch_id, false);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(0, wrong);
+    size_t cached = CachedKiB("test.db");
+    printf("%s: %.0f fetches/s, RSS %zu KiB, %zu KiB of the %d KiB file in the page cache\n",
+           dm->IsDirectIo() ? "O_DIRECT" : "buffered", fetches / seconds, RssKiB(), cached,
+           num_pages * PAGE_SIZE / 1024);
+    if (!direct_io) {
+      buffered_cached = cached;
+    } else if (dm->IsDirectIo()) {
+      EXPECT_LT(cached, buffered_cached);
+    }
+
+    delete bpm;
+    dm->ShutDown();
+    delete dm;
+  }
+}
+
+// A benchmark: run it explicitly with --gtest_also_run_disabled_tests.
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, DISABLED_RandomReadBenchmarkTest) {
+  const page_id_t num_pages = 1024;
+  const int reads_per_thread = 20000;
+  DiskManager dm("test.db");
+  char data[PAGE_SIZE] = {0};
+  for (page_id_t i = 0; i < num_pages; i++) {
+    memcpy(data, &i, sizeof(i));
+    dm.WritePage(i, data);
+  }
+
+  // Every thread reads random pages of a file that sits in the page cache and checks that it got the right one.
+  for (int num_threads : {1, 4}) {
+    std::atomic<int> wrong{0};
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t] {
+        std::mt19937 rng(t);
+        std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+        char buf[PAGE_SIZE];
+        for (int i = 0; i < reads_per_thread; i++) {
+          page_id_t page_id = dist(rng);
+          dm.ReadPage(page_id, buf);
+          if (memcmp(buf, &page_id, sizeof(page_id)) != 0) {
+            wrong++;
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%d threads: %.0f random page reads/s\n", num_threads, num_threads * reads_per_thread / seconds);
+    EXPECT_EQ(0, wrong);
+  }
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
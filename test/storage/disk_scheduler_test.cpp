@@ -0,0 +1,316 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_scheduler_test.cpp
+//
+// Identification: test/storage/disk_scheduler_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/disk/disk_scheduler.h"
+
+namespace bustub {
+
+/** A disk manager whose reads of one page wait until the test opens the gate, and that counts vectored writes. */
+class GatedDiskManager : public DiskManager {
+ public:
+  GatedDiskManager(const std::string &db_file, page_id_t gated_page)
+      : DiskManager(db_file), gated_page_(gated_page), gate_(opened_.get_future().share()) {}
+
+  void ReadPage(page_id_t page_id, char *page_data) override {
+    if (page_id == gated_page_) {
+      entered_.set_value();
+      gate_.wait();
+    }
+    DiskManager::ReadPage(page_id, page_data);
+  }
+
+  void WritePages(page_id_t first_page_id, const char *const *pages_data, size_t num_pages) override {
+    {
+      std::scoped_lock lock(latch_);
+      runs_.push_back(num_pages);
+    }
+    DiskManager::WritePages(first_page_id, pages_data, num_pages);
+  }
+
+  /** Waits until a worker is stuck reading the gated page. */
+  void WaitAtGate() { entered_.get_future().wait(); }
+
+  void Open() { opened_.set_value(); }
+
+  std::vector<size_t> GetRuns() {
+    std::scoped_lock lock(latch_);
+    return runs_;
+  }
+
+ private:
+  page_id_t gated_page_;
+  std::promise<void> entered_;
+  std::promise<void> opened_;
+  std::shared_future<void> gate_;
+  std::mutex latch_;
+  std::vector<size_t> runs_;
+};
+
+class DiskSchedulerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.free");
+  }
+
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.free");
+  }
+
+  /** @return a callback that appends name to order_ */
+  DiskCallback Record(const std::string &name) {
+    return [this, name](bool ok) {
+      EXPECT_TRUE(ok);
+      std::scoped_lock lock(order_latch_);
+      order_.push_back(name);
+    };
+  }
+
+  std::mutex order_latch_;
+  std::vector<std::string> order_;
+};
+
+// NOLINTNEXTLINE
+TEST_F(DiskSchedulerTest, PriorityTest) {
+  GatedDiskManager dm("test.db", 0);
+  char gated[PAGE_SIZE];
+  char data[3][PAGE_SIZE] = {{0}};
+  char log[] = "log record";
+  {
+    // One worker, held up by the gated read while everything else queues behind it.
+    DiskScheduler scheduler(&dm, 1);
+    scheduler.Schedule({false, 0, gated, Record("gate")}, IoPriority::FOREGROUND);
+    dm.WaitAtGate();
+    scheduler.Schedule({true, 10, data[0], Record("cleaner")}, IoPriority::BACKGROUND);
+    scheduler.ScheduleLogWrite(log, sizeof(log), Record("log"));
+    scheduler.Schedule({false, 20, data[1], Record("miss")}, IoPriority::FOREGROUND);
+    scheduler.Schedule({true, 30, data[2], Record("checkpoint")}, IoPriority::BACKGROUND);
+
+    // Scenario: while the disk is busy, the queues report what is waiting.
+    DiskSchedulerStats stats = scheduler.GetStats();
+    EXPECT_EQ(2, stats.queues_[static_cast<size_t>(IoPriority::BACKGROUND)].depth_);
+    EXPECT_EQ(1, stats.queues_[static_cast<size_t>(IoPriority::LOG)].depth_);
+    EXPECT_EQ(1, stats.queues_[static_cast<size_t>(IoPriority::FOREGROUND)].depth_);
+    dm.Open();
+  }
+
+  // Scenario: the foreground miss goes first, then the log, then the background writes in the order they came.
+  std::vector<std::string> expected{"gate", "miss", "log", "cleaner", "checkpoint"};
+  EXPECT_EQ(expected, order_);
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskSchedulerTest, MergeTest) {
+  GatedDiskManager dm("test.db", 0);
+  char gated[PAGE_SIZE];
+  char older[PAGE_SIZE] = {0};
+  char newer[PAGE_SIZE] = {0};
+  char read[PAGE_SIZE];
+  char first_reader[PAGE_SIZE];
+  char second_reader[PAGE_SIZE];
+  std::strncpy(older, "older", PAGE_SIZE);
+  std::strncpy(newer, "newer", PAGE_SIZE);
+  char seven[PAGE_SIZE] = {0};
+  std::strncpy(seven, "page 7", PAGE_SIZE);
+  dm.WritePage(7, seven);
+  const int writes_before = dm.GetNumWrites();
+
+  DiskScheduler scheduler(&dm, 1);
+  auto gate = scheduler.Schedule(false, 0, gated, IoPriority::FOREGROUND);
+  dm.WaitAtGate();
+
+  // Scenario: a second write of a queued page replaces the first one and moves it up to its priority.
+  auto older_written = scheduler.Schedule(true, 5, older, IoPriority::BACKGROUND);
+  auto newer_written = scheduler.Schedule(true, 5, newer, IoPriority::FOREGROUND);
+  DiskSchedulerStats stats = scheduler.GetStats();
+  EXPECT_EQ(0, stats.queues_[static_cast<size_t>(IoPriority::BACKGROUND)].depth_);
+  EXPECT_EQ(1, stats.queues_[static_cast<size_t>(IoPriority::FOREGROUND)].depth_);
+
+  // Scenario: a read of a page with a queued write gets the write's data without waiting for the disk.
+  auto read_done = scheduler.Schedule(false, 5, read, IoPriority::FOREGROUND);
+  ASSERT_EQ(std::future_status::ready, read_done.wait_for(std::chrono::seconds(0)));
+  EXPECT_STREQ("newer", read);
+
+  // Scenario: two reads of the same page share one disk read.
+  auto first_read = scheduler.Schedule(false, 7, first_reader, IoPriority::FOREGROUND);
+  auto second_read = scheduler.Schedule(false, 7, second_reader, IoPriority::FOREGROUND);
+
+  dm.Open();
+  EXPECT_TRUE(gate.get());
+  EXPECT_TRUE(older_written.get());
+  EXPECT_TRUE(newer_written.get());
+  EXPECT_TRUE(first_read.get());
+  EXPECT_TRUE(second_read.get());
+  EXPECT_STREQ("page 7", first_reader);
+  EXPECT_STREQ("page 7", second_reader);
+  dm.ReadPage(5, read);
+  EXPECT_STREQ("newer", read);
+  EXPECT_EQ(writes_before + 1, dm.GetNumWrites());
+
+  stats = scheduler.GetStats();
+  EXPECT_EQ(1, stats.queues_[static_cast<size_t>(IoPriority::BACKGROUND)].requests_);
+  EXPECT_EQ(5, stats.queues_[static_cast<size_t>(IoPriority::FOREGROUND)].requests_);
+  EXPECT_EQ(3, stats.queues_[static_cast<size_t>(IoPriority::FOREGROUND)].merged_);
+  // The gated read, page 5 and page 7.
+  EXPECT_EQ(3, stats.queues_[static_cast<size_t>(IoPriority::FOREGROUND)].operations_);
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskSchedulerTest, CoalesceTest) {
+  const int num_pages = 8;
+  GatedDiskManager dm("test.db", 100);
+  char gated[PAGE_SIZE];
+  std::vector<std::unique_ptr<char[]>> pages;
+  for (int i = 0; i < num_pages; i++) {
+    pages.emplace_back(new char[PAGE_SIZE]);
+    snprintf(pages.back().get(), PAGE_SIZE, "page %d", i);
+  }
+
+  // Scenario: background writes of consecutive pages that wait together go to the disk in one vectored write.
+  std::vector<std::future<bool>> writes;
+  {
+    DiskScheduler scheduler(&dm, 1);
+    auto gate = scheduler.Schedule(false, 100, gated, IoPriority::FOREGROUND);
+    dm.WaitAtGate();
+    // Queued out of order; the run is still found.
+    for (int i = num_pages - 1; i >= 0; i--) {
+      writes.push_back(scheduler.Schedule(true, i, pages[i].get(), IoPriority::BACKGROUND));
+    }
+    dm.Open();
+    for (auto &write : writes) {
+      EXPECT_TRUE(write.get());
+    }
+    DiskSchedulerStats stats = scheduler.GetStats();
+    EXPECT_EQ(1, stats.queues_[static_cast<size_t>(IoPriority::BACKGROUND)].operations_);
+    EXPECT_EQ(num_pages, stats.queues_[static_cast<size_t>(IoPriority::BACKGROUND)].max_depth_);
+  }
+  EXPECT_EQ(std::vector<size_t>{num_pages}, dm.GetRuns());
+
+  char buf[PAGE_SIZE];
+  char expected[PAGE_SIZE];
+  for (int i = 0; i < num_pages; i++) {
+    dm.ReadPage(i, buf);
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_STREQ(expected, buf);
+  }
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskSchedulerTest, BandwidthCapTest) {
+  const int num_pages = 20;
+  const size_t pages_per_second = 40;
+  DiskManager dm("test.db");
+  char data[PAGE_SIZE] = {0};
+  char read[PAGE_SIZE];
+  DiskScheduler scheduler(&dm);
+  scheduler.SetBackgroundBandwidth(pages_per_second * PAGE_SIZE);
+
+  // Pages far apart, so every write is its own operation.
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::future<bool>> writes;
+  for (int i = 0; i < num_pages; i++) {
+    writes.push_back(scheduler.Schedule(true, i * 2, data, IoPriority::BACKGROUND));
+  }
+
+  // Scenario: a foreground read does not wait for the throttled background writes.
+  EXPECT_TRUE(scheduler.Schedule(false, 1000, read, IoPriority::FOREGROUND).get());
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+
+  // Scenario: the background writes take as long as the cap demands.
+  for (auto &write : writes) {
+    EXPECT_TRUE(write.get());
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_GE(elapsed, std::chrono::milliseconds(1000 * (num_pages - 1) / pages_per_second));
+  DiskSchedulerStats stats = scheduler.GetStats();
+  EXPECT_GE(stats.throttled_, num_pages - 1);
+  EXPECT_GT(stats.queues_[static_cast<size_t>(IoPriority::BACKGROUND)].max_wait_,
+            stats.queues_[static_cast<size_t>(IoPriority::FOREGROUND)].max_wait_);
+
+  // Scenario: lifting the cap lets the rest through at once.
+  scheduler.SetBackgroundBandwidth(0);
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_pages; i++) {
+    writes[i] = scheduler.Schedule(true, i * 2, data, IoPriority::BACKGROUND);
+  }
+  for (auto &write : writes) {
+    EXPECT_TRUE(write.get());
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskSchedulerTest, BufferPoolTest) {
+  const int num_pages = 100;
+  auto *dm = new DiskManager("test.db");
+  auto *scheduler = new DiskScheduler(dm);
+  auto *bpm = new ParallelBufferPoolManager(2, 10, dm);
+  bpm->SetDiskScheduler(scheduler);
+  bpm->RunPageCleaner(4);
+
+  // Scenario: misses, evictions, the page cleaner and a flush all go through the scheduler and every page survives.
+  page_id_t page_id;
+  for (int i = 0; i < num_pages; i++) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+  char expected[PAGE_SIZE];
+  for (page_id_t id = 0; id < num_pages; id++) {
+    Page *page = bpm->FetchPage(id);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", id);
+    EXPECT_STREQ(expected, page->GetData());
+    snprintf(page->GetData(), PAGE_SIZE, "page %d again", id);
+    bpm->UnpinPage(id, true);
+  }
+  bpm->StopPageCleaner();
+  bpm->FlushAllPages();
+
+  DiskSchedulerStats stats = scheduler->GetStats();
+  EXPECT_GT(stats.queues_[static_cast<size_t>(IoPriority::FOREGROUND)].requests_, 0);
+  EXPECT_GT(stats.queues_[static_cast<size_t>(IoPriority::BACKGROUND)].requests_, 0);
+  EXPECT_EQ(0, stats.queues_[static_cast<size_t>(IoPriority::FOREGROUND)].depth_);
+  EXPECT_EQ(0, stats.queues_[static_cast<size_t>(IoPriority::BACKGROUND)].depth_);
+
+  delete bpm;
+  delete scheduler;
+  char buf[PAGE_SIZE];
+  for (page_id_t id = 0; id < num_pages; id++) {
+    dm->ReadPage(id, buf);
+    snprintf(expected, PAGE_SIZE, "page %d again", id);
+    EXPECT_STREQ(expected, buf);
+  }
+  dm->ShutDown();
+  delete dm;
+}
+
+}  // namespace bustub
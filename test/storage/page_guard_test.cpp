@@ -0,0 +1,193 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard_test.cpp
+//
+// Identification: test/storage/page_guard_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/page/page_guard.h"
+
+namespace bustub {
+
+class PageGuardTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManagerInstance(buffer_pool_size_, disk_manager_);
+  }
+
+  void TearDown() override {
+    delete bpm_;
+    disk_manager_->ShutDown();
+    delete disk_manager_;
+    remove("test.db");
+    remove("test.log");
+  }
+
+  const size_t buffer_pool_size_ = 5;
+  DiskManager *disk_manager_;
+  BufferPoolManagerInstance *bpm_;
+};
+
+// NOLINTNEXTLINE
+TEST_F(PageGuardTest, SampleTest) {
+  page_id_t page_id_temp;
+  Page *page0 = bpm_->NewPage(&page_id_temp);
+
+  // Scenario: the guard takes over the pin and gives it back when dropped.
+  auto guarded_page = BasicPageGuard(bpm_, page0);
+  EXPECT_EQ(page0->GetData(), guarded_page.GetData());
+  EXPECT_EQ(page0->GetPageId(), guarded_page.PageId());
+  EXPECT_EQ(1, page0->GetPinCount());
+  guarded_page.Drop();
+  EXPECT_EQ(0, page0->GetPinCount());
+  EXPECT_FALSE(guarded_page.IsValid());
+
+  // Scenario: dropping twice, or dropping an empty guard, is harmless.
+  guarded_page.Drop();
+  BasicPageGuard().Drop();
+  EXPECT_EQ(0, page0->GetPinCount());
+
+  // Scenario: the destructor unpins a guard that is still holding the page.
+  {
+    BasicPageGuard scoped_guard = bpm_->FetchPageBasic(page_id_temp);
+    EXPECT_EQ(1, page0->GetPinCount());
+  }
+  EXPECT_EQ(0, page0->GetPinCount());
+}
+
+// NOLINTNEXTLINE
+TEST_F(PageGuardTest, MoveTest) {
+  page_id_t page_id0;
+  page_id_t page_id1;
+  BasicPageGuard guard0 = bpm_->NewPageGuarded(&page_id0);
+  BasicPageGuard guard1 = bpm_->NewPageGuarded(&page_id1);
+  Page *page0 = guard0.GetPage();
+  Page *page1 = guard1.GetPage();
+
+  // Scenario: moving a guard moves the pin; the page is not unpinned and pinned again.
+  BasicPageGuard moved(std::move(guard0));
+  EXPECT_FALSE(guard0.IsValid());  // NOLINT
+  EXPECT_TRUE(moved.IsValid());
+  EXPECT_EQ(1, page0->GetPinCount());
+
+  // Scenario: move assignment drops the page the target was holding.
+  moved = std::move(guard1);
+  EXPECT_EQ(0, page0->GetPinCount());
+  EXPECT_EQ(1, page1->GetPinCount());
+  EXPECT_EQ(page_id1, moved.PageId());
+
+  // Scenario: self move assignment keeps the pin.
+  BasicPageGuard &alias = moved;
+  moved = std::move(alias);
+  EXPECT_EQ(1, page1->GetPinCount());
+
+  // Scenario: upgrading hands the pin over to a latched guard.
+  WritePageGuard write_guard = moved.UpgradeWrite();
+  EXPECT_FALSE(moved.IsValid());  // NOLINT
+  EXPECT_EQ(1, page1->GetPinCount());
+  write_guard.Drop();
+  EXPECT_EQ(0, page1->GetPinCount());
+}
+
+// NOLINTNEXTLINE
+TEST_F(PageGuardTest, LatchAndDirtyTest) {
+  page_id_t page_id_temp;
+  BasicPageGuard new_guard = bpm_->NewPageGuarded(&page_id_temp);
+  Page *page = new_guard.GetPage();
+  new_guard.Drop();
+  EXPECT_FALSE(page->IsDirty());
+
+  // Scenario: any number of read guards can share the page, and reading does not dirty it.
+  {
+    ReadPageGuard reader0 = bpm_->FetchPageRead(page_id_temp);
+    ReadPageGuard reader1 = bpm_->FetchPageRead(page_id_temp);
+    EXPECT_EQ(2, page->GetPinCount());
+    EXPECT_EQ(0, reader0.GetData()[0]);
+  }
+  EXPECT_EQ(0, page->GetPinCount());
+  EXPECT_FALSE(page->IsDirty());
+
+  // Scenario: a write guard that only looks at the page leaves it clean.
+  {
+    WritePageGuard writer = bpm_->FetchPageWrite(page_id_temp);
+    EXPECT_EQ(0, writer.As<char>()[0]);
+  }
+  EXPECT_FALSE(page->IsDirty());
+
+  // Scenario: writing through the guard marks the page dirty when the guard lets go.
+  {
+    WritePageGuard writer = bpm_->FetchPageWrite(page_id_temp);
+    snprintf(writer.GetDataMut(), PAGE_SIZE, "Hello");
+  }
+  EXPECT_EQ(0, page->GetPinCount());
+  EXPECT_TRUE(page->IsDirty());
+
+  // Scenario: the write latch was released, so a reader gets in and sees the change.
+  ReadPageGuard reader = bpm_->FetchPageRead(page_id_temp);
+  EXPECT_EQ(0, strcmp(reader.GetData(), "Hello"));
+}
+
+// NOLINTNEXTLINE
+TEST_F(PageGuardTest, FetchFailureTest) {
+  // Scenario: with every frame pinned, guarded fetches come back empty instead of crashing.
+  page_id_t page_id_temp;
+  BasicPageGuard guards[5];
+  for (auto &guard : guards) {
+    guard = bpm_->NewPageGuarded(&page_id_temp);
+    EXPECT_TRUE(guard.IsValid());
+  }
+  EXPECT_FALSE(bpm_->NewPageGuarded(&page_id_temp).IsValid());
+  EXPECT_FALSE(bpm_->FetchPageRead(page_id_temp + 1).IsValid());
+  EXPECT_FALSE(bpm_->FetchPageWrite(page_id_temp + 1).IsValid());
+
+  // Scenario: once a guard lets go, its frame can be reused.
+  guards[0].Drop();
+  EXPECT_TRUE(bpm_->NewPageGuarded(&page_id_temp).IsValid());
+}
+
+// NOLINTNEXTLINE
+TEST(PageGuardParallelTest, UnpinThroughInstanceTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(3, 5, disk_manager);
+
+  // Scenario: guards from a parallel buffer pool give their pin back to the instance that owns the page.
+  page_id_t page_ids[6];
+  Page *pages[6];
+  for (int i = 0; i < 6; i++) {
+    BasicPageGuard guard = bpm->NewPageGuarded(&page_ids[i]);
+    ASSERT_TRUE(guard.IsValid());
+    pages[i] = guard.GetPage();
+    snprintf(guard.GetDataMut(), PAGE_SIZE, "page %d", page_ids[i]);
+  }
+  char expected[PAGE_SIZE];
+  for (int i = 0; i < 6; i++) {
+    EXPECT_EQ(0, pages[i]->GetPinCount());
+    EXPECT_TRUE(pages[i]->IsDirty());
+    ReadPageGuard guard = bpm->FetchPageRead(page_ids[i]);
+    EXPECT_EQ(pages[i], guard.GetPage());
+    snprintf(expected, PAGE_SIZE, "page %d", page_ids[i]);
+    EXPECT_EQ(0, strcmp(guard.GetData(), expected));
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
@@ -0,0 +1,121 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_latch_test.cpp
+//
+// Identification: test/storage/page_latch_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(PageLatchTest, OptimisticReadTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(2, disk_manager);
+  page_id_t page_id;
+  Page *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+
+  // Scenario: with no writer around, a read validates, also while other readers hold the read latch.
+  uint64_t version = page->OptimisticRead();
+  EXPECT_TRUE(page->Validate(version));
+  page->RLatch();
+  EXPECT_TRUE(page->Validate(version));
+  EXPECT_EQ(version, page->OptimisticRead());
+  page->RUnlatch();
+
+  // Scenario: a read that overlaps a write latch fails, whether it started before the latch or while it was held.
+  page->WLatch();
+  EXPECT_FALSE(page->Validate(version));
+  uint64_t latched_version = page->OptimisticRead();
+  EXPECT_FALSE(page->Validate(latched_version));
+  page->WUnlatch();
+  EXPECT_FALSE(page->Validate(version));
+  EXPECT_FALSE(page->Validate(latched_version));
+
+  // Scenario: once the writer is gone, a new read validates again.
+  EXPECT_TRUE(page->Validate(page->OptimisticRead()));
+
+  bpm->UnpinPage(page_id, false);
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+// NOLINTNEXTLINE
+TEST(PageLatchTest, ConcurrentOptimisticReadTest) {
+  const int reads_per_reader = 5000;
+  const int num_readers = 3;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(2, disk_manager);
+  page_id_t page_id;
+  Page *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+
+  // The writer fills the whole page with one byte value per write, so a copy that mixes two writes is torn.
+  std::atomic<int> readers_running{num_readers};
+  std::atomic<int> writes{0};
+  std::thread writer([&] {
+    while (readers_running > 0) {
+      page->WLatch();
+      memset(page->GetData(), writes % 128, PAGE_SIZE);
+      page->WUnlatch();
+      writes++;
+      std::this_thread::yield();
+    }
+  });
+
+  // Scenario: a copy that validated is never torn, however often the writer gets in between.
+  std::vector<std::thread> readers;
+  std::atomic<size_t> torn{0};
+  std::atomic<size_t> validated{0};
+  for (int t = 0; t < num_readers; t++) {
+    readers.emplace_back([&] {
+      char copy[PAGE_SIZE];
+      for (int i = 0; i < reads_per_reader; i++) {
+        uint64_t version = page->OptimisticRead();
+        memcpy(copy, page->GetData(), PAGE_SIZE);
+        if (!page->Validate(version)) {
+          continue;
+        }
+        validated++;
+        for (char byte : copy) {
+          if (byte != copy[0]) {
+            torn++;
+            break;
+          }
+        }
+      }
+      readers_running--;
+    });
+  }
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0U, torn);
+  EXPECT_GT(validated, 0U);
+  EXPECT_GT(writes, 0);
+
+  bpm->UnpinPage(page_id, false);
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove("test.db");
+}
+
+}  // namespace bustub
@@ -0,0 +1,254 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// simulated_disk_manager_test.cpp
+//
+// Identification: test/storage/simulated_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/disk/simulated_disk_manager.h"
+
+namespace bustub {
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+
+class SimulatedDiskManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.free");
+  }
+
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.free");
+  }
+};
+
+/** @return the time f takes */
+template <typename F>
+static microseconds Time(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration_cast<microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+// NOLINTNEXTLINE
+TEST_F(SimulatedDiskManagerTest, ReadWritePageTest) {
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE];
+  std::strncpy(data, "on the real disk", PAGE_SIZE);
+  {
+    DiskManager dm("test.db");
+    dm.WritePage(2, data);
+    dm.ShutDown();
+  }
+
+  SimulatedDiskManager dm("test.db", DiskProfile::Nvme());
+  // Scenario: the pages of the database file are there from the start.
+  EXPECT_EQ(3, dm.GetNumPages());
+  dm.ReadPage(2, buf);
+  EXPECT_STREQ("on the real disk", buf);
+  dm.ReadPage(7, buf);
+  for (char byte : buf) {
+    ASSERT_EQ(0, byte);
+  }
+
+  // Scenario: writes land in memory, single or vectored, and the file is left alone.
+  std::strncpy(data, "simulated", PAGE_SIZE);
+  dm.WritePage(2, data);
+  const char *run[] = {data, data};
+  dm.WritePages(5, run, 2);
+  EXPECT_EQ(7, dm.GetNumPages());
+  dm.ReadPage(6, buf);
+  EXPECT_STREQ("simulated", buf);
+  EXPECT_EQ(3, dm.GetNumWrites());
+  EXPECT_TRUE(dm.Sync());
+  dm.ShutDown();
+
+  DiskManager real("test.db");
+  EXPECT_EQ(3, real.GetNumPages());
+  real.ReadPage(2, buf);
+  EXPECT_STREQ("on the real disk", buf);
+  real.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(SimulatedDiskManagerTest, TimingTest) {
+  char buf[PAGE_SIZE] = {0};
+
+  // Scenario: with a fixed latency, serial reads add up and concurrent reads overlap.
+  {
+    SimulatedDiskManager dm("test.db", DiskProfile::FixedLatency(milliseconds(2)));
+    EXPECT_GE(Time([&] {
+                for (int i = 0; i < 10; i++) {
+                  dm.ReadPage(i, buf);
+                }
+              }),
+              milliseconds(20));
+    auto parallel = Time([&] {
+      std::vector<std::thread> threads;
+      for (int t = 0; t < 10; t++) {
+        threads.emplace_back([&dm, t] {
+          char page[PAGE_SIZE];
+          dm.ReadPage(t, page);
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+    });
+    EXPECT_GE(parallel, milliseconds(2));
+    EXPECT_LT(parallel, milliseconds(15));
+    dm.ShutDown();
+  }
+
+  // Scenario: a disk with one head pays a seek for every jump, none for the next page, and queues concurrent requests.
+  {
+    DiskProfile profile{nanoseconds(0), nanoseconds(0), milliseconds(1), nanoseconds(0), 0, 1};
+    SimulatedDiskManager dm("test.db", profile);
+    for (int i = 0; i < 10; i++) {
+      dm.ReadPage(i, buf);
+    }
+    EXPECT_EQ(1, dm.GetNumSeeks());
+    EXPECT_GE(Time([&] {
+                for (int i = 0; i < 10; i++) {
+                  dm.ReadPage(i * 7 % 10 + 20, buf);
+                }
+              }),
+              milliseconds(10));
+    EXPECT_EQ(11, dm.GetNumSeeks());
+    dm.ShutDown();
+  }
+
+  // Scenario: bandwidth limits a vectored write, which pays the latency only once.
+  {
+    DiskProfile profile{milliseconds(1), milliseconds(1), nanoseconds(0), nanoseconds(0), 100 * PAGE_SIZE, 4};
+    SimulatedDiskManager dm("test.db", profile);
+    std::vector<const char *> run(10, buf);
+    auto elapsed = Time([&] { dm.WritePages(0, run.data(), run.size()); });
+    EXPECT_GE(elapsed, milliseconds(101));
+    EXPECT_LT(elapsed, milliseconds(150));
+    dm.ShutDown();
+  }
+}
+
+// A benchmark: run it explicitly with --gtest_also_run_disabled_tests.
+// NOLINTNEXTLINE
+TEST_F(SimulatedDiskManagerTest, DISABLED_BenchmarkTest) {
+  const page_id_t num_pages = 128;
+  const size_t pool_size = 64;
+  const size_t read_ahead = 16;
+  const int random_reads = 64;
+  const microseconds page_work(50);
+
+  struct Device {
+    const char *name_;
+    DiskProfile profile_;
+  };
+  for (const Device &device : {Device{"NVMe", DiskProfile::Nvme()}, Device{"SATA SSD", DiskProfile::SataSsd()},
+                               Device{"HDD", DiskProfile::Hdd()}}) {
+    auto *dm = new SimulatedDiskManager("test.db", device.profile_);
+    page_id_t page_id;
+
+    // Write coalescing: FlushAllPages writes runs of consecutive pages with one request each, then syncs once.
+    auto *bpm = new BufferPoolManagerInstance(num_pages, dm);
+    for (page_id_t i = 0; i < num_pages; i++) {
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+      bpm->UnpinPage(page_id, true);
+    }
+    auto coalesced = Time([&] { bpm->FlushAllPages(); });
+    for (page_id_t i = 0; i < num_pages; i++) {
+      bpm->FetchPage(i);
+      bpm->UnpinPage(i, true);
+    }
+    auto page_by_page = Time([&] {
+      for (page_id_t i = 0; i < num_pages; i++) {
+        bpm->FlushPage(i);
+      }
+      dm->Sync();
+    });
+    delete bpm;
+
+    // Prefetching: a cold scan that works on every page, with and without reading ahead.
+    auto scan = [&](bool prefetch) {
+      auto *pool = new BufferPoolManagerInstance(pool_size, dm);
+      auto elapsed = Time([&] {
+        for (page_id_t i = 0; i < num_pages; i++) {
+          if (prefetch && i % read_ahead == 0) {
+            std::vector<page_id_t> ahead;
+            for (page_id_t j = i; j < std::min<page_id_t>(i + 2 * read_ahead, num_pages); j++) {
+              ahead.push_back(j);
+            }
+            pool->PrefetchPages(ahead);
+          }
+          Page *page = pool->FetchPage(i);
+          EXPECT_NE(nullptr, page);
+          std::this_thread::sleep_for(page_work);
+          pool->UnpinPage(i, false);
+        }
+      });
+      delete pool;
+      return elapsed;
+    };
+    auto plain_scan = scan(false);
+    auto prefetched_scan = scan(true);
+
+    // Concurrent misses: the device works on as many as its parallelism allows.
+    auto random = [&](int num_threads) {
+      auto *pool = new BufferPoolManagerInstance(pool_size, dm);
+      auto elapsed = Time([&] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+          threads.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            for (int i = 0; i < random_reads / num_threads; i++) {
+              page_id_t id = static_cast<page_id_t>(rng() % num_pages);
+              Page *page = pool->FetchPage(id);
+              if (page != nullptr) {
+                pool->UnpinPage(id, false);
+              }
+            }
+          });
+        }
+        for (auto &thread : threads) {
+          thread.join();
+        }
+      });
+      delete pool;
+      return elapsed;
+    };
+    auto one_thread = random(1);
+    auto four_threads = random(4);
+
+    printf("%-8s flush %3d pages: %7.2f ms coalesced, %7.2f ms page by page | scan: %7.2f ms, %7.2f ms prefetched | "
+           "%d random reads: %7.2f ms on 1 thread, %7.2f ms on 4\n",
+           device.name_, num_pages, coalesced.count() / 1e3, page_by_page.count() / 1e3, plain_scan.count() / 1e3,
+           prefetched_scan.count() / 1e3, random_reads, one_thread.count() / 1e3, four_threads.count() / 1e3);
+    EXPECT_LT(coalesced, page_by_page);
+
+    dm->ShutDown();
+    delete dm;
+    remove("test.db");
+  }
+}
+
+}  // namespace bustub
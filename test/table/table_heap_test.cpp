@@ -0,0 +1,182 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_heap_test.cpp
+//
+// Identification: test/table/table_heap_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/disk/simulated_disk_manager.h"
+#include "storage/table/table_heap.h"
+
+namespace bustub {
+
+/**
+ * Fills a fresh table with tuples until it spans num_pages pages and writes it to db_name.
+ * @return the id of the table's first page
+ */
+static page_id_t BuildTable(const std::string &db_name, const Schema &schema, size_t num_pages, size_t *num_tuples) {
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *txn = new Transaction(0);
+  auto *table = new TableHeap(bpm, nullptr, nullptr, txn);
+
+  page_id_t last_page_id = INVALID_PAGE_ID;
+  size_t pages = 0;
+  *num_tuples = 0;
+  while (pages < num_pages) {
+    std::vector<Value> values{Value(TypeId::INTEGER, static_cast<int32_t>(*num_tuples)),
+                              Value(TypeId::VARCHAR, std::string(500, 'x'))};
+    Tuple tuple(values, &schema);
+    RID rid;
+    EXPECT_TRUE(table->InsertTuple(tuple, &rid, txn));
+    if (rid.GetPageId() != last_page_id) {
+      last_page_id = rid.GetPageId();
+      pages++;
+    }
+    (*num_tuples)++;
+  }
+  page_id_t first_page_id = table->GetFirstPageId();
+  bpm->FlushAllPages();
+
+  delete table;
+  delete txn;
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  return first_page_id;
+}
+
+/**
+ * Scans a cold table on a slow disk, spending page_work on every page the way an executor would.
+ * @return the time the scan took
+ */
+static std::chrono::microseconds TimeColdScan(BufferPoolManager *bpm, const Schema *schema, page_id_t first_page_id,
+                                              size_t read_ahead, std::chrono::microseconds page_work,
+                                              size_t expected_tuples) {
+  TableHeap table(bpm, nullptr, nullptr, first_page_id);
+  auto *txn = new Transaction(1);
+  auto start = std::chrono::steady_clock::now();
+  size_t tuples = 0;
+  page_id_t last_page_id = INVALID_PAGE_ID;
+  for (auto iter = table.Begin(txn, ScanStrategy::NORMAL, read_ahead); iter != table.End(); ++iter) {
+    EXPECT_EQ(static_cast<int32_t>(tuples), iter->GetValue(schema, 0).GetAs<int32_t>());
+    if (iter->GetRid().GetPageId() != last_page_id) {
+      last_page_id = iter->GetRid().GetPageId();
+      std::this_thread::sleep_for(page_work);
+    }
+    tuples++;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  EXPECT_EQ(expected_tuples, tuples);
+  delete txn;
+  return elapsed;
+}
+
+// NOLINTNEXTLINE
+TEST(TableHeapTest, ReadAheadScanTest) {
+  const std::string db_name = "test.db";
+  const size_t num_pages = 64;
+  const std::chrono::microseconds disk_delay(1000);
+  const std::chrono::microseconds page_work(1000);
+  Schema schema({Column("id", TypeId::INTEGER), Column("payload", TypeId::VARCHAR, 500)});
+
+  size_t num_tuples;
+  page_id_t first_page_id = BuildTable(db_name, schema, num_pages, &num_tuples);
+
+  // Every scan starts cold: a new pool much smaller than the table, on a disk that takes disk_delay per page.
+  auto cold_scan = [&](bool parallel, size_t read_ahead) {
+    auto *disk_manager = new SimulatedDiskManager(db_name, DiskProfile::FixedLatency(disk_delay));
+    BufferPoolManager *bpm;
+    if (parallel) {
+      bpm = new ParallelBufferPoolManager(4, 4, disk_manager);
+    } else {
+      bpm = new BufferPoolManagerInstance(16, disk_manager);
+    }
+    std::chrono::microseconds elapsed = TimeColdScan(bpm, &schema, first_page_id, read_ahead, page_work, num_tuples);
+    delete bpm;
+    disk_manager->ShutDown();
+    delete disk_manager;
+    return elapsed;
+  };
+
+  std::chrono::microseconds plain = cold_scan(false, 0);
+  std::chrono::microseconds read_ahead = cold_scan(false, 8);
+  std::chrono::microseconds parallel_read_ahead = cold_scan(true, 8);
+
+  // Scenario: with read-ahead the next page is read while the scan works on the current one, so the disk time mostly
+  // disappears from the scan; without it the scan pays for both.
+  EXPECT_LT(read_ahead.count() * 13, plain.count() * 10);
+  EXPECT_LT(parallel_read_ahead.count() * 13, plain.count() * 10);
+
+  remove(db_name.c_str());
+  remove("test.log");
+}
+
+// A benchmark: run it explicitly with --gtest_also_run_disabled_tests.
+// NOLINTNEXTLINE
+TEST(TableHeapTest, DISABLED_PageSizeBenchmarkTest) {
+  // The table and the pool have the same size in bytes whatever PAGE_SIZE is; build with -DBUSTUB_PAGE_SIZE=16384
+  // or 32768 to compare.
+  const std::string db_name = "test.db";
+  const size_t table_bytes = 2 << 20;
+  const size_t pool_bytes = 256 << 10;
+  const int num_lookups = 2000;
+  Schema schema({Column("id", TypeId::INTEGER), Column("payload", TypeId::VARCHAR, 500)});
+  size_t num_tuples;
+  page_id_t first_page_id = BuildTable(db_name, schema, table_bytes / PAGE_SIZE, &num_tuples);
+
+  auto *disk_manager = new SimulatedDiskManager(db_name, DiskProfile::Nvme());
+  auto *bpm = new BufferPoolManagerInstance(pool_bytes / PAGE_SIZE, disk_manager);
+  TableHeap table(bpm, nullptr, nullptr, first_page_id);
+  auto *txn = new Transaction(1);
+
+  // Scenario: a cold scan reads the table once, a page at a time.
+  std::vector<RID> rids;
+  auto start = std::chrono::steady_clock::now();
+  for (auto iter = table.Begin(txn); iter != table.End(); ++iter) {
+    rids.push_back(iter->GetRid());
+  }
+  double scan_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  EXPECT_EQ(num_tuples, rids.size());
+
+  // Scenario: point lookups of random tuples, most of which miss the pool.
+  std::mt19937 rng(0);
+  Tuple tuple;
+  BufferPoolStats before = bpm->GetStats();
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_lookups; i++) {
+    const RID &rid = rids[rng() % rids.size()];
+    ASSERT_TRUE(table.GetTuple(rid, &tuple, txn));
+  }
+  double lookup_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  BufferPoolStats after = bpm->GetStats();
+  const size_t lookup_hits = after.hits_ - before.hits_;
+
+  printf("PAGE_SIZE %5d on NVMe: scan %.0f tuples/s (%.0f MiB/s), %.0f point lookups/s, %.1f%% hits\n", PAGE_SIZE,
+         num_tuples / scan_seconds, static_cast<double>(table_bytes) / (1 << 20) / scan_seconds,
+         num_lookups / lookup_seconds, 100.0 * lookup_hits / num_lookups);
+
+  delete txn;
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove("test.log");
+}
+
+}  // namespace bustub